@@ -10,7 +10,7 @@ if exist carbon.exe del /f /q carbon.exe 2>nul
 
 echo.
 echo Building unified version with all interfaces (no dependencies)...
-gcc src\main.c src\input.c src\compute.c src\report.c src\ui.c src\simple_ui.c -o carbon.exe -lm
+gcc src\main.c src\input.c src\compute.c src\report.c src\ui.c src\simple_ui.c src\batch.c src\csv.c src\compute_batch.c src\compute_simd.c src\threadpool.c src\ring_buffer.c src\pipeline.c src\arena.c src\lookup.c src\factors.c src\montecarlo.c src\scenario.c src\incremental.c src\sensitivity.c src\optimize.c src\rollup.c src\summation.c src\validator.c src\report_writer.c src\result_sink.c src\result_store.c -o carbon.exe -lm
 if %errorlevel% neq 0 (
     echo ERROR: Failed to build program
     echo This might be due to file permissions or antivirus software.
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t capacity;
+    size_t used;
+};
+
+// Chunk data starts after the header, rounded up to the alignment
+#define ARENA_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static char *chunk_data(ArenaChunk *chunk) {
+    return (char *)chunk + ARENA_HEADER_SIZE;
+}
+
+static ArenaChunk *chunk_create(size_t capacity) {
+    ArenaChunk *chunk = malloc(ARENA_HEADER_SIZE + capacity);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    return chunk;
+}
+
+void arena_init(Arena *arena, size_t chunk_size) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_SIZE;
+}
+
+// Returns size bytes of uninitialized memory, or NULL if out of memory
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *chunk = arena->current;
+    if (chunk && chunk->capacity - chunk->used >= size) {
+        void *memory = chunk_data(chunk) + chunk->used;
+        chunk->used += size;
+        return memory;
+    }
+
+    // Chunks after the current one are free since the last reset; reuse the
+    // next one if it is big enough, otherwise insert a new chunk before it
+    ArenaChunk *next = chunk ? chunk->next : arena->first;
+    if (!next || next->capacity < size) {
+        size_t chunk_size = arena->chunk_size ? arena->chunk_size : ARENA_CHUNK_SIZE;
+        ArenaChunk *created = chunk_create(size > chunk_size ? size : chunk_size);
+        if (!created) {
+            return NULL;
+        }
+        created->next = next;
+        if (chunk) {
+            chunk->next = created;
+        } else {
+            arena->first = created;
+        }
+        next = created;
+    }
+
+    next->used = size;
+    arena->current = next;
+    return chunk_data(next);
+}
+
+// Copies length bytes of text into the arena as a NUL-terminated string
+char *arena_strndup(Arena *arena, const char *text, size_t length) {
+    char *copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+// Releases every allocation at once; the chunks are kept for reuse
+void arena_reset(Arena *arena) {
+    if (arena->first) {
+        arena->first->used = 0;
+    }
+    arena->current = arena->first;
+}
+
+void arena_free(Arena *arena) {
+    ArenaChunk *chunk = arena->first;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+}
@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Default bytes per chunk; larger requests get a chunk of their own
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+
+typedef struct ArenaChunk ArenaChunk;
+
+// Bump allocator: allocations are carved from large chunks and released
+// all at once by arena_reset(), which keeps the chunks for reuse. Pointers
+// are 16-byte aligned and stay valid until the next reset. A zeroed Arena
+// is ready to use with the default chunk size.
+typedef struct {
+    ArenaChunk *first;
+    ArenaChunk *current;
+    size_t chunk_size;
+} Arena;
+
+// Function declarations
+void arena_init(Arena *arena, size_t chunk_size);
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strndup(Arena *arena, const char *text, size_t length);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+
+#endif
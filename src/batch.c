@@ -0,0 +1,1204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "batch.h"
+#include "report.h"
+#include "pipeline.h"
+
+void write_batch_header(FILE *out) {
+    fprintf(out, "%-8s %-12s %9s %9s %9s %9s %9s %9s %9s %10s %8s\n",
+            "Farm", "Crop(s)", "Size(ha)", "Fert", "Manure", "Fuel", "Irrig", "Pestic", "Live.", "Total", "Per ha");
+}
+
+// The quarantine file repeats the input's header after columns for the CSV
+// line of each rejected row, the field(s) at fault and the reason
+void write_quarantine_header(FILE *out, const CsvRow *header) {
+    fprintf(out, "line,field,reason,%.*s\n", (int)header->length, header->start);
+}
+
+// Appends one rejected row to a quarantine buffer. Field lists such as
+// "nitrogen,diesel" are written with ';' so the columns stay intact.
+void format_quarantine_row(TextBuffer *buffer, const CsvRow *row, const char *field, const char *reason) {
+    char fields[128];
+
+    snprintf(fields, sizeof(fields), "%s", field);
+    for (char *c = fields; *c; c++) {
+        if (*c == ',') *c = ';';
+    }
+    text_buffer_printf(buffer, "%d,%s,%s,%.*s\n", row->line, fields, reason, (int)row->length, row->start);
+}
+
+// Appends printf-style output, growing the buffer as needed
+void text_buffer_printf(TextBuffer *buffer, const char *format, ...) {
+    va_list args;
+
+    while (1) {
+        size_t available = buffer->capacity - buffer->length;
+        va_start(args, format);
+        int written = vsnprintf(buffer->data ? buffer->data + buffer->length : NULL,
+                                available, format, args);
+        va_end(args);
+
+        if (written < 0) {
+            buffer->failed = 1;
+            return;
+        }
+        if ((size_t)written < available) {
+            buffer->length += (size_t)written;
+            return;
+        }
+
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity - buffer->length <= (size_t)written) {
+            capacity *= 2;
+        }
+        char *data = realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+// Empties a buffer for reuse, clearing an earlier failure
+void text_buffer_reset(TextBuffer *buffer) {
+    buffer->length = 0;
+    buffer->failed = 0;
+}
+
+void text_buffer_free(TextBuffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static void format_result_columns(TextBuffer *out, const char *farm_label, const char *crop_label,
+                                  double farm_size, const EmissionTotals *results) {
+    text_buffer_printf(out, "%-8s %-12s %9.1f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %10.2f %8.2f\n",
+                       farm_label,
+                       crop_label,
+                       farm_size,
+                       results->fertilizer_emissions,
+                       results->manure_emissions,
+                       results->fuel_emissions,
+                       results->irrigation_emissions,
+                       results->pesticide_emissions,
+                       results->livestock_emissions,
+                       results->total_emissions,
+                       results->per_hectare_emissions);
+}
+
+// Evaluates a legacy block and formats one line or record per row into its
+// buffer. A legacy farm is a single crop, so its per-crop record carries the
+// farm totals.
+void format_legacy_block(LegacyBlock *block) {
+    text_buffer_reset(&block->output);
+    report_writer_reset(&block->records);
+    report_writer_reset(&block->reports);
+    for (size_t i = 0; i < block->num_farms; i++) {
+        const LegacyFarmData *farm = &block->farms[i];
+        EmissionTotals results;
+        char farm_label[24];
+
+        calculate_legacy_emissions_into(farm, &results);
+        snprintf(farm_label, sizeof(farm_label), "%ld", block->row_number[i]);
+        if (block->format == RESULT_TABLE) {
+            format_result_columns(&block->output, farm_label, farm->crop_type, farm->farm_size, &results);
+        } else if (block->per_crop) {
+            CropEmissionResults crop = {
+                find_crop_by_name(farm->crop_type), farm->farm_size,
+                results.fertilizer_emissions, results.manure_emissions, results.fuel_emissions,
+                results.irrigation_emissions, results.pesticide_emissions, results.livestock_emissions,
+                results.total_emissions
+            };
+            write_crop_result(&block->records, block->format, farm_label, farm->crop_type, &crop);
+        } else {
+            write_farm_result(&block->records, block->format, farm_label, farm->crop_type, 1,
+                              farm->farm_size, &results);
+        }
+        if (block->write_reports) {
+            write_legacy_report(&block->reports, farm_label, farm, &results);
+            report_writer_text(&block->reports, "\n");
+        }
+    }
+}
+
+// Empties the block, releasing everything in its arena at once
+void farm_block_reset(FarmBlock *block) {
+    arena_reset(&block->arena);
+    block->num_farms = 0;
+    block->num_rows = 0;
+    block->crop_start[0] = 0;
+    block->gathered = 0;
+    block->invalid_farms = 0;
+    block->invalid_id = NULL;
+    block->rejected_farms = 0;
+    block->rejected_rows = 0;
+    text_buffer_reset(&block->quarantine);
+    text_buffer_reset(&block->reader_quarantine);
+    block->num_reader_rejects = 0;
+}
+
+// Appends one farm whose crops are rows[crop_offset..], copying its ID and
+// crop rows into the block's arena; the caller flushes the block when it is
+// full. source, if not NULL, holds the farm's raw CSV rows for the
+// quarantine. Returns 0 if out of memory.
+int farm_block_add(FarmBlock *block, const char *farm_id, size_t farm_id_length, const FarmRecord *farm,
+                   const CropData *rows, const CsvRow *source) {
+    size_t f = block->num_farms;
+    size_t row_bytes = (size_t)farm->num_crops * sizeof(CropData);
+    CropData *farm_rows = arena_alloc(&block->arena, row_bytes);
+    char *id = arena_strndup(&block->arena, farm_id, farm_id_length);
+    CsvRow *farm_source = NULL;
+
+    if (source) {
+        size_t source_bytes = (size_t)farm->num_crops * sizeof(CsvRow);
+        if (!(farm_source = arena_alloc(&block->arena, source_bytes))) {
+            return 0;
+        }
+        memcpy(farm_source, source, source_bytes);
+    }
+    if (!farm_rows || !id) {
+        return 0;
+    }
+    memcpy(farm_rows, rows + farm->crop_offset, row_bytes);
+
+    block->farm_id[f] = id;
+    block->farm_rows[f] = farm_rows;
+    block->farm_source[f] = farm_source;
+    block->total_farm_size[f] = farm->total_farm_size;
+    block->dairy_cows[f] = farm->dairy_cows;
+    block->pigs[f] = farm->pigs;
+    block->chickens[f] = farm->chickens;
+    block->factor_set[f] = farm->factor_set;
+
+    block->num_rows += (size_t)farm->num_crops;
+    block->num_farms++;
+    block->crop_start[block->num_farms] = block->num_rows;
+    return 1;
+}
+
+// Allocates the kernel's row columns once the block's row count is final.
+// Returns 0 if out of memory.
+int farm_block_finish(FarmBlock *block) {
+    size_t doubles = block->num_rows * sizeof(double);
+    size_t ints = block->num_rows * sizeof(int);
+
+    double **double_columns[] = {
+        &block->area, &block->nitrogen_kg_ha, &block->phosphorus_kg_ha,
+        &block->potassium_kg_ha, &block->manure_kg_ha, &block->diesel_l_ha,
+        &block->irrigation_mm, &block->pesticide_rate,
+        &block->crop_emissions[0], &block->crop_emissions[1], &block->crop_emissions[2],
+        &block->crop_emissions[3], &block->crop_emissions[4], &block->crop_emissions[5],
+        &block->crop_emissions[6]
+    };
+
+    for (size_t i = 0; i < sizeof(double_columns) / sizeof(double_columns[0]); i++) {
+        if (!(*double_columns[i] = arena_alloc(&block->arena, doubles))) {
+            return 0;
+        }
+    }
+    block->crop_id = arena_alloc(&block->arena, ints);
+    block->pesticide_id = arena_alloc(&block->arena, ints);
+    block->row_errors = arena_alloc(&block->arena, block->num_rows * sizeof(uint32_t));
+    return block->crop_id != NULL && block->pesticide_id != NULL && block->row_errors != NULL;
+}
+
+// Copies the parsed crop rows into the kernel's columns
+static void farm_block_gather(FarmBlock *block) {
+    for (size_t f = 0; f < block->num_farms; f++) {
+        const CropData *farm_rows = block->farm_rows[f];
+        size_t first_row = block->crop_start[f];
+        size_t num_rows = block->crop_start[f + 1] - first_row;
+
+        for (size_t i = 0; i < num_rows; i++) {
+            const CropData *crop = &farm_rows[i];
+            size_t r = first_row + i;
+
+            block->crop_id[r] = crop->crop_id;
+            block->area[r] = crop->area;
+            block->nitrogen_kg_ha[r] = crop->nitrogen_kg_ha;
+            block->phosphorus_kg_ha[r] = crop->phosphorus_kg_ha;
+            block->potassium_kg_ha[r] = crop->potassium_kg_ha;
+            block->manure_kg_ha[r] = crop->manure_kg_ha;
+            block->diesel_l_ha[r] = crop->diesel_l_ha;
+            block->irrigation_mm[r] = crop->irrigation_mm;
+            block->pesticide_rate[r] = crop->pesticide_rate;
+            block->pesticide_id[r] = crop->pesticide_id;
+        }
+    }
+    block->gathered = 1;
+}
+
+// Moves farm `from` of a block to position `to` (to <= from), with its rows
+// starting at row `row`
+static void farm_block_move(FarmBlock *block, size_t from, size_t to, size_t row) {
+    size_t first = block->crop_start[from];
+    size_t count = block->crop_start[from + 1] - first;
+    double *double_columns[] = {
+        block->area, block->nitrogen_kg_ha, block->phosphorus_kg_ha, block->potassium_kg_ha,
+        block->manure_kg_ha, block->diesel_l_ha, block->irrigation_mm, block->pesticide_rate
+    };
+
+    block->farm_id[to] = block->farm_id[from];
+    block->farm_rows[to] = block->farm_rows[from];
+    block->farm_source[to] = block->farm_source[from];
+    block->total_farm_size[to] = block->total_farm_size[from];
+    block->dairy_cows[to] = block->dairy_cows[from];
+    block->pigs[to] = block->pigs[from];
+    block->chickens[to] = block->chickens[from];
+    block->factor_set[to] = block->factor_set[from];
+    block->farm_errors[to] = 0;
+    if (row != first) {
+        for (size_t c = 0; c < sizeof(double_columns) / sizeof(double_columns[0]); c++) {
+            memmove(double_columns[c] + row, double_columns[c] + first, count * sizeof(double));
+        }
+        memmove(block->crop_id + row, block->crop_id + first, count * sizeof(int));
+        memmove(block->pesticide_id + row, block->pesticide_id + first, count * sizeof(int));
+    }
+    block->crop_start[to + 1] = row + count;
+}
+
+// Moves the rows of the farms the reader set aside before farm f (all of
+// them for f = block->num_farms) to the quarantine buffer, so they keep
+// their place among the farms the validator rejects
+static void take_reader_rejects(FarmBlock *block, size_t f, size_t *next) {
+    const TextBuffer *text = &block->reader_quarantine;
+
+    if (text->failed) {
+        block->quarantine.failed = 1;
+    }
+    for (; *next < block->num_reader_rejects && block->reader_rejects[*next].farm <= f; (*next)++) {
+        size_t start = *next > 0 ? block->reader_rejects[*next - 1].end : 0;
+        size_t end = block->reader_rejects[*next].end;
+        text_buffer_printf(&block->quarantine, "%.*s", (int)(end - start), text->data + start);
+    }
+}
+
+// Copies the rows of invalid farm f to the block's quarantine buffer; each
+// row names its own failed checks, or the farm's if it has none
+static void farm_block_quarantine(FarmBlock *block, size_t f) {
+    size_t first = block->crop_start[f];
+    size_t count = block->crop_start[f + 1] - first;
+    uint32_t farm_only = block->farm_errors[f] & ~ROW_ERRORS;
+    char fields[128];
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t errors = block->row_errors[first + i];
+        if (errors || farm_only) {
+            format_validation_errors(errors ? errors : farm_only, fields, sizeof(fields));
+            format_quarantine_row(&block->quarantine, &block->farm_source[f][i], fields, "Failed validation");
+        } else {
+            format_quarantine_row(&block->quarantine, &block->farm_source[f][i], "", "Farm has an invalid row");
+        }
+    }
+}
+
+// Validates a finished block column by column and removes its invalid
+// farms, so evaluation, output and rollups only see valid ones. When every
+// farm is valid (the usual case) nothing is moved. With stop_on_invalid,
+// every farm from the first invalid one on is removed; otherwise removed
+// farms are counted in rejected_* and, if their raw rows were kept, copied
+// to the quarantine buffer. The first invalid farm is kept in invalid_* for
+// reporting. Returns the farms removed.
+size_t farm_block_validate(FarmBlock *block) {
+    FarmColumns farms = {
+        block->crop_start, block->total_farm_size,
+        block->dairy_cows, block->pigs, block->chickens, block->factor_set
+    };
+    CropColumns rows = {
+        block->area, block->nitrogen_kg_ha, block->phosphorus_kg_ha,
+        block->potassium_kg_ha, block->manure_kg_ha, block->diesel_l_ha,
+        block->irrigation_mm, block->pesticide_rate, block->pesticide_id, NULL
+    };
+    uint32_t any = 0;
+    size_t next_reject = 0;
+    size_t num_farms = block->num_farms;
+
+    block->invalid_farms = 0;
+    block->invalid_id = NULL;
+    if (block->num_farms == 0) {
+        take_reader_rejects(block, num_farms, &next_reject);
+        return 0;
+    }
+    if (!block->gathered) {
+        farm_block_gather(block);
+    }
+    validate_crop_columns(&rows, block->crop_id, block->num_rows, block->row_errors);
+    validate_farm_columns(&farms, block->num_farms, block->area, block->row_errors, block->farm_errors);
+    for (size_t f = 0; f < block->num_farms; f++) {
+        any |= block->farm_errors[f];
+    }
+    if (!any) {
+        take_reader_rejects(block, num_farms, &next_reject);
+        return 0;
+    }
+
+    size_t kept = 0;
+    size_t row = 0;
+    for (size_t f = 0; f < num_farms; f++) {
+        take_reader_rejects(block, f, &next_reject);
+        int stopped = block->stop_on_invalid && block->invalid_id != NULL;
+        if (block->farm_errors[f] == 0 && !stopped) {
+            farm_block_move(block, f, kept++, row);
+            row = block->crop_start[kept];
+            continue;
+        }
+        if (block->invalid_id == NULL) {
+            FarmRecord *farm = &block->invalid_farm;
+            block->invalid_id = block->farm_id[f];
+            block->invalid_rows = block->farm_rows[f];
+            farm->total_farm_size = block->total_farm_size[f];
+            farm->crop_offset = 0;
+            farm->num_crops = (int)(block->crop_start[f + 1] - block->crop_start[f]);
+            farm->dairy_cows = block->dairy_cows[f];
+            farm->pigs = block->pigs[f];
+            farm->chickens = block->chickens[f];
+            farm->factor_set = block->factor_set[f];
+        }
+        if (!block->stop_on_invalid) {
+            if (block->farm_source[f]) {
+                farm_block_quarantine(block, f);
+            }
+            block->rejected_farms++;
+            block->rejected_rows += block->crop_start[f + 1] - block->crop_start[f];
+        }
+        block->invalid_farms++;
+    }
+    take_reader_rejects(block, num_farms, &next_reject);
+    block->num_farms = kept;
+    block->num_rows = row;
+    return block->invalid_farms;
+}
+
+// Frees the block's arena, output buffer and rollup, not the block itself
+void farm_block_free(FarmBlock *block) {
+    arena_free(&block->arena);
+    text_buffer_free(&block->output);
+    text_buffer_free(&block->quarantine);
+    text_buffer_free(&block->reader_quarantine);
+    free(block->reader_rejects);
+    report_writer_close(&block->records);
+    report_writer_close(&block->reports);
+    rollup_free(&block->rollup);
+}
+
+// Runs the column kernel over every farm in a finished block
+void farm_block_evaluate(FarmBlock *block) {
+    FarmColumns farms = {
+        block->crop_start, block->total_farm_size,
+        block->dairy_cows, block->pigs, block->chickens, block->factor_set
+    };
+    CropColumns rows = {
+        block->area, block->nitrogen_kg_ha, block->phosphorus_kg_ha,
+        block->potassium_kg_ha, block->manure_kg_ha, block->diesel_l_ha,
+        block->irrigation_mm, block->pesticide_rate, block->pesticide_id, NULL
+    };
+    CropEmissionColumns crop_out = {
+        block->crop_emissions[0], block->crop_emissions[1], block->crop_emissions[2],
+        block->crop_emissions[3], block->crop_emissions[4], block->crop_emissions[5],
+        block->crop_emissions[6]
+    };
+    FarmEmissionColumns farm_out = {
+        block->farm_emissions[0], block->farm_emissions[1], block->farm_emissions[2],
+        block->farm_emissions[3], block->farm_emissions[4], block->farm_emissions[5],
+        block->farm_emissions[6], block->farm_emissions[7]
+    };
+
+    if (block->num_farms > 0) {
+        if (!block->gathered) {
+            farm_block_gather(block);
+        }
+        calculate_farm_columns(&farms, block->num_farms, &rows, &crop_out, &farm_out);
+    }
+}
+
+// Copies one farm's totals out of the block
+void farm_block_results(const FarmBlock *block, size_t farm, EmissionTotals *results) {
+    results->fertilizer_emissions = block->farm_emissions[0][farm];
+    results->manure_emissions = block->farm_emissions[1][farm];
+    results->fuel_emissions = block->farm_emissions[2][farm];
+    results->irrigation_emissions = block->farm_emissions[3][farm];
+    results->pesticide_emissions = block->farm_emissions[4][farm];
+    results->livestock_emissions = block->farm_emissions[5][farm];
+    results->total_emissions = block->farm_emissions[6][farm];
+    results->per_hectare_emissions = block->farm_emissions[7][farm];
+}
+
+// Adds the evaluated crop rows of a block to a rollup. Returns 0 if out of memory.
+int farm_block_rollup(const FarmBlock *block, Rollup *rollup) {
+    FarmColumns farms = {
+        block->crop_start, block->total_farm_size,
+        block->dairy_cows, block->pigs, block->chickens, block->factor_set
+    };
+    CropEmissionColumns emissions = {
+        block->crop_emissions[0], block->crop_emissions[1], block->crop_emissions[2],
+        block->crop_emissions[3], block->crop_emissions[4], block->crop_emissions[5],
+        block->crop_emissions[6]
+    };
+
+    if (block->num_farms == 0) {
+        return 1;
+    }
+    return rollup_add_farms(rollup, &farms, block->num_farms, block->crop_id, block->pesticide_id,
+                            block->area, &emissions);
+}
+
+// Appends the crop results of an evaluated block to a binary result file
+static int farm_block_store(const FarmBlock *block, ResultStore *store) {
+    CropEmissionColumns emissions = {
+        block->crop_emissions[0], block->crop_emissions[1], block->crop_emissions[2],
+        block->crop_emissions[3], block->crop_emissions[4], block->crop_emissions[5],
+        block->crop_emissions[6]
+    };
+    ResultBlock results = {
+        block->num_farms, block->crop_start, block->total_farm_size, block->factor_set,
+        block->crop_id, block->pesticide_id, block->area, &emissions
+    };
+
+    if (block->num_farms == 0) {
+        return 1;
+    }
+    return result_store_add(store, &results);
+}
+
+// Evaluates a multi-crop block with the column kernel and formats one line
+// per farm into its buffer
+void format_farm_block(FarmBlock *block) {
+    farm_block_evaluate(block);
+
+    text_buffer_reset(&block->output);
+    for (size_t f = 0; f < block->num_farms; f++) {
+        size_t first_row = block->crop_start[f];
+        size_t num_rows = block->crop_start[f + 1] - first_row;
+        char crop_label[sizeof(((Crop *)0)->name)];
+        EmissionTotals results;
+
+        if (num_rows == 1) {
+            snprintf(crop_label, sizeof(crop_label), "%s", crops[block->crop_id[first_row]].name);
+        } else {
+            snprintf(crop_label, sizeof(crop_label), "%d crops", (int)num_rows);
+        }
+
+        farm_block_results(block, f, &results);
+        format_result_columns(&block->output, block->farm_id[f], crop_label, block->total_farm_size[f], &results);
+    }
+}
+
+// The kernel's per-row columns of an evaluated block as CropEmissionResults,
+// carved from the block's arena. Returns NULL if out of memory.
+static CropEmissionResults *farm_block_crop_results(FarmBlock *block) {
+    CropEmissionResults *crop_results = arena_alloc(&block->arena, block->num_rows * sizeof(CropEmissionResults));
+
+    if (!crop_results) {
+        return NULL;
+    }
+    for (size_t r = 0; r < block->num_rows; r++) {
+        CropEmissionResults *crop = &crop_results[r];
+        crop->crop_id = block->crop_id[r];
+        crop->area = block->area[r];
+        crop->fertilizer_emissions = block->crop_emissions[0][r];
+        crop->manure_emissions = block->crop_emissions[1][r];
+        crop->fuel_emissions = block->crop_emissions[2][r];
+        crop->irrigation_emissions = block->crop_emissions[3][r];
+        crop->pesticide_emissions = block->crop_emissions[4][r];
+        crop->livestock_emissions = block->crop_emissions[5][r];
+        crop->total_emissions = block->crop_emissions[6][r];
+    }
+    return crop_results;
+}
+
+// Formats the full saved-report layout of every farm in an evaluated block
+// into its reports writer
+void format_farm_reports(FarmBlock *block) {
+    CropEmissionResults *crop_results;
+
+    report_writer_reset(&block->reports);
+    if (block->num_farms == 0) {
+        return;
+    }
+    crop_results = farm_block_crop_results(block);
+    if (!crop_results) {
+        block->reports.failed = 1;
+        return;
+    }
+    for (size_t f = 0; f < block->num_farms; f++) {
+        size_t first_row = block->crop_start[f];
+        EmissionTotals results;
+
+        farm_block_results(block, f, &results);
+        write_farm_report(&block->reports, block->farm_id[f], block->total_farm_size[f], &results,
+                          crop_results + first_row, (int)(block->crop_start[f + 1] - first_row));
+        report_writer_text(&block->reports, "\n");
+    }
+}
+
+// Formats a CSV or JSON Lines record per farm (or per crop) of an evaluated
+// block into its records writer
+void format_farm_records(FarmBlock *block) {
+    const CropEmissionResults *crop_results = NULL;
+
+    report_writer_reset(&block->records);
+    if (block->num_farms == 0) {
+        return;
+    }
+    if (block->per_crop) {
+        crop_results = farm_block_crop_results(block);
+        if (!crop_results) {
+            block->records.failed = 1;
+            return;
+        }
+    }
+    for (size_t f = 0; f < block->num_farms; f++) {
+        size_t first_row = block->crop_start[f];
+        size_t end = block->crop_start[f + 1];
+
+        if (crop_results) {
+            for (size_t r = first_row; r < end; r++) {
+                write_crop_result(&block->records, block->format, block->farm_id[f],
+                                  crops[block->crop_id[r]].name, &crop_results[r]);
+            }
+        } else {
+            EmissionTotals results;
+            farm_block_results(block, f, &results);
+            write_farm_result(&block->records, block->format, block->farm_id[f],
+                              end - first_row == 1 ? crops[block->crop_id[first_row]].name : NULL,
+                              (int)(end - first_row), block->total_farm_size[f], &results);
+        }
+    }
+}
+
+static void compute_legacy_block(void *block) {
+    format_legacy_block(block);
+}
+
+// Evaluates a block and, with a rollup, sums it into the block's own
+// partial on the worker thread; the writer merges partials in input order
+static void compute_farm_block(void *arg) {
+    FarmBlock *block = arg;
+
+    farm_block_validate(block);
+    if (block->format_lines && block->format == RESULT_TABLE) {
+        format_farm_block(block);
+    } else {
+        farm_block_evaluate(block);
+        text_buffer_reset(&block->output);
+        if (block->format_lines) {
+            format_farm_records(block);
+        }
+    }
+    if (block->write_reports) {
+        format_farm_reports(block);
+    }
+    if (block->rollup.dimensions) {
+        rollup_reset(&block->rollup);
+        block->rolled_up = farm_block_rollup(block, &block->rollup);
+    }
+}
+
+// Writer state for a legacy file
+typedef struct {
+    FILE *output;
+    FILE *quarantine;           // NULL without a quarantine file
+    ReportWriter *report;       // NULL without a report file
+    int ok;
+} LegacyWriteContext;
+
+static void write_legacy_block(void *arg, void *context) {
+    const LegacyBlock *block = arg;
+    LegacyWriteContext *ctx = context;
+
+    if (!ctx->ok) {
+        return;
+    }
+    if (block->output.failed || block->quarantine.failed || block->records.failed) {
+        printf("Error: Out of memory\n");
+        ctx->ok = 0;
+        return;
+    }
+    if (block->output.length > 0) {
+        fwrite(block->output.data, 1, block->output.length, ctx->output);
+    }
+    if (block->records.length > 0) {
+        fwrite(block->records.data, 1, block->records.length, ctx->output);
+    }
+    if (ctx->quarantine && block->quarantine.length > 0 &&
+        fwrite(block->quarantine.data, 1, block->quarantine.length, ctx->quarantine) != block->quarantine.length) {
+        printf("Error: Could not write the quarantine file\n");
+        ctx->ok = 0;
+        return;
+    }
+    if (ctx->report) {
+        report_writer_append(ctx->report, &block->reports);
+    }
+}
+
+// Writer state for a multi-crop file
+typedef struct {
+    FILE *output;
+    FILE *quarantine;           // NULL without a quarantine file
+    ReportWriter *report;       // NULL without a report file
+    ResultStore *store;         // NULL without a binary result file
+    Rollup *rollup;             // NULL without a rollup
+    BatchStats *stats;
+    int *stop_reading;          // set to stop the reader at the first invalid farm
+    int ok;
+} FarmWriteContext;
+
+static void write_farm_block(void *arg, void *context) {
+    const FarmBlock *block = arg;
+    FarmWriteContext *ctx = context;
+
+    // Blocks after a failure were read ahead of it and are not reported
+    if (!ctx->ok) {
+        return;
+    }
+    if (block->output.failed || block->quarantine.failed || block->records.failed) {
+        printf("Error: Out of memory\n");
+        ctx->ok = 0;
+        return;
+    }
+    if (block->output.length > 0) {
+        fwrite(block->output.data, 1, block->output.length, ctx->output);
+    }
+    if (block->records.length > 0) {
+        fwrite(block->records.data, 1, block->records.length, ctx->output);
+    }
+    if (ctx->store && !farm_block_store(block, ctx->store)) {
+        printf("Error: Could not write the binary result file\n");
+        __atomic_store_n(ctx->stop_reading, 1, __ATOMIC_RELAXED);
+        ctx->ok = 0;
+        return;
+    }
+    ctx->stats->farms_processed += (long)block->num_farms;
+    if (block->invalid_id != NULL && block->stop_on_invalid) {
+        validate_farm_record(&block->invalid_farm, block->invalid_rows);
+        printf("Error: Validation failed for farm %s\n", block->invalid_id);
+        __atomic_store_n(ctx->stop_reading, 1, __ATOMIC_RELAXED);
+        ctx->ok = 0;
+        return;
+    }
+    ctx->stats->farms_skipped += (long)block->rejected_farms;
+    ctx->stats->rows_rejected += (long)block->rejected_rows;
+    if (ctx->quarantine && block->quarantine.length > 0 &&
+        fwrite(block->quarantine.data, 1, block->quarantine.length, ctx->quarantine) != block->quarantine.length) {
+        printf("Error: Could not write the quarantine file\n");
+        __atomic_store_n(ctx->stop_reading, 1, __ATOMIC_RELAXED);
+        ctx->ok = 0;
+        return;
+    }
+    if (ctx->report) {
+        report_writer_append(ctx->report, &block->reports);
+    }
+    if (ctx->rollup && ctx->ok) {
+        if (!block->rolled_up) {
+            printf("Error: Out of memory\n");
+            ctx->ok = 0;
+            return;
+        }
+        rollup_merge(ctx->rollup, &block->rollup);
+    }
+}
+
+// The table header, or the CSV header of the chosen records
+static void write_output_header(const BatchOptions *options) {
+    if (options->format == RESULT_TABLE) {
+        write_batch_header(options->output);
+    } else {
+        write_result_header(options->output, options->format, options->per_crop);
+    }
+}
+
+// Allocates the blocks that circulate through the pipeline: one per block
+// being evaluated plus one being read and one being written
+static void **allocate_blocks(size_t block_size, int count) {
+    void **blocks = calloc((size_t)count, sizeof(void *));
+    if (!blocks) {
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        blocks[i] = calloc(1, block_size);
+        if (!blocks[i]) {
+            for (int j = 0; j < i; j++) {
+                free(blocks[j]);
+            }
+            free(blocks);
+            return NULL;
+        }
+    }
+    return blocks;
+}
+
+static void free_legacy_block(void *block) {
+    text_buffer_free(&((LegacyBlock *)block)->output);
+    text_buffer_free(&((LegacyBlock *)block)->quarantine);
+    report_writer_close(&((LegacyBlock *)block)->records);
+    report_writer_close(&((LegacyBlock *)block)->reports);
+}
+
+static void free_farm_block(void *block) {
+    farm_block_free(block);
+}
+
+static void free_blocks(void **blocks, int count, void (*free_block)(void *)) {
+    for (int i = 0; i < count; i++) {
+        free_block(blocks[i]);
+        free(blocks[i]);
+    }
+    free(blocks);
+}
+
+static int pipeline_blocks(const BatchOptions *options) {
+    return options->threads > 1 ? options->threads * BATCH_BLOCKS_PER_THREAD + 2 : 1;
+}
+
+// Reader state for a legacy file; reading stops at EOF or the first bad row
+// unless bad rows are set aside (keep_going)
+typedef struct {
+    CsvReader reader;
+    CsvField fields[CSV_MAX_FIELDS];
+    BatchStats *stats;
+    int keep_going;
+    int quarantine;             // copy rejected rows to the block's quarantine buffer
+    int reading;
+    int ok;
+} LegacyReadContext;
+
+// Parses and validates a legacy row without printing; returns 1 if the row
+// was set aside instead
+static int reject_legacy_row(LegacyReadContext *ctx, LegacyBlock *block, int field_count, LegacyFarmData *farm) {
+    const char *field = NULL;
+    const char *reason = NULL;
+    char names[128];
+    char invalid[64];
+
+    if (field_count < 0) {
+        field = "";
+        reason = "Too many fields";
+    } else if ((field = parse_legacy_csv_row(ctx->fields, field_count, farm)) != NULL) {
+        snprintf(invalid, sizeof(invalid), "%s %s", strcmp(field, "crop_type") == 0 ? "Missing" : "Invalid", field);
+        reason = invalid;
+    } else {
+        uint32_t errors = legacy_input_errors(farm);
+        if (!errors) {
+            return 0;
+        }
+        format_validation_errors(errors, names, sizeof(names));
+        field = names;
+        reason = "Failed validation";
+    }
+
+    if (ctx->quarantine) {
+        format_quarantine_row(&block->quarantine, &ctx->reader.row, field, reason);
+    }
+    ctx->stats->farms_skipped++;
+    ctx->stats->rows_rejected++;
+    return 1;
+}
+
+static int read_legacy_block(void *arg, void *context) {
+    LegacyBlock *block = arg;
+    LegacyReadContext *ctx = context;
+
+    block->num_farms = 0;
+    text_buffer_reset(&block->quarantine);
+
+    while (ctx->reading && block->num_farms < BATCH_LEGACY_BLOCK_ROWS) {
+        int field_count = csv_next_row(&ctx->reader, ctx->fields, CSV_MAX_FIELDS);
+        if (field_count == 0) {
+            ctx->reading = 0;
+            break;
+        }
+
+        LegacyFarmData *farm = &block->farms[block->num_farms];
+        memset(farm, 0, sizeof(*farm));
+        ctx->stats->rows_read++;
+        block->row_number[block->num_farms] = ctx->stats->rows_read;
+
+        if (ctx->keep_going) {
+            if (!reject_legacy_row(ctx, block, field_count, farm)) {
+                block->num_farms++;
+            }
+            continue;
+        }
+        if (field_count < 0) {
+            printf("Error: Too many fields in CSV line %d\n", ctx->reader.line);
+            ctx->reading = ctx->ok = 0;
+            break;
+        }
+        if (!parse_legacy_csv_fields(ctx->fields, field_count, ctx->reader.line, farm)) {
+            ctx->reading = ctx->ok = 0;
+            break;
+        }
+        if (!validate_legacy_input(farm)) {
+            printf("Error: Validation failed for CSV line %d\n", ctx->reader.line);
+            ctx->reading = ctx->ok = 0;
+            break;
+        }
+        block->num_farms++;
+    }
+
+    // Rows parsed before an error are still reported
+    ctx->stats->farms_processed += (long)block->num_farms;
+    return block->num_farms > 0 || block->quarantine.length > 0;
+}
+
+// Streams every data row of a legacy CSV file through calculate_legacy_emissions().
+// The file is memory-mapped and tokenized in place. Rows are parsed into
+// blocks that flow through the read -> compute -> write pipeline (compute in
+// parallel with --threads) and are written in input order; memory is bounded
+// by the blocks in flight, not by the size of the input file.
+int run_legacy_batch(const BatchOptions *options, BatchStats *stats) {
+    LegacyReadContext ctx;
+    BatchStats local = {0};
+    if (!stats) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    if (!csv_open(&ctx.reader, options->input_path)) {
+        return 0;
+    }
+
+    // Skip header line
+    if (csv_next_row(&ctx.reader, ctx.fields, CSV_MAX_FIELDS) == 0) {
+        printf("Error: No data found in CSV file\n");
+        csv_close(&ctx.reader);
+        return 0;
+    }
+
+    int num_blocks = pipeline_blocks(options);
+    void **blocks = allocate_blocks(sizeof(LegacyBlock), num_blocks);
+    if (!blocks) {
+        printf("Error: Out of memory\n");
+        csv_close(&ctx.reader);
+        return 0;
+    }
+
+    for (int i = 0; i < num_blocks; i++) {
+        LegacyBlock *block = blocks[i];
+        block->format = options->format;
+        block->per_crop = options->per_crop;
+        block->write_reports = options->report != NULL;
+    }
+
+    ctx.stats = stats;
+    ctx.keep_going = options->skip_invalid;
+    ctx.quarantine = options->quarantine != NULL;
+    ctx.reading = 1;
+    ctx.ok = 1;
+
+    LegacyWriteContext write_ctx = {options->output, options->quarantine, options->report, 1};
+    PipelineStages stages = {
+        read_legacy_block, compute_legacy_block, write_legacy_block, &ctx, &write_ctx
+    };
+    if (options->quarantine) {
+        write_quarantine_header(options->quarantine, &ctx.reader.row);
+    }
+    write_output_header(options);
+    if (run_pipeline(&stages, blocks, num_blocks, options->threads) < 0) {
+        ctx.ok = 0;
+    }
+
+    free_blocks(blocks, num_blocks, free_legacy_block);
+    csv_close(&ctx.reader);
+    return ctx.ok && write_ctx.ok;
+}
+
+// Reader state for a multi-crop file; reading stops at EOF or the first bad farm
+typedef struct {
+    MultiCropCsv csv;
+    CropArena crops;            // rows of the farm being read
+    FarmRecord farm;
+    BatchStats *stats;
+    int reading;
+    int stop;                   // set by the writer after an invalid farm
+    int quarantine;             // copy rejected rows to the block's quarantine buffer
+    int ok;
+} FarmReadContext;
+
+// Sets aside the farm multi_crop_csv_next_farm() just rejected: the row at
+// fault names the field and reason, the farm's other rows are set aside
+// with it
+static void reject_farm_rows(FarmReadContext *ctx, FarmBlock *block) {
+    const MultiCropCsv *csv = &ctx->csv;
+
+    if (ctx->quarantine) {
+        for (size_t i = 0; i < csv->num_rows; i++) {
+            const CsvRow *row = &csv->rows[i];
+            if (row->line == csv->error.line) {
+                format_quarantine_row(&block->reader_quarantine, row, csv->error.field, csv->error.reason);
+            } else {
+                format_quarantine_row(&block->reader_quarantine, row, "", "Farm has an invalid row");
+            }
+        }
+
+        // Where the rows go among the block's farms is settled once the
+        // validator has rejected its own
+        if (block->num_reader_rejects == block->reader_reject_capacity) {
+            size_t capacity = block->reader_reject_capacity ? block->reader_reject_capacity * 2 : 16;
+            ReaderReject *rejects = realloc(block->reader_rejects, capacity * sizeof(ReaderReject));
+            if (rejects) {
+                block->reader_rejects = rejects;
+                block->reader_reject_capacity = capacity;
+            }
+        }
+        if (block->num_reader_rejects < block->reader_reject_capacity) {
+            block->reader_rejects[block->num_reader_rejects].farm = block->num_farms;
+            block->reader_rejects[block->num_reader_rejects].end = block->reader_quarantine.length;
+            block->num_reader_rejects++;
+        } else {
+            block->reader_quarantine.failed = 1;
+        }
+    }
+    ctx->stats->rows_read += (long)csv->num_rows;
+    block->rejected_farms++;
+    block->rejected_rows += csv->num_rows;
+}
+
+static int read_farm_block(void *arg, void *context) {
+    FarmBlock *block = arg;
+    FarmReadContext *ctx = context;
+
+    farm_block_reset(block);
+
+    if (__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED)) {
+        ctx->reading = 0;
+    }
+    while (ctx->reading && block->num_farms < BATCH_BLOCK_FARMS) {
+        crop_arena_reset(&ctx->crops);
+        int status = multi_crop_csv_next_farm(&ctx->csv, &ctx->crops, &ctx->farm);
+        if (status < 0 && ctx->csv.keep_going && ctx->csv.error.field != NULL) {
+            reject_farm_rows(ctx, block);
+            continue;
+        }
+        if (status <= 0) {
+            ctx->reading = 0;
+            ctx->ok = status == 0;
+            break;
+        }
+        ctx->stats->rows_read += ctx->farm.num_crops;
+
+        // Farms are validated column-wise with the rest of their block
+        if (!farm_block_add(block, ctx->csv.farm_id, ctx->csv.farm_id_length, &ctx->farm, ctx->crops.rows,
+                            ctx->quarantine ? ctx->csv.rows : NULL)) {
+            printf("Error: Out of memory\n");
+            ctx->reading = ctx->ok = 0;
+            break;
+        }
+    }
+
+    if (block->num_farms > 0 && !farm_block_finish(block)) {
+        printf("Error: Out of memory\n");
+        ctx->reading = ctx->ok = 0;
+        farm_block_reset(block);
+    }
+
+    // Farms parsed before an error are still reported
+    return block->num_farms > 0 || block->rejected_farms > 0;
+}
+
+// When bad rows are set aside, a run still fails if more than
+// max_error_rate of the data rows were rejected
+static int within_error_budget(const BatchOptions *options, const BatchStats *stats) {
+    if (options->skip_invalid && stats->rows_read > 0 &&
+        (double)stats->rows_rejected > options->max_error_rate * (double)stats->rows_read) {
+        printf("Error: %ld of %ld rows rejected (%.4f%%), more than the allowed %.4f%%\n",
+               stats->rows_rejected, stats->rows_read,
+               100.0 * (double)stats->rows_rejected / (double)stats->rows_read,
+               100.0 * options->max_error_rate);
+        return 0;
+    }
+    return 1;
+}
+
+// Streams a multi-crop CSV file through the column kernel. Rows are grouped
+// by farm_id as they are read into blocks of BATCH_BLOCK_FARMS farms, which
+// flow through the read -> compute -> write pipeline (compute in parallel
+// with --threads) and are written in input order, so memory use is bounded
+// by the blocks in flight regardless of file size. With options->rollup the
+// crop results are also totalled by group and printed after the farm lines.
+int run_multi_crop_batch(const BatchOptions *options, BatchStats *stats) {
+    FarmReadContext ctx;
+    FarmWriteContext write_ctx = {options->output, options->quarantine, options->report, NULL, NULL, NULL, NULL, 1};
+    Rollup rollup;
+    ResultStore store;
+    BatchStats local = {0};
+    if (!stats) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    if (!multi_crop_csv_open(&ctx.csv, options->input_path)) {
+        return 0;
+    }
+    ctx.csv.keep_going = options->skip_invalid;
+    ctx.quarantine = options->quarantine != NULL;
+    if (options->quarantine) {
+        write_quarantine_header(options->quarantine, &ctx.csv.reader.row);
+    }
+
+    int num_blocks = pipeline_blocks(options);
+    void **blocks = allocate_blocks(sizeof(FarmBlock), num_blocks);
+    if (!blocks) {
+        printf("Error: Out of memory\n");
+        multi_crop_csv_close(&ctx.csv);
+        return 0;
+    }
+
+    // Every block gets its own partial rollup, so workers never share sums
+    int rollup_ok = !options->rollup || rollup_init(&rollup, options->rollup, options->sum_mode, 0);
+    for (int i = 0; i < num_blocks; i++) {
+        FarmBlock *block = blocks[i];
+        block->format_lines = options->farm_lines;
+        block->format = options->format;
+        block->per_crop = options->per_crop;
+        block->stop_on_invalid = !options->skip_invalid;
+        block->write_reports = options->report != NULL;
+        if (options->rollup && rollup_ok) {
+            rollup_ok = rollup_init(&block->rollup, options->rollup, options->sum_mode, 1);
+        }
+    }
+    if (!rollup_ok) {
+        printf("Error: Out of memory\n");
+        if (options->rollup) rollup_free(&rollup);
+        free_blocks(blocks, num_blocks, free_farm_block);
+        multi_crop_csv_close(&ctx.csv);
+        return 0;
+    }
+    if (options->rollup) {
+        write_ctx.rollup = &rollup;
+    }
+    if (options->binary_path) {
+        if (!result_store_create(&store, options->binary_path, options->binary_dictionary)) {
+            printf("Error: Cannot create binary result file %s\n", options->binary_path);
+            if (options->rollup) rollup_free(&rollup);
+            free_blocks(blocks, num_blocks, free_farm_block);
+            multi_crop_csv_close(&ctx.csv);
+            return 0;
+        }
+        write_ctx.store = &store;
+    }
+
+    memset(&ctx.crops, 0, sizeof(ctx.crops));
+    ctx.stats = stats;
+    ctx.reading = 1;
+    ctx.stop = 0;
+    ctx.ok = 1;
+    write_ctx.stats = stats;
+    write_ctx.stop_reading = &ctx.stop;
+
+    PipelineStages stages = {
+        read_farm_block, compute_farm_block, write_farm_block, &ctx, &write_ctx
+    };
+    if (options->farm_lines) {
+        write_output_header(options);
+    }
+    if (run_pipeline(&stages, blocks, num_blocks, options->threads) < 0) {
+        ctx.ok = 0;
+    }
+
+    if (options->rollup) {
+        if (ctx.ok && write_ctx.ok) {
+            print_rollup(options->output, &rollup);
+        }
+        rollup_free(&rollup);
+    }
+    // The binary file is only completed for a run that succeeded
+    int ok = ctx.ok && write_ctx.ok && within_error_budget(options, stats);
+    if (options->binary_path && !result_store_close(&store, ok) && ok) {
+        printf("Error: Could not write the binary result file\n");
+        ok = 0;
+    }
+    free_blocks(blocks, num_blocks, free_farm_block);
+    crop_arena_free(&ctx.crops);
+    multi_crop_csv_close(&ctx.csv);
+    return ok;
+}
+
+// Prints the full report for every farm in a multi-crop CSV file. Farms may
+// have any number of crops. The last farm and its results are kept in last
+// (release with farm_report_free) so callers can save them. Returns the
+// number of farms reported, or -1 if the file could not be processed.
+int report_multi_crop_file(const char *filename, FarmReport *last) {
+    MultiCropCsv csv;
+    memset(last, 0, sizeof(*last));
+    if (!multi_crop_csv_open(&csv, filename)) {
+        return -1;
+    }
+
+    int count = 0;
+    int status;
+    while (1) {
+        crop_arena_reset(&last->crops);
+        status = multi_crop_csv_next_farm(&csv, &last->crops, &last->farm);
+        if (status <= 0) {
+            break;
+        }
+        if (!validate_farm_record(&last->farm, last->crops.rows)) {
+            printf("Error: Validation failed for farm %s\n", csv.farm_id);
+            status = -1;
+            break;
+        }
+
+        size_t needed = (size_t)last->farm.num_crops;
+        if (needed > last->crop_results_capacity) {
+            CropEmissionResults *crop_results = realloc(last->crop_results, needed * sizeof(CropEmissionResults));
+            if (!crop_results) {
+                printf("Error: Out of memory\n");
+                status = -1;
+                break;
+            }
+            last->crop_results = crop_results;
+            last->crop_results_capacity = needed;
+        }
+
+        calculate_farm_record_emissions(&last->farm, last->crops.rows, &last->results, last->crop_results);
+        printf("\nFarm ID: %s\n", csv.farm_id);
+        print_farm_record_report(&last->farm, &last->results, last->crop_results);
+        count++;
+    }
+
+    multi_crop_csv_close(&csv);
+    if (status < 0) {
+        return -1;
+    }
+    if (count == 0) {
+        printf("Error: No data found in CSV file\n");
+        return -1;
+    }
+    return count;
+}
+
+void farm_report_free(FarmReport *report) {
+    crop_arena_free(&report->crops);
+    free(report->crop_results);
+    memset(report, 0, sizeof(*report));
+}
+
+// Picks the legacy or multi-crop engine from the file's header. When bad
+// rows are set aside, the run still fails if more than max_error_rate of
+// the data rows were rejected (the multi-crop engine checks this itself,
+// before it completes the binary result file).
+int run_batch(const BatchOptions *options, BatchStats *stats) {
+    BatchStats local = {0};
+    int ok;
+
+    if (!stats) {
+        stats = &local;
+    }
+    if (is_multi_crop_csv(options->input_path)) {
+        ok = run_multi_crop_batch(options, stats);
+    } else if (options->rollup) {
+        printf("Error: Rollups need a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    } else if (options->binary_path) {
+        printf("Error: Binary results need a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    } else {
+        ok = run_legacy_batch(options, stats) && within_error_budget(options, stats);
+    }
+    return ok;
+}
@@ -0,0 +1,186 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "input.h"
+#include "compute.h"
+#include "compute_batch.h"
+#include "arena.h"
+#include "rollup.h"
+#include "validator.h"
+#include "report_writer.h"
+#include "result_sink.h"
+#include "result_store.h"
+
+// Number of farms parsed before the column kernel evaluates them together
+#define BATCH_BLOCK_FARMS 256
+
+// Number of legacy rows per block
+#define BATCH_LEGACY_BLOCK_ROWS 1024
+
+// Blocks in flight per worker thread; more blocks smooth out uneven farms
+#define BATCH_BLOCKS_PER_THREAD 4
+
+// Batch processing options
+typedef struct {
+    const char *input_path;     // CSV file to stream
+    FILE *output;               // destination for per-farm results
+    int threads;                // worker threads (1 = evaluate on the caller's thread)
+    unsigned rollup;            // RollupDimension bits to total by (0 = none)
+    SumMode sum_mode;           // how rollup totals are summed
+    int farm_lines;             // print one result line per farm
+    ResultFormat format;        // layout of those lines
+    int per_crop;               // with CSV or JSON Lines, one line per crop instead
+    int skip_invalid;           // set bad rows and invalid farms aside instead of stopping
+    const char *quarantine_path;    // opened by the caller into quarantine
+    FILE *quarantine;           // with skip_invalid, where rejected rows are copied (NULL = nowhere)
+    double max_error_rate;      // with skip_invalid, share of rows that may be rejected
+    const char *report_path;    // opened by the caller into report
+    int report_append;          // add to the report file instead of replacing it
+    ReportWriter *report;       // full report of every farm (NULL = none)
+    const char *binary_path;    // binary columnar file of every crop result (NULL = none)
+    int binary_dictionary;      // dictionary encode its crop and pesticide ids
+} BatchOptions;
+
+// Growable text buffer each block formats its output lines into, so blocks
+// evaluated on different threads can be written out in input order
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;                 // set when text could not be added
+} TextBuffer;
+
+// Counters collected while streaming a batch file
+typedef struct {
+    long rows_read;             // data rows seen (header excluded)
+    long farms_processed;       // rows that produced a result
+    long farms_skipped;         // invalid farms dropped with skip_invalid
+    long rows_rejected;         // their data rows
+} BatchStats;
+
+// A farm the multi-crop reader set aside: it came just before the block's
+// farm number farm, and its quarantine rows end at offset end of the
+// block's reader_quarantine text
+typedef struct {
+    size_t farm;
+    size_t end;
+} ReaderReject;
+
+// A block of parsed multi-crop farms. Farm IDs, crop rows, the kernel's
+// input columns and its per-crop results are carved from the block's arena,
+// so a block of any size costs no per-farm allocations and is released in
+// one step by farm_block_reset().
+typedef struct {
+    Arena arena;
+    size_t num_farms;
+    size_t num_rows;
+
+    // Farm columns
+    const char *farm_id[BATCH_BLOCK_FARMS];
+    const CropData *farm_rows[BATCH_BLOCK_FARMS];
+    const CsvRow *farm_source[BATCH_BLOCK_FARMS];   // raw rows, kept for the quarantine
+    size_t crop_start[BATCH_BLOCK_FARMS + 1];
+    double total_farm_size[BATCH_BLOCK_FARMS];
+    int dairy_cows[BATCH_BLOCK_FARMS];
+    int pigs[BATCH_BLOCK_FARMS];
+    int chickens[BATCH_BLOCK_FARMS];
+    int factor_set[BATCH_BLOCK_FARMS];
+
+    // Crop row columns, num_rows entries each (set up by farm_block_finish)
+    int *crop_id;
+    double *area;
+    double *nitrogen_kg_ha;
+    double *phosphorus_kg_ha;
+    double *potassium_kg_ha;
+    double *manure_kg_ha;
+    double *diesel_l_ha;
+    double *irrigation_mm;
+    double *pesticide_rate;
+    int *pesticide_id;
+
+    // Validator outputs: per-row error bits (set up by farm_block_finish)
+    // and per-farm bits including those of the farm's rows
+    uint32_t *row_errors;
+    uint32_t farm_errors[BATCH_BLOCK_FARMS];
+
+    // Kernel outputs
+    double *crop_emissions[7];
+    double farm_emissions[8][BATCH_BLOCK_FARMS];
+
+    TextBuffer output;          // table lines
+    ReportWriter records;       // CSV or JSON Lines records (a memory writer)
+    ResultFormat format;
+    int per_crop;
+    int gathered;               // row columns filled from the farm rows
+    int stop_on_invalid;        // drop everything from the first invalid farm on
+    size_t invalid_farms;       // farms dropped by farm_block_validate()
+    const char *invalid_id;     // the first invalid farm, kept for its message
+    FarmRecord invalid_farm;    // (its crops are invalid_rows[0..num_crops))
+    const CropData *invalid_rows;
+    size_t rejected_farms;      // farms set aside, by the reader or the validator
+    size_t rejected_rows;       // their data rows
+    TextBuffer quarantine;      // rejected rows in quarantine file format, in input order
+    TextBuffer reader_quarantine; // rows the reader set aside, merged into quarantine
+    ReaderReject *reader_rejects; // by farm_block_validate() in input order
+    size_t num_reader_rejects;
+    size_t reader_reject_capacity;
+    int write_reports;          // format each farm's full report into reports
+    ReportWriter reports;       // (a memory writer)
+    int format_lines;           // format a result line per farm
+    Rollup rollup;              // the block's partial group sums (no dimensions = off)
+    int rolled_up;              // 0 if the partial could not be computed
+} FarmBlock;
+
+// A block of parsed legacy single-crop rows
+typedef struct {
+    size_t num_farms;
+    long row_number[BATCH_LEGACY_BLOCK_ROWS];   // 1-based data row of each farm
+    LegacyFarmData farms[BATCH_LEGACY_BLOCK_ROWS];
+    TextBuffer output;          // table lines
+    ReportWriter records;       // CSV or JSON Lines records (a memory writer)
+    ResultFormat format;
+    int per_crop;
+    TextBuffer quarantine;      // rows the reader set aside
+    int write_reports;          // format each farm's full report into reports
+    ReportWriter reports;       // (a memory writer)
+} LegacyBlock;
+
+// The farm printed last by report_multi_crop_file(), kept so callers can
+// save it; its crop results are sized to the farm
+typedef struct {
+    FarmRecord farm;
+    CropArena crops;
+    EmissionResults results;
+    CropEmissionResults *crop_results;
+    size_t crop_results_capacity;
+} FarmReport;
+
+// Function declarations
+int run_batch(const BatchOptions *options, BatchStats *stats);
+int run_legacy_batch(const BatchOptions *options, BatchStats *stats);
+int run_multi_crop_batch(const BatchOptions *options, BatchStats *stats);
+int report_multi_crop_file(const char *filename, FarmReport *last);
+void farm_report_free(FarmReport *report);
+void write_batch_header(FILE *out);
+void write_quarantine_header(FILE *out, const CsvRow *header);
+void format_quarantine_row(TextBuffer *buffer, const CsvRow *row, const char *field, const char *reason);
+void text_buffer_printf(TextBuffer *buffer, const char *format, ...);
+void text_buffer_reset(TextBuffer *buffer);
+void text_buffer_free(TextBuffer *buffer);
+void farm_block_reset(FarmBlock *block);
+int farm_block_add(FarmBlock *block, const char *farm_id, size_t farm_id_length, const FarmRecord *farm,
+                   const CropData *rows, const CsvRow *source);
+int farm_block_finish(FarmBlock *block);
+void farm_block_free(FarmBlock *block);
+size_t farm_block_validate(FarmBlock *block);
+void farm_block_evaluate(FarmBlock *block);
+void farm_block_results(const FarmBlock *block, size_t farm, EmissionTotals *results);
+int farm_block_rollup(const FarmBlock *block, Rollup *rollup);
+void format_farm_block(FarmBlock *block);
+void format_farm_reports(FarmBlock *block);
+void format_farm_records(FarmBlock *block);
+void format_legacy_block(LegacyBlock *block);
+
+#endif
@@ -2,60 +2,132 @@
 #include <math.h>
 #include "compute.h"
 
+EmissionFactors emission_factors = {
+    NITROGEN_FACTOR, PHOSPHORUS_FACTOR, POTASSIUM_FACTOR,
+    MANURE_FACTOR, DIESEL_FACTOR, IRRIGATION_FACTOR,
+    COW_FACTOR, PIG_FACTOR, CHICKEN_FACTOR
+};
+
+static const FactorRegion default_region = {"default"};
+static const int default_year = 0;
+
+FactorTable factor_table = {&default_region, &default_year, &emission_factors, 1, 1, 0};
+
+// By-value wrapper kept for the interactive paths and reports
 EmissionResults calculate_emissions(const FarmData *farm) {
     EmissionResults results = {0};
+    EmissionTotals totals;
+
+    calculate_emissions_into(farm, &totals, results.crop_results);
+    emission_results_from_totals(&results, &totals);
+    results.num_crops = farm->num_crops;
+    return results;
+}
+
+// Calculates into caller-provided storage. crop_results receives the
+// per-crop breakdown (num_crops entries) or may be NULL for totals only.
+void calculate_emissions_into(const FarmData *farm, EmissionTotals *totals, CropEmissionResults *crop_results) {
+    FarmRecord record;
+
+    farm_record_from_farm_data(farm, &record);
+    calculate_farm_record_totals(&record, farm->crops, totals, crop_results);
+}
+
+// Calculates a farm with any number of crops, writing per-crop results to
+// crop_results (which must hold num_crops entries)
+void calculate_farm_record_emissions(const FarmRecord *farm, const CropData *rows,
+                                     EmissionResults *results, CropEmissionResults *crop_results) {
+    EmissionTotals totals;
+
+    calculate_farm_record_totals(farm, rows, &totals, crop_results);
+    emission_results_from_totals(results, &totals);
+    results->num_crops = farm->num_crops;
+}
+
+void emission_results_from_totals(EmissionResults *results, const EmissionTotals *totals) {
+    results->fertilizer_emissions = totals->fertilizer_emissions;
+    results->manure_emissions = totals->manure_emissions;
+    results->fuel_emissions = totals->fuel_emissions;
+    results->irrigation_emissions = totals->irrigation_emissions;
+    results->pesticide_emissions = totals->pesticide_emissions;
+    results->livestock_emissions = totals->livestock_emissions;
+    results->total_emissions = totals->total_emissions;
+    results->per_hectare_emissions = totals->per_hectare_emissions;
+}
+
+// Fills the input-driven categories of one crop (fertilizer to pesticide,
+// plus crop_id and area); livestock allocation and the crop total depend
+// on the whole farm and are left to the caller
+void calculate_crop_categories(const CropData *crop, const EmissionFactors *factors,
+                               CropEmissionResults *crop_result) {
+    crop_result->crop_id = crop->crop_id;
+    crop_result->area = crop->area;
+    
+    // Fertilizer emissions (convert kg to tonnes)
+    double nitrogen_emissions = crop->nitrogen_kg_ha * crop->area * factors->nitrogen / 1000.0;
+    double phosphorus_emissions = crop->phosphorus_kg_ha * crop->area * factors->phosphorus / 1000.0;
+    double potassium_emissions = crop->potassium_kg_ha * crop->area * factors->potassium / 1000.0;
+    crop_result->fertilizer_emissions = nitrogen_emissions + phosphorus_emissions + potassium_emissions;
+    
+    // Manure emissions (convert kg to tonnes)
+    crop_result->manure_emissions = crop->manure_kg_ha * crop->area * factors->manure / 1000.0;
+    
+    // Fuel emissions (convert kg to tonnes)
+    crop_result->fuel_emissions = crop->diesel_l_ha * crop->area * factors->diesel / 1000.0;
+    
+    // Irrigation emissions (convert mm to m³/ha, then kg to tonnes)
+    // 1 mm = 10 m³/ha
+    double irrigation_m3_ha = crop->irrigation_mm * 10.0;
+    crop_result->irrigation_emissions = irrigation_m3_ha * crop->area * factors->irrigation / 1000.0;
+    
+    // Pesticide emissions (convert kg to tonnes)
+    if (crop->pesticide_id >= 0 && crop->pesticide_rate > 0) {
+        crop_result->pesticide_emissions = crop->pesticide_rate * crop->area * 
+                                         pesticides[crop->pesticide_id].ef / 1000.0;
+    } else {
+        crop_result->pesticide_emissions = 0.0;
+    }
+}
+
+// Core calculation for a farm whose crops are rows[crop_offset..]. With
+// crop_results NULL each crop is evaluated in a scratch slot and only the
+// totals are kept; the totals are identical either way.
+void calculate_farm_record_totals(const FarmRecord *farm, const CropData *rows,
+                                  EmissionTotals *totals, CropEmissionResults *crop_results) {
+    const CropData *farm_crops = rows + farm->crop_offset;
+    const EmissionFactors factors = factor_table.sets[farm->factor_set];
+    CropEmissionResults scratch;
+
+    totals->fertilizer_emissions = 0.0;
+    totals->manure_emissions = 0.0;
+    totals->fuel_emissions = 0.0;
+    totals->irrigation_emissions = 0.0;
+    totals->pesticide_emissions = 0.0;
     
     // Calculate livestock emissions first (to be allocated proportionally)
-    double cow_emissions = farm->dairy_cows * COW_FACTOR / 1000.0;
-    double pig_emissions = farm->pigs * PIG_FACTOR / 1000.0;
-    double chicken_emissions = farm->chickens * CHICKEN_FACTOR / 1000.0;
-    results.livestock_emissions = cow_emissions + pig_emissions + chicken_emissions;
+    double cow_emissions = farm->dairy_cows * factors.cow / 1000.0;
+    double pig_emissions = farm->pigs * factors.pig / 1000.0;
+    double chicken_emissions = farm->chickens * factors.chicken / 1000.0;
+    totals->livestock_emissions = cow_emissions + pig_emissions + chicken_emissions;
     
     // Calculate per-crop emissions
-    results.num_crops = farm->num_crops;
     double total_crop_area = 0.0;
     
     // First pass: calculate total crop area
     for (int i = 0; i < farm->num_crops; i++) {
-        total_crop_area += farm->crops[i].area;
+        total_crop_area += farm_crops[i].area;
     }
     
     // Second pass: calculate emissions per crop
     for (int i = 0; i < farm->num_crops; i++) {
-        CropEmissionResults *crop_result = &results.crop_results[i];
-        const CropData *crop = &farm->crops[i];
+        CropEmissionResults *crop_result = crop_results ? &crop_results[i] : &scratch;
+        const CropData *crop = &farm_crops[i];
         
-        crop_result->crop_id = crop->crop_id;
-        crop_result->area = crop->area;
-        
-        // Fertilizer emissions (convert kg to tonnes)
-        double nitrogen_emissions = crop->nitrogen_kg_ha * crop->area * NITROGEN_FACTOR / 1000.0;
-        double phosphorus_emissions = crop->phosphorus_kg_ha * crop->area * PHOSPHORUS_FACTOR / 1000.0;
-        double potassium_emissions = crop->potassium_kg_ha * crop->area * POTASSIUM_FACTOR / 1000.0;
-        crop_result->fertilizer_emissions = nitrogen_emissions + phosphorus_emissions + potassium_emissions;
-        
-        // Manure emissions (convert kg to tonnes)
-        crop_result->manure_emissions = crop->manure_kg_ha * crop->area * MANURE_FACTOR / 1000.0;
-        
-        // Fuel emissions (convert kg to tonnes)
-        crop_result->fuel_emissions = crop->diesel_l_ha * crop->area * DIESEL_FACTOR / 1000.0;
-        
-        // Irrigation emissions (convert mm to m³/ha, then kg to tonnes)
-        // 1 mm = 10 m³/ha
-        double irrigation_m3_ha = crop->irrigation_mm * 10.0;
-        crop_result->irrigation_emissions = irrigation_m3_ha * crop->area * IRRIGATION_FACTOR / 1000.0;
-        
-        // Pesticide emissions (convert kg to tonnes)
-        if (crop->pesticide_id >= 0 && crop->pesticide_rate > 0) {
-            crop_result->pesticide_emissions = crop->pesticide_rate * crop->area * 
-                                             pesticides[crop->pesticide_id].ef / 1000.0;
-        } else {
-            crop_result->pesticide_emissions = 0.0;
-        }
+        calculate_crop_categories(crop, &factors, crop_result);
         
         // Allocate livestock emissions proportionally by area
         if (total_crop_area > 0) {
-            crop_result->livestock_emissions = results.livestock_emissions * (crop->area / total_crop_area);
+            crop_result->livestock_emissions = totals->livestock_emissions * (crop->area / total_crop_area);
         } else {
             crop_result->livestock_emissions = 0.0;
         }
@@ -69,58 +141,68 @@ EmissionResults calculate_emissions(const FarmData *farm) {
                                      crop_result->livestock_emissions;
         
         // Add to farm totals
-        results.fertilizer_emissions += crop_result->fertilizer_emissions;
-        results.manure_emissions += crop_result->manure_emissions;
-        results.fuel_emissions += crop_result->fuel_emissions;
-        results.irrigation_emissions += crop_result->irrigation_emissions;
-        results.pesticide_emissions += crop_result->pesticide_emissions;
+        totals->fertilizer_emissions += crop_result->fertilizer_emissions;
+        totals->manure_emissions += crop_result->manure_emissions;
+        totals->fuel_emissions += crop_result->fuel_emissions;
+        totals->irrigation_emissions += crop_result->irrigation_emissions;
+        totals->pesticide_emissions += crop_result->pesticide_emissions;
     }
     
     // Calculate farm totals
-    results.total_emissions = results.fertilizer_emissions + 
-                             results.manure_emissions + 
-                             results.fuel_emissions + 
-                             results.irrigation_emissions + 
-                             results.pesticide_emissions + 
-                             results.livestock_emissions;
+    totals->total_emissions = totals->fertilizer_emissions + 
+                              totals->manure_emissions + 
+                              totals->fuel_emissions + 
+                              totals->irrigation_emissions + 
+                              totals->pesticide_emissions + 
+                              totals->livestock_emissions;
     
     if (farm->total_farm_size > 0) {
-        results.per_hectare_emissions = results.total_emissions / farm->total_farm_size;
+        totals->per_hectare_emissions = totals->total_emissions / farm->total_farm_size;
     } else {
-        results.per_hectare_emissions = 0.0;
+        totals->per_hectare_emissions = 0.0;
     }
-    
-    return results;
 }
 
+// By-value wrapper; legacy farms have no per-crop breakdown
 EmissionResults calculate_legacy_emissions(const LegacyFarmData *farm) {
     EmissionResults results = {0};
+    EmissionTotals totals;
+
+    calculate_legacy_emissions_into(farm, &totals);
+    emission_results_from_totals(&results, &totals);
+    results.num_crops = 0; // Legacy mode doesn't track individual crops
+    return results;
+}
+
+void calculate_legacy_emissions_into(const LegacyFarmData *farm, EmissionTotals *totals) {
+    const EmissionFactors factors = emission_factors;
+    EmissionTotals results = {0};
     
     // Calculate fertilizer emissions (convert kg to tonnes)
-    double nitrogen_emissions = farm->nitrogen_kg_ha * farm->farm_size * NITROGEN_FACTOR / 1000.0;
-    double phosphorus_emissions = farm->phosphorus_kg_ha * farm->farm_size * PHOSPHORUS_FACTOR / 1000.0;
-    double potassium_emissions = farm->potassium_kg_ha * farm->farm_size * POTASSIUM_FACTOR / 1000.0;
+    double nitrogen_emissions = farm->nitrogen_kg_ha * farm->farm_size * factors.nitrogen / 1000.0;
+    double phosphorus_emissions = farm->phosphorus_kg_ha * farm->farm_size * factors.phosphorus / 1000.0;
+    double potassium_emissions = farm->potassium_kg_ha * farm->farm_size * factors.potassium / 1000.0;
     
     results.fertilizer_emissions = nitrogen_emissions + phosphorus_emissions + potassium_emissions;
     
     // Calculate manure emissions (convert kg to tonnes)
-    results.manure_emissions = farm->manure_kg_ha * farm->farm_size * MANURE_FACTOR / 1000.0;
+    results.manure_emissions = farm->manure_kg_ha * farm->farm_size * factors.manure / 1000.0;
     
     // Calculate fuel emissions (convert kg to tonnes)
-    results.fuel_emissions = farm->diesel_l_ha * farm->farm_size * DIESEL_FACTOR / 1000.0;
+    results.fuel_emissions = farm->diesel_l_ha * farm->farm_size * factors.diesel / 1000.0;
     
     // Calculate irrigation emissions (convert mm to m³/ha, then kg to tonnes)
     // 1 mm = 10 m³/ha
     double irrigation_m3_ha = farm->irrigation_mm * 10.0;
-    results.irrigation_emissions = irrigation_m3_ha * farm->farm_size * IRRIGATION_FACTOR / 1000.0;
+    results.irrigation_emissions = irrigation_m3_ha * farm->farm_size * factors.irrigation / 1000.0;
     
     // No pesticide emissions in legacy mode
     results.pesticide_emissions = 0.0;
     
     // Calculate livestock emissions (convert kg to tonnes)
-    double cow_emissions = farm->dairy_cows * COW_FACTOR / 1000.0;
-    double pig_emissions = farm->pigs * PIG_FACTOR / 1000.0;
-    double chicken_emissions = farm->chickens * CHICKEN_FACTOR / 1000.0;
+    double cow_emissions = farm->dairy_cows * factors.cow / 1000.0;
+    double pig_emissions = farm->pigs * factors.pig / 1000.0;
+    double chicken_emissions = farm->chickens * factors.chicken / 1000.0;
     
     results.livestock_emissions = cow_emissions + pig_emissions + chicken_emissions;
     
@@ -133,7 +215,6 @@ EmissionResults calculate_legacy_emissions(const LegacyFarmData *farm) {
                              results.livestock_emissions;
     
     results.per_hectare_emissions = results.total_emissions / farm->farm_size;
-    results.num_crops = 0; // Legacy mode doesn't track individual crops
-    
-    return results;
+
+    *totals = results;
 }
\ No newline at end of file
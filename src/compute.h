@@ -3,7 +3,8 @@
 
 #include "input.h"
 
-// Emission factors (kg CO2e)
+// Default emission factors (kg CO2e); a factor pack can replace them at
+// startup (see factors.h), so calculations read emission_factors instead
 #define NITROGEN_FACTOR 6.3     // kg CO2e per kg N
 #define PHOSPHORUS_FACTOR 1.5   // kg CO2e per kg P2O5
 #define POTASSIUM_FACTOR 1.0    // kg CO2e per kg K2O
@@ -14,6 +15,44 @@
 #define PIG_FACTOR 200.0        // kg CO2e per pig per year
 #define CHICKEN_FACTOR 5.0      // kg CO2e per chicken per year
 
+// Emission factors in effect (kg CO2e per unit, as above)
+typedef struct {
+    double nitrogen;            // per kg N
+    double phosphorus;          // per kg P2O5
+    double potassium;           // per kg K2O
+    double manure;              // per kg manure
+    double diesel;              // per liter
+    double irrigation;          // per m³
+    double cow;                 // per cow per year
+    double pig;                 // per pig per year
+    double chicken;             // per chicken per year
+} EmissionFactors;
+
+// Longest region name in a factor table, including the terminator
+#define FACTOR_REGION_NAME_MAX 32
+
+typedef struct {
+    char name[FACTOR_REGION_NAME_MAX];
+} FactorRegion;
+
+// Emission factor sets by region and refinement year, stored densely and
+// region-major: the set for region r and year index y is
+// sets[r * num_years + y]. Farms carry that index (FarmRecord.factor_set),
+// resolved once when the farm is read, so the calculations never look up a
+// region by name. Region 0 is the base set; without a factor pack the table
+// is the single set emission_factors.
+typedef struct {
+    const FactorRegion *regions;
+    const int *years;               // ascending; years[0] = 0 is the base column
+    const EmissionFactors *sets;
+    int num_regions;
+    int num_years;
+    int default_set;                // base region, latest year
+} FactorTable;
+
+extern EmissionFactors emission_factors;   // copy of the default set
+extern FactorTable factor_table;
+
 // Per-crop emission results
 typedef struct {
     int crop_id;
@@ -27,6 +66,19 @@ typedef struct {
     double total_emissions;        // tonnes CO2e
 } CropEmissionResults;
 
+// Farm totals only (64 bytes), for callers that do not need the per-crop
+// breakdown carried by EmissionResults
+typedef struct {
+    double fertilizer_emissions;   // tonnes CO2e
+    double manure_emissions;       // tonnes CO2e
+    double fuel_emissions;         // tonnes CO2e
+    double irrigation_emissions;   // tonnes CO2e
+    double pesticide_emissions;    // tonnes CO2e
+    double livestock_emissions;    // tonnes CO2e
+    double total_emissions;        // tonnes CO2e
+    double per_hectare_emissions;  // tonnes CO2e per hectare
+} EmissionTotals;
+
 typedef struct {
     double fertilizer_emissions;   // tonnes CO2e
     double manure_emissions;       // tonnes CO2e
@@ -37,11 +89,20 @@ typedef struct {
     double total_emissions;        // tonnes CO2e
     double per_hectare_emissions;  // tonnes CO2e per hectare
     int num_crops;
-    CropEmissionResults crop_results[10];  // per-crop breakdown
+    CropEmissionResults crop_results[MAX_CROPS];  // per-crop breakdown (calculate_emissions only)
 } EmissionResults;
 
 // Function declarations
 EmissionResults calculate_emissions(const FarmData *farm);
 EmissionResults calculate_legacy_emissions(const LegacyFarmData *farm);
+void calculate_emissions_into(const FarmData *farm, EmissionTotals *totals, CropEmissionResults *crop_results);
+void calculate_legacy_emissions_into(const LegacyFarmData *farm, EmissionTotals *totals);
+void calculate_crop_categories(const CropData *crop, const EmissionFactors *factors,
+                               CropEmissionResults *crop_result);
+void calculate_farm_record_totals(const FarmRecord *farm, const CropData *rows,
+                                  EmissionTotals *totals, CropEmissionResults *crop_results);
+void calculate_farm_record_emissions(const FarmRecord *farm, const CropData *rows,
+                                     EmissionResults *results, CropEmissionResults *crop_results);
+void emission_results_from_totals(EmissionResults *results, const EmissionTotals *totals);
 
 #endif
\ No newline at end of file
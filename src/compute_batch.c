@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "compute_batch.h"
+#include "compute_simd.h"
+
+// Arithmetic sweep over the crop rows. Kept separate with restrict-qualified
+// parameters so the compiler can prove the columns do not alias and
+// vectorize the loop. On entry pesticide holds the emission factor per row.
+static void crop_category_sweep(size_t num_rows, EmissionFactors factors,
+                                const double *restrict area,
+                                const double *restrict nitrogen,
+                                const double *restrict phosphorus,
+                                const double *restrict potassium,
+                                const double *restrict manure,
+                                const double *restrict diesel,
+                                const double *restrict irrigation,
+                                const double *restrict pesticide_rate,
+                                double *restrict fertilizer_out,
+                                double *restrict manure_out,
+                                double *restrict fuel_out,
+                                double *restrict irrigation_out,
+                                double *restrict pesticide_out) {
+    for (size_t i = 0; i < num_rows; i++) {
+        // Fertilizer emissions (convert kg to tonnes)
+        double nitrogen_emissions = nitrogen[i] * area[i] * factors.nitrogen / 1000.0;
+        double phosphorus_emissions = phosphorus[i] * area[i] * factors.phosphorus / 1000.0;
+        double potassium_emissions = potassium[i] * area[i] * factors.potassium / 1000.0;
+        fertilizer_out[i] = nitrogen_emissions + phosphorus_emissions + potassium_emissions;
+
+        manure_out[i] = manure[i] * area[i] * factors.manure / 1000.0;
+        fuel_out[i] = diesel[i] * area[i] * factors.diesel / 1000.0;
+
+        // 1 mm = 10 m³/ha
+        double irrigation_m3_ha = irrigation[i] * 10.0;
+        irrigation_out[i] = irrigation_m3_ha * area[i] * factors.irrigation / 1000.0;
+
+        // A zero factor yields exactly 0.0 for validated (non-negative) inputs
+        pesticide_out[i] = pesticide_rate[i] * area[i] * pesticide_out[i] / 1000.0;
+    }
+}
+
+// Portable per-row kernel.
+//
+// Each expression is evaluated in exactly the same order as in
+// calculate_emissions(), so results are bit-for-bit identical to the scalar
+// path. The pesticide factor lookup is done in a separate pass, which leaves
+// the main sweep free of gathers and branches.
+void calculate_crop_columns_scalar(const CropColumns *in, size_t num_rows, CropEmissionColumns *out) {
+    // Gather pass: pesticide emission factor per row (0 if none applied)
+    for (size_t i = 0; i < num_rows; i++) {
+        int id = in->pesticide_id[i];
+        out->pesticide[i] = (id >= 0 && in->pesticide_rate[i] > 0) ? pesticides[id].ef : 0.0;
+    }
+
+    crop_category_sweep(num_rows, *in->factors, in->area, in->nitrogen_kg_ha, in->phosphorus_kg_ha,
+                        in->potassium_kg_ha, in->manure_kg_ha, in->diesel_l_ha,
+                        in->irrigation_mm, in->pesticide_rate,
+                        out->fertilizer, out->manure, out->fuel, out->irrigation, out->pesticide);
+}
+
+typedef void (*CropColumnsKernel)(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+
+static const char *kernel_names[KERNEL_COUNT] = {"scalar", "sse2", "avx2", "avx512"};
+
+static CropColumnsKernel kernel_function(KernelVariant variant) {
+    switch (variant) {
+#ifdef CARBON_X86_SIMD
+        case KERNEL_SSE2: return crop_columns_sse2;
+        case KERNEL_AVX2: return crop_columns_avx2;
+        case KERNEL_AVX512: return crop_columns_avx512;
+#endif
+        default: return calculate_crop_columns_scalar;
+    }
+}
+
+static int active_kernel = -1;
+
+const char *kernel_variant_name(KernelVariant variant) {
+    return (variant >= 0 && variant < KERNEL_COUNT) ? kernel_names[variant] : "unknown";
+}
+
+// Uses cpuid (via the compiler's CPU feature builtins, which also check that
+// the OS saves the wider registers) to report whether a variant can run here.
+int kernel_variant_supported(KernelVariant variant) {
+    switch (variant) {
+        case KERNEL_SCALAR:
+            return 1;
+#ifdef CARBON_X86_SIMD
+        case KERNEL_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case KERNEL_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+        case KERNEL_AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return 0;
+    }
+}
+
+// Best supported variant, unless CARBON_KERNEL names another supported one
+KernelVariant detect_kernel_variant(void) {
+    const char *forced = getenv("CARBON_KERNEL");
+    if (forced) {
+        for (int v = 0; v < KERNEL_COUNT; v++) {
+            if (strcmp(forced, kernel_names[v]) == 0 && kernel_variant_supported((KernelVariant)v)) {
+                return (KernelVariant)v;
+            }
+        }
+    }
+
+    for (int v = KERNEL_COUNT - 1; v > KERNEL_SCALAR; v--) {
+        if (kernel_variant_supported((KernelVariant)v)) {
+            return (KernelVariant)v;
+        }
+    }
+    return KERNEL_SCALAR;
+}
+
+// Batch workers may race to detect the variant; they all store the same value
+KernelVariant get_kernel_variant(void) {
+    int variant = __atomic_load_n(&active_kernel, __ATOMIC_RELAXED);
+    if (variant < 0) {
+        variant = detect_kernel_variant();
+        __atomic_store_n(&active_kernel, variant, __ATOMIC_RELAXED);
+    }
+    return (KernelVariant)variant;
+}
+
+int set_kernel_variant(KernelVariant variant) {
+    if (!kernel_variant_supported(variant)) {
+        return 0;
+    }
+    __atomic_store_n(&active_kernel, (int)variant, __ATOMIC_RELAXED);
+    return 1;
+}
+
+void calculate_crop_columns_variant(KernelVariant variant, const CropColumns *in, size_t num_rows,
+                                    CropEmissionColumns *out) {
+    kernel_function(variant)(in, num_rows, out);
+}
+
+// Per-row category emissions for num_rows crop rows, using the kernel
+// selected for this CPU
+void calculate_crop_columns(const CropColumns *in, size_t num_rows, CropEmissionColumns *out) {
+    kernel_function(get_kernel_variant())(in, num_rows, out);
+}
+
+// Distance in units in the last place between two finite doubles
+static unsigned long long ulp_distance(double a, double b) {
+    long long ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0) ia = LLONG_MIN - ia;
+    if (ib < 0) ib = LLONG_MIN - ib;
+    return ia > ib ? (unsigned long long)(ia - ib) : (unsigned long long)(ib - ia);
+}
+
+// Runs a variant and the scalar kernel over num_rows synthetic crop rows
+// spanning the validated input ranges and returns the largest ULP difference
+// over all output columns, or -1 if the variant cannot run on this CPU.
+long long kernel_max_ulp_difference(KernelVariant variant, size_t num_rows) {
+    if (!kernel_variant_supported(variant)) {
+        return -1;
+    }
+
+    double *inputs = malloc(num_rows * 8 * sizeof(double));
+    int *pesticide_id = malloc(num_rows * sizeof(int));
+    double *outputs = malloc(num_rows * 10 * sizeof(double));
+    if (!inputs || !pesticide_id || !outputs) {
+        free(inputs);
+        free(pesticide_id);
+        free(outputs);
+        return -1;
+    }
+
+    // Deterministic pseudo-random inputs (64-bit LCG)
+    static const double upper[8] = {50000, 1000, 500, 500, 50000, 1000, 2000, 100};
+    unsigned long long state = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < num_rows; i++) {
+        for (int c = 0; c < 8; c++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            inputs[c * num_rows + i] = (double)(state >> 11) / 9007199254740992.0 * upper[c];
+        }
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        pesticide_id[i] = (int)((state >> 33) % (unsigned long long)(num_pesticides + 1)) - 1;
+    }
+
+    CropColumns in = {
+        inputs, inputs + num_rows, inputs + 2 * num_rows, inputs + 3 * num_rows,
+        inputs + 4 * num_rows, inputs + 5 * num_rows, inputs + 6 * num_rows,
+        inputs + 7 * num_rows, pesticide_id, &emission_factors
+    };
+    CropEmissionColumns reference = {
+        outputs, outputs + num_rows, outputs + 2 * num_rows, outputs + 3 * num_rows,
+        outputs + 4 * num_rows, NULL, NULL
+    };
+    CropEmissionColumns candidate = {
+        outputs + 5 * num_rows, outputs + 6 * num_rows, outputs + 7 * num_rows,
+        outputs + 8 * num_rows, outputs + 9 * num_rows, NULL, NULL
+    };
+
+    calculate_crop_columns_scalar(&in, num_rows, &reference);
+    calculate_crop_columns_variant(variant, &in, num_rows, &candidate);
+
+    unsigned long long worst = 0;
+    for (size_t i = 0; i < num_rows * 5; i++) {
+        unsigned long long d = ulp_distance(outputs[i], outputs[5 * num_rows + i]);
+        if (d > worst) worst = d;
+    }
+
+    free(inputs);
+    free(pesticide_id);
+    free(outputs);
+    return (long long)worst;
+}
+
+// Livestock allocation and farm totals for farms [run_begin, run_end)
+static void reduce_farm_run(const FarmColumns *farms, size_t run_begin, size_t run_end,
+                            const EmissionFactors *factors, const CropColumns *crop_rows,
+                            CropEmissionColumns *crop_out, FarmEmissionColumns *farm_out) {
+    for (size_t f = run_begin; f < run_end; f++) {
+        size_t begin = farms->crop_start[f];
+        size_t end = farms->crop_start[f + 1];
+
+        double cow_emissions = farms->dairy_cows[f] * factors->cow / 1000.0;
+        double pig_emissions = farms->pigs[f] * factors->pig / 1000.0;
+        double chicken_emissions = farms->chickens[f] * factors->chicken / 1000.0;
+        double livestock = cow_emissions + pig_emissions + chicken_emissions;
+
+        double total_crop_area = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            total_crop_area += crop_rows->area[i];
+        }
+
+        double fertilizer = 0.0, manure = 0.0, fuel = 0.0, irrigation = 0.0, pesticide = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            double share = total_crop_area > 0 ? livestock * (crop_rows->area[i] / total_crop_area) : 0.0;
+            crop_out->livestock[i] = share;
+            crop_out->total[i] = crop_out->fertilizer[i] +
+                                 crop_out->manure[i] +
+                                 crop_out->fuel[i] +
+                                 crop_out->irrigation[i] +
+                                 crop_out->pesticide[i] +
+                                 share;
+
+            fertilizer += crop_out->fertilizer[i];
+            manure += crop_out->manure[i];
+            fuel += crop_out->fuel[i];
+            irrigation += crop_out->irrigation[i];
+            pesticide += crop_out->pesticide[i];
+        }
+
+        double total = fertilizer + manure + fuel + irrigation + pesticide + livestock;
+        farm_out->fertilizer[f] = fertilizer;
+        farm_out->manure[f] = manure;
+        farm_out->fuel[f] = fuel;
+        farm_out->irrigation[f] = irrigation;
+        farm_out->pesticide[f] = pesticide;
+        farm_out->livestock[f] = livestock;
+        farm_out->total[f] = total;
+        farm_out->per_hectare[f] = farms->total_farm_size[f] > 0 ? total / farms->total_farm_size[f] : 0.0;
+    }
+}
+
+// Per-row categories for rows [first, first + count) with one factor set
+static void evaluate_row_range(const CropColumns *crop_rows, CropEmissionColumns *crop_out,
+                               size_t first, size_t count, const EmissionFactors *factors) {
+    CropColumns rows = *crop_rows;
+    CropEmissionColumns results = *crop_out;
+
+    // Offset views so that row indices match crop_start
+    rows.area += first;
+    rows.nitrogen_kg_ha += first;
+    rows.phosphorus_kg_ha += first;
+    rows.potassium_kg_ha += first;
+    rows.manure_kg_ha += first;
+    rows.diesel_l_ha += first;
+    rows.irrigation_mm += first;
+    rows.pesticide_rate += first;
+    rows.pesticide_id += first;
+    rows.factors = factors;
+    results.fertilizer += first;
+    results.manure += first;
+    results.fuel += first;
+    results.irrigation += first;
+    results.pesticide += first;
+    calculate_crop_columns(&rows, count, &results);
+}
+
+// Evaluates num_farms farms whose crop rows are stored column-wise.
+// Consecutive farms sharing a factor set form a run whose per-row categories
+// are computed in one vectorizable sweep with that set broadcast. Files are
+// usually grouped by region, giving long runs; with regions interleaved
+// farm by farm the runs are short and the sweep degrades to its scalar
+// tail, which measured no slower than regrouping the block first.
+// Livestock allocation and farm totals are then reduced per farm segment in
+// crop order, matching calculate_emissions() exactly.
+void calculate_farm_columns(const FarmColumns *farms, size_t num_farms,
+                            const CropColumns *crop_rows, CropEmissionColumns *crop_out,
+                            FarmEmissionColumns *farm_out) {
+    size_t run_begin = 0;
+
+    while (run_begin < num_farms) {
+        int set = farms->factor_set ? farms->factor_set[run_begin] : factor_table.default_set;
+        size_t run_end = farms->factor_set ? run_begin + 1 : num_farms;
+        while (run_end < num_farms && farms->factor_set[run_end] == set) {
+            run_end++;
+        }
+
+        const EmissionFactors factors = factor_table.sets[set];
+        size_t first = farms->crop_start[run_begin];
+        evaluate_row_range(crop_rows, crop_out, first, farms->crop_start[run_end] - first, &factors);
+        reduce_farm_run(farms, run_begin, run_end, &factors, crop_rows, crop_out, farm_out);
+        run_begin = run_end;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef COMPUTE_BATCH_H
+#define COMPUTE_BATCH_H
+
+#include <stddef.h>
+#include "input.h"
+#include "compute.h"
+
+// Structure-of-arrays view of crop rows. Every array holds one entry per
+// crop row; rows of the same farm are contiguous. All rows in one call share
+// the emission factor set given by factors.
+typedef struct {
+    const double *area;             // hectares
+    const double *nitrogen_kg_ha;
+    const double *phosphorus_kg_ha;
+    const double *potassium_kg_ha;
+    const double *manure_kg_ha;
+    const double *diesel_l_ha;
+    const double *irrigation_mm;
+    const double *pesticide_rate;   // kg a.i. per hectare
+    const int *pesticide_id;        // index in pesticides[] (-1 if none)
+    const EmissionFactors *factors;
+} CropColumns;
+
+// Per-row emission columns (tonnes CO2e), one entry per crop row
+typedef struct {
+    double *fertilizer;
+    double *manure;
+    double *fuel;
+    double *irrigation;
+    double *pesticide;
+    double *livestock;
+    double *total;
+} CropEmissionColumns;
+
+// Farm-level inputs; crop_start has num_farms + 1 entries and farm f owns
+// crop rows [crop_start[f], crop_start[f + 1]). factor_set may be NULL when
+// every farm uses the default set.
+typedef struct {
+    const size_t *crop_start;
+    const double *total_farm_size;
+    const int *dairy_cows;
+    const int *pigs;
+    const int *chickens;
+    const int *factor_set;          // index in factor_table.sets per farm
+} FarmColumns;
+
+// Farm-level emission columns (tonnes CO2e), one entry per farm
+typedef struct {
+    double *fertilizer;
+    double *manure;
+    double *fuel;
+    double *irrigation;
+    double *pesticide;
+    double *livestock;
+    double *total;
+    double *per_hectare;
+} FarmEmissionColumns;
+
+// Implementations of the per-row kernel, selected at runtime by CPU support
+typedef enum {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,                  // AVX-512F
+    KERNEL_COUNT
+} KernelVariant;
+
+// Largest ULP difference from the scalar kernel accepted for SIMD variants.
+// All variants use the scalar operation order, so none is expected.
+#define KERNEL_MAX_ULP 0
+
+// Function declarations
+KernelVariant detect_kernel_variant(void);
+KernelVariant get_kernel_variant(void);
+int set_kernel_variant(KernelVariant variant);
+int kernel_variant_supported(KernelVariant variant);
+const char *kernel_variant_name(KernelVariant variant);
+long long kernel_max_ulp_difference(KernelVariant variant, size_t num_rows);
+void calculate_crop_columns_scalar(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+void calculate_crop_columns_variant(KernelVariant variant, const CropColumns *in, size_t num_rows,
+                                    CropEmissionColumns *out);
+void calculate_crop_columns(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+void calculate_farm_columns(const FarmColumns *farms, size_t num_farms,
+                            const CropColumns *crop_rows, CropEmissionColumns *crop_out,
+                            FarmEmissionColumns *farm_out);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef COMPUTE_SIMD_H
+#define COMPUTE_SIMD_H
+
+#include <stddef.h>
+#include "compute_batch.h"
+
+// Hand-written SIMD implementations of calculate_crop_columns(). Only
+// available on x86 with GCC/Clang; callers go through the dispatcher in
+// compute_batch.c, which checks CPU support before selecting a variant.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CARBON_X86_SIMD 1
+
+void crop_columns_sse2(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+void crop_columns_avx2(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+void crop_columns_avx512(const CropColumns *in, size_t num_rows, CropEmissionColumns *out);
+#endif
+
+#endif
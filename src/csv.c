@@ -0,0 +1,329 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "csv.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// Powers of ten that are exactly representable as doubles
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int csv_open(CsvReader *reader, const char *filename) {
+    memset(reader, 0, sizeof(*reader));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Error: Cannot open file \"%s\"\n", filename);
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        printf("Error: Cannot determine size of \"%s\"\n", filename);
+        CloseHandle(file);
+        return 0;
+    }
+    reader->file_handle = file;
+    reader->size = (size_t)size.QuadPart;
+
+    if (reader->size > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            printf("Error: Cannot map file \"%s\"\n", filename);
+            CloseHandle(file);
+            return 0;
+        }
+        reader->map_handle = mapping;
+        reader->data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!reader->data) {
+            printf("Error: Cannot map file \"%s\"\n", filename);
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return 0;
+        }
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: Cannot open file \"%s\"\n", filename);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("Error: Cannot determine size of \"%s\"\n", filename);
+        close(fd);
+        return 0;
+    }
+    reader->size = (size_t)st.st_size;
+
+    // mmap() rejects zero-length mappings; an empty file simply has no rows
+    if (reader->size > 0) {
+        void *map = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            printf("Error: Cannot map file \"%s\"\n", filename);
+            close(fd);
+            return 0;
+        }
+        reader->data = (const char *)map;
+#ifdef POSIX_MADV_SEQUENTIAL
+        posix_madvise(map, reader->size, POSIX_MADV_SEQUENTIAL);
+#endif
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+
+    return 1;
+}
+
+void csv_close(CsvReader *reader) {
+#ifdef _WIN32
+    if (reader->data) UnmapViewOfFile(reader->data);
+    if (reader->map_handle) CloseHandle(reader->map_handle);
+    if (reader->file_handle) CloseHandle(reader->file_handle);
+#else
+    if (reader->data) munmap((void *)reader->data, reader->size);
+#endif
+    memset(reader, 0, sizeof(*reader));
+}
+
+// Splits the next non-blank row into fields pointing into the mapping.
+// Returns the number of fields, 0 at end of file, or -1 if the row has
+// more than max_fields fields (the row is still consumed).
+int csv_next_row(CsvReader *reader, CsvField *fields, int max_fields) {
+    while (reader->pos < reader->size) {
+        const char *line = reader->data + reader->pos;
+        size_t remaining = reader->size - reader->pos;
+        const char *newline = memchr(line, '\n', remaining);
+        size_t length = newline ? (size_t)(newline - line) : remaining;
+
+        reader->pos += newline ? length + 1 : length;
+        reader->line++;
+
+        // Drop the carriage return of CRLF line endings
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+
+        // Skip blank lines (e.g. trailing newline at end of file)
+        size_t first = 0;
+        while (first < length && (line[first] == ' ' || line[first] == '\t')) {
+            first++;
+        }
+        if (first == length) {
+            continue;
+        }
+
+        reader->row.start = line;
+        reader->row.length = length;
+        reader->row.line = reader->line;
+
+        int count = 0;
+        const char *cursor = line;
+        const char *end = line + length;
+        while (1) {
+            const char *comma = memchr(cursor, ',', (size_t)(end - cursor));
+            const char *field_end = comma ? comma : end;
+
+            if (count == max_fields) {
+                return -1;
+            }
+            fields[count].start = cursor;
+            fields[count].length = (size_t)(field_end - cursor);
+            count++;
+
+            if (!comma) {
+                break;
+            }
+            cursor = comma + 1;
+        }
+        return count;
+    }
+    return 0;
+}
+
+// Strips surrounding spaces and tabs from a field view
+static void trim_field(const char **start, const char **end) {
+    while (*start < *end && (**start == ' ' || **start == '\t')) {
+        (*start)++;
+    }
+    while (*end > *start && ((*end)[-1] == ' ' || (*end)[-1] == '\t')) {
+        (*end)--;
+    }
+}
+
+// Slow path for forms the fast path does not handle (exponents, more than
+// 15 significant digits, inf/nan): copy to a terminated buffer and use strtod.
+static int parse_double_fallback(const char *start, const char *end, double *value) {
+    char buffer[64];
+    size_t length = (size_t)(end - start);
+    if (length == 0 || length >= sizeof(buffer)) {
+        return 0;
+    }
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+
+    char *parse_end;
+    double result = strtod(buffer, &parse_end);
+    if (parse_end != buffer + length) {
+        return 0;
+    }
+    *value = result;
+    return 1;
+}
+
+// Parses a decimal number such as "-120.50" directly from the field.
+// With at most 15 significant digits the mantissa and the power of ten are
+// both exact doubles, so one division yields the correctly rounded value
+// (identical to strtod).
+int csv_parse_double(const CsvField *field, double *value) {
+    const char *start = field->start;
+    const char *end = field->start + field->length;
+    trim_field(&start, &end);
+
+    const char *p = start;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int fraction_digits = 0;
+    int seen_digit = 0;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (mantissa != 0 || *p != '0') digits++;
+        mantissa = mantissa * 10 + (unsigned)(*p - '0');
+        seen_digit = 1;
+        p++;
+        if (digits > 15) return parse_double_fallback(start, end, value);
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (mantissa != 0 || *p != '0') digits++;
+            mantissa = mantissa * 10 + (unsigned)(*p - '0');
+            fraction_digits++;
+            seen_digit = 1;
+            p++;
+            if (digits > 15 || fraction_digits > 22) {
+                return parse_double_fallback(start, end, value);
+            }
+        }
+    }
+
+    if (p != end || !seen_digit) {
+        return parse_double_fallback(start, end, value);
+    }
+
+    double result = (double)mantissa / exact_powers_of_ten[fraction_digits];
+    *value = negative ? -result : result;
+    return 1;
+}
+
+// Parses an integer count. A fractional part made only of zeros ("10.0")
+// is accepted because spreadsheet exports often write counts that way.
+int csv_parse_int(const CsvField *field, int *value) {
+    const char *p = field->start;
+    const char *end = field->start + field->length;
+    trim_field(&p, &end);
+
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    long long result = 0;
+    int seen_digit = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        if (result > 2147483647LL + negative) {
+            return 0;
+        }
+        seen_digit = 1;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p == '0') {
+            p++;
+        }
+    }
+    if (p != end || !seen_digit) {
+        return 0;
+    }
+
+    *value = (int)(negative ? -result : result);
+    return 1;
+}
+
+// Copies a trimmed field into a NUL-terminated buffer, truncating if needed
+void csv_copy_field(const CsvField *field, char *buffer, size_t buffer_size) {
+    const char *start = field->start;
+    const char *end = field->start + field->length;
+    trim_field(&start, &end);
+
+    size_t length = (size_t)(end - start);
+    if (length >= buffer_size) {
+        length = buffer_size - 1;
+    }
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+}
+
+// The field without surrounding blanks, still pointing into the mapping
+CsvField csv_trim_field(const CsvField *field) {
+    const char *start = field->start;
+    const char *end = field->start + field->length;
+    trim_field(&start, &end);
+
+    CsvField trimmed = {start, (size_t)(end - start)};
+    return trimmed;
+}
+
+// Exact comparison of two trimmed fields, whatever their length
+int csv_fields_equal(const CsvField *a, const CsvField *b) {
+    CsvField left = csv_trim_field(a);
+    CsvField right = csv_trim_field(b);
+    return left.length == right.length && memcmp(left.start, right.start, left.length) == 0;
+}
+
+// Case-insensitive comparison of a trimmed field against a C string
+int csv_field_equals(const CsvField *field, const char *text) {
+    const char *start = field->start;
+    const char *end = field->start + field->length;
+    trim_field(&start, &end);
+
+    size_t length = (size_t)(end - start);
+    if (strlen(text) != length) {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)start[i]) != tolower((unsigned char)text[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
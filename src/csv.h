@@ -0,0 +1,47 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stddef.h>
+
+// Maximum number of fields recognised on one CSV row
+#define CSV_MAX_FIELDS 32
+
+// A field is a view into the mapped file; it is not NUL-terminated
+typedef struct {
+    const char *start;
+    size_t length;
+} CsvField;
+
+// A whole row as it appears in the file, without its line ending
+typedef struct {
+    const char *start;
+    size_t length;
+    int line;
+} CsvRow;
+
+// Read-only, memory-mapped CSV file. Rows are tokenized in place, so no
+// line is ever copied out of the mapping.
+typedef struct {
+    const char *data;           // start of mapped file contents
+    size_t size;                // file size in bytes
+    size_t pos;                 // offset of the next unread byte
+    int line;                   // 1-based number of the last row returned
+    CsvRow row;                 // the last row returned
+#ifdef _WIN32
+    void *file_handle;
+    void *map_handle;
+#endif
+} CsvReader;
+
+// Function declarations
+int csv_open(CsvReader *reader, const char *filename);
+void csv_close(CsvReader *reader);
+int csv_next_row(CsvReader *reader, CsvField *fields, int max_fields);
+int csv_parse_double(const CsvField *field, double *value);
+int csv_parse_int(const CsvField *field, int *value);
+void csv_copy_field(const CsvField *field, char *buffer, size_t buffer_size);
+int csv_field_equals(const CsvField *field, const char *text);
+CsvField csv_trim_field(const CsvField *field);
+int csv_fields_equal(const CsvField *a, const CsvField *b);
+
+#endif
@@ -0,0 +1,773 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "factors.h"
+#include "lookup.h"
+#include "montecarlo.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#define FACTOR_LINE_MAX 512
+#define FACTOR_MAX_FIELDS 8
+
+// Upper bound on any table in a cache, so size arithmetic cannot overflow
+#define FACTOR_CACHE_MAX_COUNT (1u << 24)
+
+// Written natively; a cache from a machine of the other byte order is
+// rejected and rebuilt rather than swapped
+#define FACTOR_CACHE_BYTE_ORDER 0x01020304u
+
+static const char factor_cache_magic[8] = "CFFACT";
+
+// Arrays stored after the cache header, in this order
+enum {
+    CACHE_REGIONS,
+    CACHE_YEARS,
+    CACHE_SETS,
+    CACHE_CROPS,
+    CACHE_PESTICIDES,
+    CACHE_UNCERTAINTY,
+    CACHE_ARRAYS
+};
+
+// Compiled cache layout: this header, then each array at a 16-byte aligned
+// offset, exactly as it sits in memory
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int64_t source_size;        // factor pack the cache was compiled from
+    int64_t source_mtime;
+    uint64_t total_size;
+    int32_t default_set;
+    uint32_t reserved;
+    uint64_t element_size[CACHE_ARRAYS];    // sizeof() of the writer
+    uint64_t offset[CACHE_ARRAYS];
+    uint64_t count[CACHE_ARRAYS];
+} FactorCacheHeader;
+
+// One [factors ...] section: the factors it names override the set of its
+// region (and year, if given)
+typedef struct {
+    char region[FACTOR_REGION_NAME_MAX];
+    int year;                   // 0 for every year of the region
+    EmissionFactors values;
+    unsigned given;             // bit k set if factor_keys[k] was given
+} FactorOverride;
+
+// A factor pack parsed from text
+typedef struct {
+    FactorOverride *overrides;
+    int num_overrides;
+    int override_capacity;
+    Crop *crops;
+    int num_crops;
+    int crop_capacity;
+    Pesticide *pesticides;
+    int num_pesticides;
+    int pesticide_capacity;
+    FactorUncertainty uncertainty[MC_NUM_FACTORS];
+} FactorPack;
+
+// The dense table compiled from a pack's overrides
+typedef struct {
+    FactorRegion *regions;
+    int *years;
+    EmissionFactors *sets;
+    int num_regions;
+    int num_years;
+} FactorGrid;
+
+typedef enum {
+    SECTION_NONE,
+    SECTION_FACTORS,
+    SECTION_CROPS,
+    SECTION_PESTICIDES,
+    SECTION_UNCERTAINTY
+} FactorSection;
+
+static const struct {
+    const char *key;
+    size_t offset;
+} factor_keys[] = {
+    {"nitrogen",   offsetof(EmissionFactors, nitrogen)},
+    {"phosphorus", offsetof(EmissionFactors, phosphorus)},
+    {"potassium",  offsetof(EmissionFactors, potassium)},
+    {"manure",     offsetof(EmissionFactors, manure)},
+    {"diesel",     offsetof(EmissionFactors, diesel)},
+    {"irrigation", offsetof(EmissionFactors, irrigation)},
+    {"cow",        offsetof(EmissionFactors, cow)},
+    {"pig",        offsetof(EmissionFactors, pig)},
+    {"chicken",    offsetof(EmissionFactors, chicken)}
+};
+#define NUM_FACTOR_KEYS (int)(sizeof(factor_keys) / sizeof(factor_keys[0]))
+
+static NameIndex region_index;
+
+static size_t align16(size_t offset) {
+    return (offset + 15) & ~(size_t)15;
+}
+
+static double *factor_slot(EmissionFactors *factors, int key) {
+    return (double *)((char *)factors + factor_keys[key].offset);
+}
+
+// Strips leading and trailing whitespace in place
+static char *trim(char *text) {
+    while (*text == ' ' || *text == '\t') text++;
+    size_t length = strlen(text);
+    while (length > 0 && (text[length - 1] == ' ' || text[length - 1] == '\t' ||
+                          text[length - 1] == '\r' || text[length - 1] == '\n')) {
+        text[--length] = '\0';
+    }
+    return text;
+}
+
+// Splits a line at commas into trimmed fields. Returns the field count.
+static int split_fields(char *line, char **fields, int max_fields) {
+    int count = 0;
+    char *start = line;
+
+    while (count < max_fields) {
+        char *comma = strchr(start, ',');
+        if (comma) *comma = '\0';
+        fields[count++] = trim(start);
+        if (!comma) break;
+        start = comma + 1;
+    }
+    return count;
+}
+
+// Parses a non-negative number that makes up the whole field
+static int parse_factor_value(const char *text, double *value) {
+    char *end;
+    *value = strtod(text, &end);
+    return end != text && *end == '\0' && *value >= 0.0;
+}
+
+static int copy_name(char *dest, size_t size, const char *text) {
+    size_t length = strlen(text);
+    if (length == 0 || length >= size) return 0;
+    memcpy(dest, text, length + 1);
+    return 1;
+}
+
+static int same_name(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+// Makes room for one more element. Returns 0 if out of memory.
+static int reserve_one(void **items, int *capacity, int count, size_t size) {
+    if (count < *capacity) return 1;
+    int grown_capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(*items, (size_t)grown_capacity * size);
+    if (!grown) return 0;
+    *items = grown;
+    *capacity = grown_capacity;
+    return 1;
+}
+
+// Starts a [factors], [factors REGION] or [factors REGION YEAR] section;
+// header is the text between "[factors" and "]"
+static int begin_factor_section(FactorPack *pack, char *header, const char *path, int line_number) {
+    char *words[2];
+    int count = 0;
+    long year = 0;
+
+    for (char *word = strtok(header, " \t"); word; word = strtok(NULL, " \t")) {
+        if (count == 2) {
+            printf("Error: %s:%d: expected [factors], [factors REGION] or [factors REGION YEAR]\n",
+                   path, line_number);
+            return 0;
+        }
+        words[count++] = word;
+    }
+    if (count == 2) {
+        char *end;
+        year = strtol(words[1], &end, 10);
+        if (*end != '\0' || year <= 0 || year > 9999) {
+            printf("Error: %s:%d: invalid year '%s'\n", path, line_number, words[1]);
+            return 0;
+        }
+    }
+
+    if (!reserve_one((void **)&pack->overrides, &pack->override_capacity, pack->num_overrides, sizeof(FactorOverride))) {
+        printf("Error: Out of memory loading %s\n", path);
+        return 0;
+    }
+    FactorOverride *entry = &pack->overrides[pack->num_overrides];
+    memset(entry, 0, sizeof(*entry));
+    if (!copy_name(entry->region, sizeof(entry->region), count > 0 ? words[0] : "default")) {
+        printf("Error: %s:%d: region name must be 1-%d characters\n", path, line_number, FACTOR_REGION_NAME_MAX - 1);
+        return 0;
+    }
+    entry->year = (int)year;
+    pack->num_overrides++;
+    return 1;
+}
+
+static int parse_factor_line(FactorPack *pack, char *line, const char *path, int line_number) {
+    FactorOverride *entry = &pack->overrides[pack->num_overrides - 1];
+    char *eq = strchr(line, '=');
+    if (!eq) {
+        printf("Error: %s:%d: expected 'name = value'\n", path, line_number);
+        return 0;
+    }
+    *eq = '\0';
+    char *key = trim(line);
+    char *text = trim(eq + 1);
+
+    for (int k = 0; k < NUM_FACTOR_KEYS; k++) {
+        if (strcmp(key, factor_keys[k].key) == 0) {
+            if (!parse_factor_value(text, factor_slot(&entry->values, k))) {
+                printf("Error: %s:%d: factor '%s' must be a non-negative number\n", path, line_number, key);
+                return 0;
+            }
+            entry->given |= 1u << k;
+            return 1;
+        }
+    }
+    printf("Error: %s:%d: unknown factor '%s'\n", path, line_number, key);
+    return 0;
+}
+
+// "factor = distribution parameters", e.g. "nitrogen = lognormal 0.5"
+static int parse_uncertainty_line(FactorPack *pack, char *line, const char *path, int line_number) {
+    char *eq = strchr(line, '=');
+    if (!eq) {
+        printf("Error: %s:%d: expected 'factor = distribution'\n", path, line_number);
+        return 0;
+    }
+    *eq = '\0';
+    char *key = trim(line);
+    char *text = trim(eq + 1);
+
+    for (int k = 0; k < MC_NUM_FACTORS; k++) {
+        if (strcmp(key, mc_factor_name(k)) == 0) {
+            if (!parse_factor_uncertainty(text, &pack->uncertainty[k])) {
+                printf("Error: %s:%d: expected 'none', 'normal SD', 'lognormal SIGMA' or "
+                       "'triangular LOW HIGH' (LOW <= 1 <= HIGH) for '%s'\n", path, line_number, key);
+                return 0;
+            }
+            return 1;
+        }
+    }
+    printf("Error: %s:%d: unknown factor '%s'\n", path, line_number, key);
+    return 0;
+}
+
+static int parse_crop_line(FactorPack *pack, char *line, const char *path, int line_number) {
+    char *fields[FACTOR_MAX_FIELDS];
+    if (split_fields(line, fields, FACTOR_MAX_FIELDS) != 6) {
+        printf("Error: %s:%d: expected 'name, N, P, K, irrigation, yield'\n", path, line_number);
+        return 0;
+    }
+    if (!reserve_one((void **)&pack->crops, &pack->crop_capacity, pack->num_crops, sizeof(Crop))) {
+        printf("Error: Out of memory loading %s\n", path);
+        return 0;
+    }
+
+    Crop *crop = &pack->crops[pack->num_crops];
+    memset(crop, 0, sizeof(*crop));
+    if (!copy_name(crop->name, sizeof(crop->name), fields[0])) {
+        printf("Error: %s:%d: crop name must be 1-%d characters\n", path, line_number, (int)sizeof(crop->name) - 1);
+        return 0;
+    }
+    if (!parse_factor_value(fields[1], &crop->n_rate) ||
+        !parse_factor_value(fields[2], &crop->p_rate) ||
+        !parse_factor_value(fields[3], &crop->k_rate) ||
+        !parse_factor_value(fields[4], &crop->irrigation) ||
+        !parse_factor_value(fields[5], &crop->yield)) {
+        printf("Error: %s:%d: crop values must be non-negative numbers\n", path, line_number);
+        return 0;
+    }
+    pack->num_crops++;
+    return 1;
+}
+
+static int parse_pesticide_line(FactorPack *pack, char *line, const char *path, int line_number) {
+    char *fields[FACTOR_MAX_FIELDS];
+    if (split_fields(line, fields, FACTOR_MAX_FIELDS) != 4) {
+        printf("Error: %s:%d: expected 'trade name, substance, type, ef'\n", path, line_number);
+        return 0;
+    }
+    if (!reserve_one((void **)&pack->pesticides, &pack->pesticide_capacity, pack->num_pesticides, sizeof(Pesticide))) {
+        printf("Error: Out of memory loading %s\n", path);
+        return 0;
+    }
+
+    Pesticide *pesticide = &pack->pesticides[pack->num_pesticides];
+    memset(pesticide, 0, sizeof(*pesticide));
+    if (!copy_name(pesticide->trade_name, sizeof(pesticide->trade_name), fields[0]) ||
+        !copy_name(pesticide->substance, sizeof(pesticide->substance), fields[1]) ||
+        !copy_name(pesticide->type, sizeof(pesticide->type), fields[2])) {
+        printf("Error: %s:%d: pesticide name, substance or type is empty or too long\n", path, line_number);
+        return 0;
+    }
+    if (!parse_factor_value(fields[3], &pesticide->ef)) {
+        printf("Error: %s:%d: pesticide ef must be a non-negative number\n", path, line_number);
+        return 0;
+    }
+    pack->num_pesticides++;
+    return 1;
+}
+
+static int parse_factor_pack(const char *path, FactorPack *pack) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        printf("Error: Cannot open factor pack \"%s\"\n", path);
+        return 0;
+    }
+
+    char buffer[FACTOR_LINE_MAX];
+    FactorSection section = SECTION_NONE;
+    int line_number = 0;
+    int ok = 1;
+
+    while (ok && fgets(buffer, sizeof(buffer), file)) {
+        line_number++;
+        char *comment = strchr(buffer, '#');
+        if (comment) *comment = '\0';
+        char *line = trim(buffer);
+        if (*line == '\0') continue;
+
+        if (*line == '[') {
+            size_t length = strlen(line);
+            if (strcmp(line, "[crops]") == 0) {
+                section = SECTION_CROPS;
+            } else if (strcmp(line, "[pesticides]") == 0) {
+                section = SECTION_PESTICIDES;
+            } else if (strcmp(line, "[uncertainty]") == 0) {
+                section = SECTION_UNCERTAINTY;
+            } else if (strncmp(line, "[factors", 8) == 0 && line[length - 1] == ']' &&
+                       (line[8] == ']' || line[8] == ' ' || line[8] == '\t')) {
+                line[length - 1] = '\0';
+                section = SECTION_FACTORS;
+                ok = begin_factor_section(pack, trim(line + 8), path, line_number);
+            } else {
+                printf("Error: %s:%d: unknown section %s\n", path, line_number, line);
+                ok = 0;
+            }
+            continue;
+        }
+
+        switch (section) {
+            case SECTION_FACTORS:
+                ok = parse_factor_line(pack, line, path, line_number);
+                break;
+            case SECTION_CROPS:
+                ok = parse_crop_line(pack, line, path, line_number);
+                break;
+            case SECTION_PESTICIDES:
+                ok = parse_pesticide_line(pack, line, path, line_number);
+                break;
+            case SECTION_UNCERTAINTY:
+                ok = parse_uncertainty_line(pack, line, path, line_number);
+                break;
+            default:
+                printf("Error: %s:%d: entry outside of a section\n", path, line_number);
+                ok = 0;
+                break;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+static void apply_override(EmissionFactors *factors, const FactorOverride *entry) {
+    for (int k = 0; k < NUM_FACTOR_KEYS; k++) {
+        if (entry->given & (1u << k)) {
+            *factor_slot(factors, k) = *factor_slot((EmissionFactors *)&entry->values, k);
+        }
+    }
+}
+
+static int compare_years(const void *a, const void *b) {
+    int left = *(const int *)a;
+    int right = *(const int *)b;
+    return (left > right) - (left < right);
+}
+
+// Builds the dense region x year table. Region 0 is "default", set by
+// [factors] and [factors default ...]. Every region starts from the
+// default region's all-years factors plus its own [factors REGION]
+// section, which is year column 0 (years[0] = 0) and covers the years
+// before the first refinement; each later year then carries the previous
+// year's values forward, overridden by [factors REGION YEAR].
+static int build_factor_grid(const FactorPack *pack, const EmissionFactors *base, FactorGrid *grid) {
+    int max_entries = pack->num_overrides + 1;
+    memset(grid, 0, sizeof(*grid));
+    grid->regions = calloc((size_t)max_entries, sizeof(FactorRegion));
+    grid->years = calloc((size_t)max_entries, sizeof(int));
+    if (!grid->regions || !grid->years) return 0;
+
+    strcpy(grid->regions[0].name, "default");
+    grid->num_regions = 1;
+    grid->num_years = 1;            // years[0] = 0: before any refinement year
+    for (int i = 0; i < pack->num_overrides; i++) {
+        const FactorOverride *entry = &pack->overrides[i];
+        int known = 0;
+        for (int r = 0; r < grid->num_regions && !known; r++) {
+            known = same_name(grid->regions[r].name, entry->region);
+        }
+        if (!known) {
+            strcpy(grid->regions[grid->num_regions++].name, entry->region);
+        }
+
+        known = entry->year == 0;
+        for (int y = 0; y < grid->num_years && !known; y++) {
+            known = grid->years[y] == entry->year;
+        }
+        if (!known) {
+            grid->years[grid->num_years++] = entry->year;
+        }
+    }
+    qsort(grid->years, (size_t)grid->num_years, sizeof(int), compare_years);
+
+    grid->sets = malloc((size_t)grid->num_regions * (size_t)grid->num_years * sizeof(EmissionFactors));
+    if (!grid->sets) return 0;
+
+    EmissionFactors region_base = *base;
+    for (int i = 0; i < pack->num_overrides; i++) {
+        if (pack->overrides[i].year == 0 && same_name(pack->overrides[i].region, "default")) {
+            apply_override(&region_base, &pack->overrides[i]);
+        }
+    }
+
+    for (int r = 0; r < grid->num_regions; r++) {
+        EmissionFactors current = region_base;
+        for (int i = 0; r > 0 && i < pack->num_overrides; i++) {
+            if (pack->overrides[i].year == 0 && same_name(pack->overrides[i].region, grid->regions[r].name)) {
+                apply_override(&current, &pack->overrides[i]);
+            }
+        }
+        for (int y = 0; y < grid->num_years; y++) {
+            for (int i = 0; grid->years[y] != 0 && i < pack->num_overrides; i++) {
+                if (pack->overrides[i].year == grid->years[y] &&
+                    same_name(pack->overrides[i].region, grid->regions[r].name)) {
+                    apply_override(&current, &pack->overrides[i]);
+                }
+            }
+            grid->sets[r * grid->num_years + y] = current;
+        }
+    }
+    return 1;
+}
+
+static void free_factor_grid(FactorGrid *grid) {
+    free(grid->regions);
+    free(grid->years);
+    free(grid->sets);
+}
+
+static void install_factor_table(const FactorRegion *regions, int num_regions,
+                                 const int *years, int num_years,
+                                 const EmissionFactors *sets, int default_set) {
+    factor_table.regions = regions;
+    factor_table.num_regions = num_regions;
+    factor_table.years = years;
+    factor_table.num_years = num_years;
+    factor_table.sets = sets;
+    factor_table.default_set = default_set;
+    emission_factors = sets[default_set];
+}
+
+static void build_cache_header(FactorCacheHeader *header, const struct stat *source) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, factor_cache_magic, sizeof(header->magic));
+    header->version = FACTOR_CACHE_VERSION;
+    header->byte_order = FACTOR_CACHE_BYTE_ORDER;
+    header->source_size = (int64_t)source->st_size;
+    header->source_mtime = (int64_t)source->st_mtime;
+    header->element_size[CACHE_REGIONS] = sizeof(FactorRegion);
+    header->element_size[CACHE_YEARS] = sizeof(int);
+    header->element_size[CACHE_SETS] = sizeof(EmissionFactors);
+    header->element_size[CACHE_CROPS] = sizeof(Crop);
+    header->element_size[CACHE_PESTICIDES] = sizeof(Pesticide);
+    header->element_size[CACHE_UNCERTAINTY] = sizeof(FactorUncertainty);
+}
+
+// Writes the tables in effect to the cache. A cache that cannot be written
+// (read-only directory, full disk) only costs the next run a text parse.
+static void write_factor_cache(const char *cache_path, const struct stat *source) {
+    FactorCacheHeader header;
+    const void *arrays[CACHE_ARRAYS] = {
+        factor_table.regions, factor_table.years, factor_table.sets, crops, pesticides,
+        factor_uncertainty
+    };
+
+    build_cache_header(&header, source);
+    header.default_set = factor_table.default_set;
+    header.count[CACHE_REGIONS] = (uint64_t)factor_table.num_regions;
+    header.count[CACHE_YEARS] = (uint64_t)factor_table.num_years;
+    header.count[CACHE_SETS] = (uint64_t)factor_table.num_regions * (uint64_t)factor_table.num_years;
+    header.count[CACHE_CROPS] = (uint64_t)num_crops;
+    header.count[CACHE_PESTICIDES] = (uint64_t)num_pesticides;
+    header.count[CACHE_UNCERTAINTY] = MC_NUM_FACTORS;
+
+    size_t end = sizeof(header);
+    for (int a = 0; a < CACHE_ARRAYS; a++) {
+        header.offset[a] = align16(end);
+        end = header.offset[a] + header.count[a] * header.element_size[a];
+    }
+    header.total_size = end;
+
+    // Written under a temporary name and renamed, so a concurrent run never
+    // maps a half-written cache
+    char temp_path[1024];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path) >= (int)sizeof(temp_path)) return;
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return;
+
+    static const char padding[16] = {0};
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    end = sizeof(header);
+    for (int a = 0; a < CACHE_ARRAYS && ok; a++) {
+        size_t gap = header.offset[a] - end;
+        size_t bytes = header.count[a] * header.element_size[a];
+        ok = fwrite(padding, 1, gap, file) == gap && fwrite(arrays[a], 1, bytes, file) == bytes;
+        end = header.offset[a] + bytes;
+    }
+    if (fclose(file) != 0) ok = 0;
+
+#ifdef _WIN32
+    if (ok) remove(cache_path);     // rename() does not replace on Windows
+#endif
+    if (!ok || rename(temp_path, cache_path) != 0) {
+        remove(temp_path);
+    }
+}
+
+// Reads the whole cache file: mapped where possible, otherwise copied into
+// a malloc'd buffer. The buffer lives for the rest of the program.
+static void *read_cache_file(const char *cache_path, size_t *size) {
+#ifdef _WIN32
+    FILE *file = fopen(cache_path, "rb");
+    if (!file) return NULL;
+    void *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length > 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)length);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+#else
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return data;
+#endif
+}
+
+static void release_cache_file(void *data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+static int terminated(const char *text, size_t size) {
+    return memchr(text, '\0', size) != NULL;
+}
+
+// Checks what the header cannot: names are terminated, years ascend and
+// distributions are known
+static int cache_contents_valid(const char *data, const FactorCacheHeader *header) {
+    const FactorRegion *regions = (const FactorRegion *)(data + header->offset[CACHE_REGIONS]);
+    const int *years = (const int *)(data + header->offset[CACHE_YEARS]);
+    const Crop *crop_rows = (const Crop *)(data + header->offset[CACHE_CROPS]);
+    const Pesticide *pesticide_rows = (const Pesticide *)(data + header->offset[CACHE_PESTICIDES]);
+    const FactorUncertainty *uncertainty = (const FactorUncertainty *)(data + header->offset[CACHE_UNCERTAINTY]);
+
+    for (uint64_t i = 0; i < header->count[CACHE_REGIONS]; i++) {
+        if (!terminated(regions[i].name, sizeof(regions[i].name))) return 0;
+    }
+    for (uint64_t i = 1; i < header->count[CACHE_YEARS]; i++) {
+        if (years[i] <= years[i - 1]) return 0;
+    }
+    for (uint64_t i = 0; i < header->count[CACHE_CROPS]; i++) {
+        if (!terminated(crop_rows[i].name, sizeof(crop_rows[i].name))) return 0;
+    }
+    for (uint64_t i = 0; i < header->count[CACHE_PESTICIDES]; i++) {
+        if (!terminated(pesticide_rows[i].trade_name, sizeof(pesticide_rows[i].trade_name)) ||
+            !terminated(pesticide_rows[i].substance, sizeof(pesticide_rows[i].substance)) ||
+            !terminated(pesticide_rows[i].type, sizeof(pesticide_rows[i].type))) return 0;
+    }
+    for (uint64_t i = 0; i < header->count[CACHE_UNCERTAINTY]; i++) {
+        if (uncertainty[i].distribution < DIST_NONE || uncertainty[i].distribution > DIST_TRIANGULAR) return 0;
+    }
+    return 1;
+}
+
+// Installs the tables from a cache compiled from the pack described by
+// source. Returns 0 if there is no usable cache.
+static int load_factor_cache(const char *cache_path, const struct stat *source) {
+    size_t size = 0;
+    char *data = read_cache_file(cache_path, &size);
+    if (!data) return 0;
+
+    FactorCacheHeader expected;
+    build_cache_header(&expected, source);
+    const FactorCacheHeader *header = (const FactorCacheHeader *)data;
+
+    int valid = size >= sizeof(*header) &&
+                memcmp(header->magic, expected.magic, sizeof(header->magic)) == 0 &&
+                header->version == expected.version &&
+                header->byte_order == expected.byte_order &&
+                header->source_size == expected.source_size &&
+                header->source_mtime == expected.source_mtime &&
+                header->total_size == size &&
+                memcmp(header->element_size, expected.element_size, sizeof(header->element_size)) == 0;
+
+    uint64_t end = sizeof(*header);
+    for (int a = 0; a < CACHE_ARRAYS && valid; a++) {
+        valid = header->count[a] <= FACTOR_CACHE_MAX_COUNT &&
+                header->offset[a] % 16 == 0 && header->offset[a] >= end;
+        end = header->offset[a] + header->count[a] * header->element_size[a];
+        valid = valid && end <= size;
+    }
+    valid = valid &&
+            header->count[CACHE_REGIONS] > 0 && header->count[CACHE_YEARS] > 0 &&
+            header->count[CACHE_CROPS] > 0 &&
+            header->count[CACHE_UNCERTAINTY] == MC_NUM_FACTORS &&
+            header->count[CACHE_SETS] == header->count[CACHE_REGIONS] * header->count[CACHE_YEARS] &&
+            header->default_set >= 0 && (uint64_t)header->default_set < header->count[CACHE_SETS] &&
+            cache_contents_valid(data, header);
+    if (!valid) {
+        release_cache_file(data, size);
+        return 0;
+    }
+
+    install_factor_table((const FactorRegion *)(data + header->offset[CACHE_REGIONS]),
+                         (int)header->count[CACHE_REGIONS],
+                         (const int *)(data + header->offset[CACHE_YEARS]),
+                         (int)header->count[CACHE_YEARS],
+                         (const EmissionFactors *)(data + header->offset[CACHE_SETS]),
+                         header->default_set);
+    crops = (Crop *)(data + header->offset[CACHE_CROPS]);
+    num_crops = (int)header->count[CACHE_CROPS];
+    pesticides = (Pesticide *)(data + header->offset[CACHE_PESTICIDES]);
+    num_pesticides = (int)header->count[CACHE_PESTICIDES];
+    memcpy(factor_uncertainty, data + header->offset[CACHE_UNCERTAINTY], sizeof(factor_uncertainty));
+    return 1;
+}
+
+// Loads a factor pack, from its compiled cache when that is current.
+// Returns 0 (leaving the built-in factors in place) if the pack is invalid.
+int load_factor_pack(const char *path) {
+    struct stat source;
+    if (stat(path, &source) != 0) {
+        printf("Error: Cannot open factor pack \"%s\"\n", path);
+        return 0;
+    }
+
+    char cache_path[1024];
+    int cache_named = snprintf(cache_path, sizeof(cache_path), "%s%s", path, FACTOR_CACHE_SUFFIX) < (int)sizeof(cache_path);
+
+    if (cache_named && load_factor_cache(cache_path, &source)) {
+        lookup_invalidate();
+        return 1;
+    }
+
+    FactorPack pack;
+    FactorGrid grid;
+    memset(&pack, 0, sizeof(pack));
+    memset(&grid, 0, sizeof(grid));
+    memcpy(pack.uncertainty, factor_uncertainty, sizeof(pack.uncertainty));
+    if (!parse_factor_pack(path, &pack) || !build_factor_grid(&pack, &emission_factors, &grid)) {
+        free(pack.overrides);
+        free(pack.crops);
+        free(pack.pesticides);
+        free_factor_grid(&grid);
+        return 0;
+    }
+    free(pack.overrides);
+
+    install_factor_table(grid.regions, grid.num_regions, grid.years, grid.num_years,
+                         grid.sets, grid.num_years - 1);
+    memcpy(factor_uncertainty, pack.uncertainty, sizeof(factor_uncertainty));
+
+    // Sections left out keep the built-in tables
+    if (pack.num_crops > 0) {
+        crops = pack.crops;
+        num_crops = pack.num_crops;
+    } else {
+        free(pack.crops);
+    }
+    if (pack.num_pesticides > 0) {
+        pesticides = pack.pesticides;
+        num_pesticides = pack.num_pesticides;
+    } else {
+        free(pack.pesticides);
+    }
+    lookup_invalidate();
+
+    if (cache_named) {
+        write_factor_cache(cache_path, &source);
+    }
+    return 1;
+}
+
+// Index of a region in factor_table (case-insensitive), or -1
+int find_factor_region(const char *name) {
+    return name_index_lookup(&region_index, factor_table.regions[0].name, sizeof(FactorRegion),
+                             factor_table.num_regions, name);
+}
+
+// Dense set index for a region and reporting year: the latest table year
+// not after year, or the latest year of all when year is 0. Years before
+// the first refinement get the region's base column. Returns -1 for an
+// unknown region or a negative year.
+int find_factor_set(int region, int year) {
+    int y = factor_table.num_years - 1;
+    if (year != 0) {
+        int low = 0;
+        int high = factor_table.num_years;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (factor_table.years[mid] <= year) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        y = low - 1;
+    }
+    if (region < 0 || region >= factor_table.num_regions || y < 0) {
+        return -1;
+    }
+    return region * factor_table.num_years + y;
+}
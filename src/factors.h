@@ -0,0 +1,51 @@
+#ifndef FACTORS_H
+#define FACTORS_H
+
+#include "compute.h"
+#include "input.h"
+
+// Bump when the layout of the compiled cache changes
+#define FACTOR_CACHE_VERSION 4
+
+// Suffix appended to a factor pack's path to name its compiled cache
+#define FACTOR_CACHE_SUFFIX ".bin"
+
+// Environment variable naming a factor pack to load when --factors is absent
+#define FACTOR_PACK_ENV "CARBON_FACTORS"
+
+// A factor pack is a text file with [factors], [crops], [pesticides] and
+// [uncertainty] sections that replaces the built-in emission factors and
+// tables:
+//
+//   [factors]
+//   nitrogen = 6.3              # any of the EmissionFactors fields
+//   [factors UA]                # region UA, every year
+//   diesel = 2.7
+//   [factors UA 2019]           # region UA from reporting year 2019 on
+//   nitrogen = 5.9
+//   [crops]
+//   Wheat, 120, 60, 30, 450, 5.5            # name, N, P, K, irrigation, yield
+//   [pesticides]
+//   Roundup, Glyphosate, Herbicide, 29.0    # trade name, substance, type, ef
+//   [uncertainty]                           # Monte Carlo spread of a factor
+//   nitrogen = lognormal 0.5                # or normal SD, triangular LOW HIGH, none
+//
+// Region and year sections build a dense region x year table (see
+// FactorTable). A region starts from the [factors] values plus its own
+// all-years section, which also covers years before its first refinement,
+// and each year inherits the previous year's values before applying its
+// own section. Farms pick a set through the optional
+// region and year columns of multi-crop CSV files.
+//
+// The first load compiles the pack into <pack>.bin next to it; later runs
+// map that cache directly as long as the pack's size and modification time
+// are unchanged, so no text is parsed. Omitted factors keep their defaults,
+// and a missing or empty [crops] or [pesticides] section keeps the built-in
+// table.
+
+// Function declarations
+int load_factor_pack(const char *path);
+int find_factor_region(const char *name);
+int find_factor_set(int region, int year);
+
+#endif
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "incremental.h"
+#include "validator.h"
+
+static const char *const crop_field_names[NUM_CROP_FIELDS] = {
+    "crop", "area", "nitrogen", "phosphorus", "potassium",
+    "manure", "diesel", "irrigation", "pesticide", "rate"
+};
+
+static const char *const farm_field_names[NUM_FARM_FIELDS] = {
+    "size", "cows", "pigs", "chickens"
+};
+
+int find_crop_field(const char *name) {
+    for (int f = 0; f < NUM_CROP_FIELDS; f++) {
+        if (strcmp(name, crop_field_names[f]) == 0) return f;
+    }
+    return -1;
+}
+
+int find_farm_field(const char *name) {
+    for (int f = 0; f < NUM_FARM_FIELDS; f++) {
+        if (strcmp(name, farm_field_names[f]) == 0) return f;
+    }
+    return -1;
+}
+
+static void update_livestock(IncrementalFarm *inc) {
+    double cow_emissions = inc->farm.dairy_cows * inc->factors.cow / 1000.0;
+    double pig_emissions = inc->farm.pigs * inc->factors.pig / 1000.0;
+    double chicken_emissions = inc->farm.chickens * inc->factors.chicken / 1000.0;
+    inc->totals.livestock_emissions = cow_emissions + pig_emissions + chicken_emissions;
+}
+
+static void update_total(IncrementalFarm *inc) {
+    EmissionTotals *totals = &inc->totals;
+    totals->total_emissions = totals->fertilizer_emissions +
+                              totals->manure_emissions +
+                              totals->fuel_emissions +
+                              totals->irrigation_emissions +
+                              totals->pesticide_emissions +
+                              totals->livestock_emissions;
+    totals->per_hectare_emissions = inc->farm.total_farm_size > 0 ?
+                                    totals->total_emissions / inc->farm.total_farm_size : 0.0;
+}
+
+// Sums the farm totals from the cached crop results in crop order, which
+// gives exactly what calculate_farm_record_totals() returns
+static void resum_totals(IncrementalFarm *inc) {
+    EmissionTotals *totals = &inc->totals;
+
+    totals->fertilizer_emissions = 0.0;
+    totals->manure_emissions = 0.0;
+    totals->fuel_emissions = 0.0;
+    totals->irrigation_emissions = 0.0;
+    totals->pesticide_emissions = 0.0;
+    inc->total_crop_area = 0.0;
+    for (int i = 0; i < inc->farm.num_crops; i++) {
+        inc->total_crop_area += inc->crops[i].area;
+    }
+    for (int i = 0; i < inc->farm.num_crops; i++) {
+        const CropEmissionResults *crop = &inc->crop_results[i];
+        totals->fertilizer_emissions += crop->fertilizer_emissions;
+        totals->manure_emissions += crop->manure_emissions;
+        totals->fuel_emissions += crop->fuel_emissions;
+        totals->irrigation_emissions += crop->irrigation_emissions;
+        totals->pesticide_emissions += crop->pesticide_emissions;
+    }
+    update_livestock(inc);
+    update_total(inc);
+    inc->edits = 0;
+}
+
+// Starts editing a farm whose crops are rows[farm->crop_offset..]. The
+// rows are edited in place. Returns 0 if out of memory.
+int incremental_farm_init(IncrementalFarm *inc, const FarmRecord *farm, CropData *rows) {
+    memset(inc, 0, sizeof(*inc));
+    inc->farm = *farm;
+    inc->crops = rows + farm->crop_offset;
+    inc->factors = factor_table.sets[farm->factor_set];
+    inc->crop_results = malloc((size_t)(farm->num_crops > 0 ? farm->num_crops : 1) * sizeof(CropEmissionResults));
+    if (!inc->crop_results) {
+        return 0;
+    }
+    for (int i = 0; i < farm->num_crops; i++) {
+        calculate_crop_categories(&inc->crops[i], &inc->factors, &inc->crop_results[i]);
+    }
+    resum_totals(inc);
+    return 1;
+}
+
+void incremental_farm_free(IncrementalFarm *inc) {
+    free(inc->crop_results);
+    memset(inc, 0, sizeof(*inc));
+}
+
+// Changes one input of one crop and re-evaluates that crop only. Returns
+// 0, leaving the farm unchanged, if the crop or field does not exist or
+// the new value fails the validator's checks (crops may not outgrow the
+// farm).
+int incremental_set_crop_field(IncrementalFarm *inc, int crop, int field, double value) {
+    // NaN, infinities and values no int could hold are refused outright
+    if (crop < 0 || crop >= inc->farm.num_crops || !(fabs(value) <= INT_MAX)) {
+        return 0;
+    }
+    CropData *row = &inc->crops[crop];
+    CropData old_row = *row;
+    double old_area = row->area;
+
+    switch (field) {
+        case CROP_FIELD_CROP_ID:        row->crop_id = (int)value; break;
+        case CROP_FIELD_AREA:           row->area = value; break;
+        case CROP_FIELD_NITROGEN:       row->nitrogen_kg_ha = value; break;
+        case CROP_FIELD_PHOSPHORUS:     row->phosphorus_kg_ha = value; break;
+        case CROP_FIELD_POTASSIUM:      row->potassium_kg_ha = value; break;
+        case CROP_FIELD_MANURE:         row->manure_kg_ha = value; break;
+        case CROP_FIELD_DIESEL:         row->diesel_l_ha = value; break;
+        case CROP_FIELD_IRRIGATION:     row->irrigation_mm = value; break;
+        case CROP_FIELD_PESTICIDE_ID:   row->pesticide_id = (int)value; break;
+        case CROP_FIELD_PESTICIDE_RATE: row->pesticide_rate = value; break;
+        default: return 0;
+    }
+    if (crop_row_errors(row) || farm_record_errors(&inc->farm, inc->total_crop_area + row->area - old_area)) {
+        *row = old_row;
+        return 0;
+    }
+
+    CropEmissionResults *cached = &inc->crop_results[crop];
+    CropEmissionResults old = *cached;
+    calculate_crop_categories(row, &inc->factors, cached);
+
+    if (++inc->edits >= INCREMENTAL_RESUM_EDITS) {
+        resum_totals(inc);
+        return 1;
+    }
+    EmissionTotals *totals = &inc->totals;
+    totals->fertilizer_emissions += cached->fertilizer_emissions - old.fertilizer_emissions;
+    totals->manure_emissions += cached->manure_emissions - old.manure_emissions;
+    totals->fuel_emissions += cached->fuel_emissions - old.fuel_emissions;
+    totals->irrigation_emissions += cached->irrigation_emissions - old.irrigation_emissions;
+    totals->pesticide_emissions += cached->pesticide_emissions - old.pesticide_emissions;
+    inc->total_crop_area += row->area - old_area;
+    update_total(inc);
+    return 1;
+}
+
+// Changes the farm size or a head count; no crop is re-evaluated. Returns
+// 0, leaving the farm unchanged, if the field does not exist or the new
+// value fails the validator's checks (the farm may not shrink below its
+// crops).
+int incremental_set_farm_field(IncrementalFarm *inc, int field, double value) {
+    FarmRecord old_farm = inc->farm;
+
+    // NaN, infinities and values no int could hold are refused outright
+    if (!(fabs(value) <= INT_MAX)) {
+        return 0;
+    }
+    switch (field) {
+        case FARM_FIELD_SIZE:     inc->farm.total_farm_size = value; break;
+        case FARM_FIELD_COWS:     inc->farm.dairy_cows = (int)value; break;
+        case FARM_FIELD_PIGS:     inc->farm.pigs = (int)value; break;
+        case FARM_FIELD_CHICKENS: inc->farm.chickens = (int)value; break;
+        default: return 0;
+    }
+    if (farm_record_errors(&inc->farm, inc->total_crop_area)) {
+        inc->farm = old_farm;
+        return 0;
+    }
+    update_livestock(inc);
+    update_total(inc);
+    return 1;
+}
+
+const EmissionTotals *incremental_farm_totals(const IncrementalFarm *inc) {
+    return &inc->totals;
+}
+
+// One crop's full result, with its livestock share by area
+void incremental_crop_result(const IncrementalFarm *inc, int crop, CropEmissionResults *result) {
+    *result = inc->crop_results[crop];
+    if (inc->total_crop_area > 0) {
+        result->livestock_emissions = inc->totals.livestock_emissions * (result->area / inc->total_crop_area);
+    } else {
+        result->livestock_emissions = 0.0;
+    }
+    result->total_emissions = result->fertilizer_emissions +
+                              result->manure_emissions +
+                              result->fuel_emissions +
+                              result->irrigation_emissions +
+                              result->pesticide_emissions +
+                              result->livestock_emissions;
+}
+
+// The full report of the edited farm. The totals are summed again first,
+// so they match a fresh calculation exactly. crop_results may be NULL.
+void incremental_farm_results(IncrementalFarm *inc, EmissionResults *results, CropEmissionResults *crop_results) {
+    resum_totals(inc);
+    emission_results_from_totals(results, &inc->totals);
+    results->num_crops = inc->farm.num_crops;
+    for (int i = 0; crop_results && i < inc->farm.num_crops; i++) {
+        incremental_crop_result(inc, i, &crop_results[i]);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "input.h"
+#include "compute.h"
+
+// Edits applied as differences before the farm totals are summed again
+// from the cached crop results, which bounds rounding drift
+#define INCREMENTAL_RESUM_EDITS 1024
+
+// Crop inputs an edit can change
+typedef enum {
+    CROP_FIELD_CROP_ID = 0,
+    CROP_FIELD_AREA,
+    CROP_FIELD_NITROGEN,
+    CROP_FIELD_PHOSPHORUS,
+    CROP_FIELD_POTASSIUM,
+    CROP_FIELD_MANURE,
+    CROP_FIELD_DIESEL,
+    CROP_FIELD_IRRIGATION,
+    CROP_FIELD_PESTICIDE_ID,
+    CROP_FIELD_PESTICIDE_RATE,
+    NUM_CROP_FIELDS
+} CropField;
+
+// Farm-level inputs an edit can change
+typedef enum {
+    FARM_FIELD_SIZE = 0,
+    FARM_FIELD_COWS,
+    FARM_FIELD_PIGS,
+    FARM_FIELD_CHICKENS,
+    NUM_FARM_FIELDS
+} FarmField;
+
+// A farm under live editing. Each crop's input-driven categories are
+// cached, so an edit re-evaluates only the crop it touches and moves the
+// farm totals by the difference. Livestock is allocated to crops by area
+// when a crop result is read, so an area edit does not touch other crops.
+typedef struct {
+    FarmRecord farm;
+    CropData *crops;                    // the farm's crop rows, edited in place
+    CropEmissionResults *crop_results;  // cached categories (no livestock share or total)
+    EmissionFactors factors;
+    EmissionTotals totals;
+    double total_crop_area;
+    int edits;                          // since the totals were last summed in full
+} IncrementalFarm;
+
+// Function declarations
+int incremental_farm_init(IncrementalFarm *inc, const FarmRecord *farm, CropData *rows);
+void incremental_farm_free(IncrementalFarm *inc);
+int incremental_set_crop_field(IncrementalFarm *inc, int crop, int field, double value);
+int incremental_set_farm_field(IncrementalFarm *inc, int field, double value);
+const EmissionTotals *incremental_farm_totals(const IncrementalFarm *inc);
+void incremental_crop_result(const IncrementalFarm *inc, int crop, CropEmissionResults *result);
+void incremental_farm_results(IncrementalFarm *inc, EmissionResults *results, CropEmissionResults *crop_results);
+int find_crop_field(const char *name);
+int find_farm_field(const char *name);
+
+#endif
@@ -2,14 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <stdarg.h>
 #include "input.h"
-
-#ifdef _WIN32
-#define strcasecmp _stricmp
-#endif
+#include "csv.h"
+#include "lookup.h"
+#include "factors.h"
 
 // Predefined crop data with default agronomic parameters
-Crop crops[] = {
+static Crop default_crops[] = {
     {"Wheat",      120, 60, 30, 450, 5.5},
     {"Maize",      150, 70, 40, 500, 7.0},
     {"Soybean",     20, 50, 30, 400, 2.5},
@@ -21,10 +22,12 @@ Crop crops[] = {
     {"Sugar beet", 180, 80, 90, 550, 60.0},
     {"Vegetables", 120, 80, 70, 500, 25.0}
 };
-int num_crops = sizeof(crops) / sizeof(crops[0]);
+// Crop table in effect; a factor pack can replace it (see factors.h)
+Crop *crops = default_crops;
+int num_crops = sizeof(default_crops) / sizeof(default_crops[0]);
 
 // Predefined pesticide data with emission factors
-Pesticide pesticides[] = {
+static Pesticide default_pesticides[] = {
     {"Roundup",     "Glyphosate",          "Herbicide",   29.0},
     {"Atrazine",    "Atrazine",            "Herbicide",   25.0},
     {"Harness",     "Acetochlor",          "Herbicide",   27.0},
@@ -34,7 +37,8 @@ Pesticide pesticides[] = {
     {"Bravo",       "Chlorothalonil",      "Fungicide",   30.0},
     {"Tilt",        "Propiconazole",       "Fungicide",   35.0}
 };
-int num_pesticides = sizeof(pesticides) / sizeof(pesticides[0]);
+Pesticide *pesticides = default_pesticides;
+int num_pesticides = sizeof(default_pesticides) / sizeof(default_pesticides[0]);
 
 void display_available_crops(void) {
     printf("\nAvailable crops:\n");
@@ -60,22 +64,16 @@ void display_available_pesticides(void) {
     printf("0   No pesticide\n\n");
 }
 
+// Hashed, case-insensitive name indexes over the crop and pesticide tables
+static NameIndex crop_index;
+static NameIndex pesticide_index;
+
 int find_crop_by_name(const char *name) {
-    for (int i = 0; i < num_crops; i++) {
-        if (strcasecmp(name, crops[i].name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return name_index_lookup(&crop_index, crops[0].name, sizeof(Crop), num_crops, name);
 }
 
 int find_pesticide_by_name(const char *name) {
-    for (int i = 0; i < num_pesticides; i++) {
-        if (strcasecmp(name, pesticides[i].trade_name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return name_index_lookup(&pesticide_index, pesticides[0].trade_name, sizeof(Pesticide), num_pesticides, name);
 }
 
 void convert_legacy_to_multi_crop(const LegacyFarmData *legacy, FarmData *multi) {
@@ -121,16 +119,16 @@ int read_interactive_input(FarmData *farm) {
 
     // Get number of different crops
     do {
-        printf("How many different crops do you grow? (1-10): ");
+        printf("How many different crops do you grow? (1-%d): ", MAX_CROPS);
         if (scanf("%d", &farm->num_crops) != 1) {
-            printf("Error: Invalid input. Please enter a number between 1 and 10.\n");
+            printf("Error: Invalid input. Please enter a number between 1 and %d.\n", MAX_CROPS);
             while (getchar() != '\n');
             continue;
         }
-        if (farm->num_crops < 1 || farm->num_crops > 10) {
-            printf("Error: Number of crops must be between 1 and 10.\n");
+        if (farm->num_crops < 1 || farm->num_crops > MAX_CROPS) {
+            printf("Error: Number of crops must be between 1 and %d.\n", MAX_CROPS);
         }
-    } while (farm->num_crops < 1 || farm->num_crops > 10);
+    } while (farm->num_crops < 1 || farm->num_crops > MAX_CROPS);
 
     double total_area_entered = 0.0;
 
@@ -541,153 +539,648 @@ int read_legacy_interactive_input(LegacyFarmData *farm)
     return 1;
 }
 
+// Column order of the legacy single-crop CSV format
+enum {
+    LEGACY_COL_FARM_SIZE = 0,
+    LEGACY_COL_CROP_TYPE,
+    LEGACY_COL_NITROGEN,
+    LEGACY_COL_PHOSPHORUS,
+    LEGACY_COL_POTASSIUM,
+    LEGACY_COL_MANURE,
+    LEGACY_COL_DIESEL,
+    LEGACY_COL_IRRIGATION,
+    LEGACY_COL_COWS,
+    LEGACY_COL_PIGS,
+    LEGACY_COL_CHICKENS,
+    LEGACY_COL_COUNT
+};
+
+// Header names of the legacy columns and how their errors are worded
+static const char *const legacy_column_names[LEGACY_COL_COUNT][2] = {
+    {"farm_size", "farm size"},
+    {"crop_type", "crop type"},
+    {"nitrogen", "nitrogen"},
+    {"phosphorus", "phosphorus"},
+    {"potassium", "potassium"},
+    {"manure", "manure"},
+    {"diesel", "diesel"},
+    {"irrigation", "irrigation"},
+    {"cows", "dairy cows"},
+    {"pigs", "pigs"},
+    {"chickens", "chickens"}
+};
+
+// Parses the fields of a legacy row without printing. Returns -1 on
+// success or the LEGACY_COL_* position of the first missing or bad field.
+static int parse_legacy_row(const CsvField *fields, int field_count, LegacyFarmData *farm)
+{
+    double *doubles[] = {
+        &farm->nitrogen_kg_ha, &farm->phosphorus_kg_ha, &farm->potassium_kg_ha,
+        &farm->manure_kg_ha, &farm->diesel_l_ha, &farm->irrigation_mm
+    };
+    int *ints[] = {&farm->dairy_cows, &farm->pigs, &farm->chickens};
+
+    if (field_count <= LEGACY_COL_FARM_SIZE || !csv_parse_double(&fields[LEGACY_COL_FARM_SIZE], &farm->farm_size))
+    {
+        return LEGACY_COL_FARM_SIZE;
+    }
+
+    if (field_count <= LEGACY_COL_CROP_TYPE)
+    {
+        return LEGACY_COL_CROP_TYPE;
+    }
+    csv_copy_field(&fields[LEGACY_COL_CROP_TYPE], farm->crop_type, sizeof(farm->crop_type));
+
+    for (int i = 0; i < 6; i++)
+    {
+        int column = LEGACY_COL_NITROGEN + i;
+        if (field_count <= column || !csv_parse_double(&fields[column], doubles[i]))
+        {
+            return column;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        int column = LEGACY_COL_COWS + i;
+        if (field_count <= column || !csv_parse_int(&fields[column], ints[i]))
+        {
+            return column;
+        }
+    }
+
+    return -1;
+}
+
+int parse_legacy_csv_fields(const CsvField *fields, int field_count, int line_count, LegacyFarmData *farm)
+{
+    int column = parse_legacy_row(fields, field_count, farm);
+
+    if (column == LEGACY_COL_CROP_TYPE)
+    {
+        printf("Error: Missing crop type in CSV line %d\n", line_count);
+        return 0;
+    }
+    if (column >= 0)
+    {
+        printf("Error: Invalid %s in CSV line %d\n", legacy_column_names[column][1], line_count);
+        return 0;
+    }
+    return 1;
+}
+
+// Quiet variant for callers that set bad rows aside: returns NULL on
+// success or the header name of the first missing or bad field
+const char *parse_legacy_csv_row(const CsvField *fields, int field_count, LegacyFarmData *farm)
+{
+    int column = parse_legacy_row(fields, field_count, farm);
+    return column >= 0 ? legacy_column_names[column][0] : NULL;
+}
+
 int read_csv_input(const char *filename, LegacyFarmData *farm)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
+    CsvReader reader;
+    if (!csv_open(&reader, filename))
     {
-        printf("Error: Cannot open file \"%s\"\n", filename);
         printf("Failed to read input data from file: \"%s\"\n", filename);
         return 0;
     }
 
-    char line[1024];
-    int line_count = 0;
+    CsvField fields[CSV_MAX_FIELDS];
+
+    // Skip header line, then read the first data line
+    int field_count = csv_next_row(&reader, fields, CSV_MAX_FIELDS);
+    if (field_count != 0)
+    {
+        field_count = csv_next_row(&reader, fields, CSV_MAX_FIELDS);
+    }
 
-    // Skip header line
-    if (fgets(line, sizeof(line), file))
+    if (field_count == 0)
     {
-        line_count++;
+        printf("Error: No data found in CSV file\n");
+        csv_close(&reader);
+        return 0;
+    }
+
+    if (field_count < 0)
+    {
+        printf("Error: Too many fields in CSV line %d\n", reader.line);
+        csv_close(&reader);
+        return 0;
+    }
+
+    if (!parse_legacy_csv_fields(fields, field_count, reader.line, farm))
+    {
+        csv_close(&reader);
+        return 0;
     }
 
-    // Read data line
-    if (fgets(line, sizeof(line), file))
+    csv_close(&reader);
+    return 1;
+}
+
+// Header names recognised in multi-crop CSV files
+static const struct {
+    const char *name;
+    size_t offset;
+    int required;
+} multi_crop_column_names[] = {
+    {"farm_id",        offsetof(MultiCropColumns, farm_id),        0},
+    {"farm_size",      offsetof(MultiCropColumns, farm_size),      0},
+    {"crop_id",        offsetof(MultiCropColumns, crop_id),        1},
+    {"area",           offsetof(MultiCropColumns, area),           1},
+    {"nitrogen",       offsetof(MultiCropColumns, nitrogen),       1},
+    {"phosphorus",     offsetof(MultiCropColumns, phosphorus),     1},
+    {"potassium",      offsetof(MultiCropColumns, potassium),      1},
+    {"manure",         offsetof(MultiCropColumns, manure),         1},
+    {"diesel",         offsetof(MultiCropColumns, diesel),         1},
+    {"irrigation",     offsetof(MultiCropColumns, irrigation),     1},
+    {"pesticide_id",   offsetof(MultiCropColumns, pesticide_id),   0},
+    {"pesticide_rate", offsetof(MultiCropColumns, pesticide_rate), 0},
+    {"cows",           offsetof(MultiCropColumns, cows),           0},
+    {"pigs",           offsetof(MultiCropColumns, pigs),           0},
+    {"chickens",       offsetof(MultiCropColumns, chickens),       0},
+    {"region",         offsetof(MultiCropColumns, region),         0},
+    {"year",           offsetof(MultiCropColumns, year),           0}
+};
+#define NUM_MULTI_CROP_COLUMNS (int)(sizeof(multi_crop_column_names) / sizeof(multi_crop_column_names[0]))
+
+static int *column_slot(MultiCropColumns *columns, int index)
+{
+    return (int *)((char *)columns + multi_crop_column_names[index].offset);
+}
+
+// Maps header fields to column positions; returns 0 if a required column is missing
+static int resolve_multi_crop_columns(const CsvField *fields, int field_count, MultiCropColumns *columns)
+{
+    for (int c = 0; c < NUM_MULTI_CROP_COLUMNS; c++)
     {
-        line_count++;
+        *column_slot(columns, c) = -1;
+    }
 
-        char *token = strtok(line, ",");
-        if (!token || sscanf(token, "%lf", &farm->farm_size) != 1)
+    for (int i = 0; i < field_count; i++)
+    {
+        for (int c = 0; c < NUM_MULTI_CROP_COLUMNS; c++)
         {
-            printf("Error: Invalid farm size in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            if (csv_field_equals(&fields[i], multi_crop_column_names[c].name))
+            {
+                *column_slot(columns, c) = i;
+                break;
+            }
         }
+    }
 
-        token = strtok(NULL, ",");
-        if (!token)
+    for (int c = 0; c < NUM_MULTI_CROP_COLUMNS; c++)
+    {
+        if (multi_crop_column_names[c].required && *column_slot(columns, c) < 0)
         {
-            printf("Error: Missing crop type in CSV line %d\n", line_count);
-            fclose(file);
+            printf("Error: Multi-crop CSV header is missing column '%s'\n", multi_crop_column_names[c].name);
             return 0;
         }
-        strncpy(farm->crop_type, token, sizeof(farm->crop_type) - 1);
-        farm->crop_type[sizeof(farm->crop_type) - 1] = '\0';
+    }
+    return 1;
+}
+
+// Optional columns (column < 0) keep the caller's default
+static int parse_column_double(const CsvField *fields, int field_count, int column, double *value)
+{
+    if (column < 0) return 1;
+    return column < field_count && csv_parse_double(&fields[column], value);
+}
+
+static int parse_column_int(const CsvField *fields, int field_count, int column, int *value)
+{
+    if (column < 0) return 1;
+    return column < field_count && csv_parse_int(&fields[column], value);
+}
 
-        // Remove any trailing whitespace/newlines from crop type
-        char *end = farm->crop_type + strlen(farm->crop_type) - 1;
-        while (end > farm->crop_type && (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r'))
+// A file is treated as multi-crop when its header names a crop_id column
+int is_multi_crop_csv(const char *filename)
+{
+    CsvReader reader;
+    CsvField fields[CSV_MAX_FIELDS];
+
+    if (!csv_open(&reader, filename))
+    {
+        return 0;
+    }
+
+    int result = 0;
+    int field_count = csv_next_row(&reader, fields, CSV_MAX_FIELDS);
+    for (int i = 0; i < field_count; i++)
+    {
+        if (csv_field_equals(&fields[i], "crop_id"))
         {
-            *end = '\0';
-            end--;
+            result = 1;
+            break;
         }
+    }
+
+    csv_close(&reader);
+    return result;
+}
+
+int multi_crop_csv_open(MultiCropCsv *csv, const char *filename)
+{
+    memset(csv, 0, sizeof(*csv));
+    if (!csv_open(&csv->reader, filename))
+    {
+        return 0;
+    }
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->nitrogen_kg_ha) != 1)
+    int field_count = csv_next_row(&csv->reader, csv->fields, CSV_MAX_FIELDS);
+    if (field_count <= 0)
+    {
+        printf("Error: No header found in CSV file\n");
+        csv_close(&csv->reader);
+        return 0;
+    }
+
+    if (!resolve_multi_crop_columns(csv->fields, field_count, &csv->columns))
+    {
+        csv_close(&csv->reader);
+        return 0;
+    }
+    return 1;
+}
+
+void multi_crop_csv_close(MultiCropCsv *csv)
+{
+    csv_close(&csv->reader);
+    free(csv->rows);
+    free(csv->farm_id);
+    csv->rows = NULL;
+    csv->farm_id = NULL;
+    csv->num_rows = csv->row_capacity = 0;
+    csv->farm_id_length = csv->farm_id_capacity = 0;
+}
+
+// Views an interactive farm as a record whose crops start at farm->crops
+void farm_record_from_farm_data(const FarmData *farm, FarmRecord *record)
+{
+    record->total_farm_size = farm->total_farm_size;
+    record->crop_offset = 0;
+    record->num_crops = farm->num_crops;
+    record->dairy_cows = farm->dairy_cows;
+    record->pigs = farm->pigs;
+    record->chickens = farm->chickens;
+    record->factor_set = factor_table.default_set;
+}
+
+// Returns a zeroed row at the end of the arena, or NULL if out of memory.
+// Growing may move the rows, so keep offsets rather than pointers.
+CropData *crop_arena_append(CropArena *arena)
+{
+    if (arena->count == arena->capacity)
+    {
+        size_t capacity = arena->capacity ? arena->capacity * 2 : 64;
+        CropData *rows = realloc(arena->rows, capacity * sizeof(CropData));
+        if (!rows)
         {
-            printf("Error: Invalid nitrogen in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            return NULL;
         }
+        arena->rows = rows;
+        arena->capacity = capacity;
+    }
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->phosphorus_kg_ha) != 1)
+    CropData *row = &arena->rows[arena->count++];
+    memset(row, 0, sizeof(*row));
+    return row;
+}
+
+void crop_arena_reset(CropArena *arena)
+{
+    arena->count = 0;
+}
+
+void crop_arena_free(CropArena *arena)
+{
+    free(arena->rows);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Keeps the row just read in csv->rows (with keep_going only). Returns 0
+// if out of memory.
+static int keep_row(MultiCropCsv *csv)
+{
+    if (!csv->keep_going)
+    {
+        return 1;
+    }
+    if (csv->num_rows == csv->row_capacity)
+    {
+        size_t capacity = csv->row_capacity ? csv->row_capacity * 2 : 16;
+        CsvRow *rows = realloc(csv->rows, capacity * sizeof(CsvRow));
+        if (!rows)
         {
-            printf("Error: Invalid phosphorus in CSV line %d\n", line_count);
-            fclose(file);
+            printf("Error: Out of memory\n");
             return 0;
         }
+        csv->rows = rows;
+        csv->row_capacity = capacity;
+    }
+    csv->rows[csv->num_rows++] = csv->reader.row;
+    return 1;
+}
+
+// Rejects the farm being read because of the given row and field. The
+// reason is printed, or with keep_going recorded in csv->error, and the
+// rest of the farm's rows are consumed so the next call starts at the next
+// farm. Returns -1.
+static int reject_farm(MultiCropCsv *csv, int line, const char *field, const char *format, ...)
+{
+    const MultiCropColumns *col = &csv->columns;
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(csv->error.reason, sizeof(csv->error.reason), format, args);
+    va_end(args);
+    csv->error.line = line;
+    csv->error.field = field;
+    if (!csv->keep_going)
+    {
+        printf("Error: %s in CSV line %d\n", csv->error.reason, line);
+        return -1;
+    }
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->potassium_kg_ha) != 1)
+    // A row without a usable farm_id is rejected on its own
+    if (col->farm_id >= 0 && csv->farm_key.start == NULL)
+    {
+        return -1;
+    }
+    while (1)
+    {
+        int field_count = csv_next_row(&csv->reader, csv->fields, CSV_MAX_FIELDS);
+        if (field_count == 0)
         {
-            printf("Error: Invalid potassium in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            return -1;
+        }
+        if (col->farm_id >= 0 && (field_count < 0 || col->farm_id >= field_count ||
+                                  !csv_fields_equal(&csv->fields[col->farm_id], &csv->farm_key)))
+        {
+            csv->pending_count = field_count;
+            csv->pending_line = csv->reader.line;
+            return -1;
+        }
+        if (!keep_row(csv))
+        {
+            csv->error.field = NULL;
+            return -1;
         }
+    }
+}
+
+// Resolves the optional region and year columns to a dense factor set, so
+// the farm's factors are found by index from here on. A missing region is
+// the base region; a missing year is the latest year in the table.
+static int resolve_farm_factor_set(MultiCropCsv *csv, int field_count, int line, int *factor_set)
+{
+    const CsvField *fields = csv->fields;
+    const MultiCropColumns *col = &csv->columns;
+    int region = 0;
+    int year = 0;
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->manure_kg_ha) != 1)
+    if (col->region >= 0 && col->region < field_count && fields[col->region].length > 0)
+    {
+        char name[FACTOR_REGION_NAME_MAX];
+        csv_copy_field(&fields[col->region], name, sizeof(name));
+        region = fields[col->region].length < sizeof(name) ? find_factor_region(name) : -1;
+        if (region < 0)
         {
-            printf("Error: Invalid manure in CSV line %d\n", line_count);
-            fclose(file);
+            reject_farm(csv, line, "region", "Unknown region '%s'", name);
             return 0;
         }
+    }
+    if (col->year >= 0 && col->year < field_count && fields[col->year].length > 0 &&
+        !csv_parse_int(&fields[col->year], &year))
+    {
+        reject_farm(csv, line, "year", "Invalid year");
+        return 0;
+    }
+
+    *factor_set = find_factor_set(region, year);
+    if (*factor_set < 0)
+    {
+        reject_farm(csv, line, "year", "No emission factors for year %d", year);
+        return 0;
+    }
+    return 1;
+}
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->diesel_l_ha) != 1)
+// Copies the trimmed farm_id field, however long, into csv->farm_id.
+// Returns 0 if out of memory.
+static int set_farm_id(MultiCropCsv *csv, const CsvField *field)
+{
+    CsvField id = csv_trim_field(field);
+    if (id.length >= csv->farm_id_capacity)
+    {
+        char *farm_id = realloc(csv->farm_id, id.length + 1);
+        if (!farm_id)
         {
-            printf("Error: Invalid diesel in CSV line %d\n", line_count);
-            fclose(file);
+            printf("Error: Out of memory\n");
             return 0;
         }
+        csv->farm_id = farm_id;
+        csv->farm_id_capacity = id.length + 1;
+    }
+    memcpy(csv->farm_id, id.start, id.length);
+    csv->farm_id[id.length] = '\0';
+    csv->farm_id_length = id.length;
+    return 1;
+}
+
+// Reads the next farm, appending its crop rows to the arena, so farms may
+// have any number of crops; its ID is left in csv->farm_id. Farm-level
+// columns (farm_size, cows, pigs, chickens) are taken from the farm's first
+// row; farm_size defaults to the sum of crop areas. Crop and pesticide IDs
+// are 1-based as in interactive mode (pesticide 0 = none). Returns 1 when a
+// farm was read, 0 at end of file, -1 on error.
+int multi_crop_csv_next_farm(MultiCropCsv *csv, CropArena *arena, FarmRecord *farm)
+{
+    static const CsvField single_farm_id = {"1", 1};
+    const MultiCropColumns *col = &csv->columns;
+    CsvField *fields = csv->fields;
+    int field_count = csv->pending_count;
+    int line = csv->pending_line;
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%lf", &farm->irrigation_mm) != 1)
+    if (field_count == 0)
+    {
+        field_count = csv_next_row(&csv->reader, fields, CSV_MAX_FIELDS);
+        line = csv->reader.line;
+    }
+    csv->pending_count = 0;
+    if (field_count == 0)
+    {
+        return 0;
+    }
+
+    memset(farm, 0, sizeof(*farm));
+    farm->crop_offset = arena->count;
+    CsvField current_id = {0};
+    int has_farm_size = col->farm_size >= 0;
+
+    // The first row is still the reader's last row, even if read ahead
+    csv->num_rows = 0;
+    csv->farm_key = current_id;
+    csv->error.field = NULL;
+    if (!keep_row(csv))
+    {
+        return -1;
+    }
+
+    if (field_count < 0)
+    {
+        return reject_farm(csv, line, "", "Too many fields");
+    }
+    if (col->farm_id >= 0)
+    {
+        if (col->farm_id >= field_count)
         {
-            printf("Error: Invalid irrigation in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            return reject_farm(csv, line, "farm_id", "Missing farm_id");
         }
+        current_id = fields[col->farm_id];
+        csv->farm_key = current_id;
+    }
+    if (!set_farm_id(csv, col->farm_id >= 0 ? &current_id : &single_farm_id))
+    {
+        return -1;
+    }
+
+    if (!parse_column_double(fields, field_count, col->farm_size, &farm->total_farm_size))
+    {
+        return reject_farm(csv, line, "farm_size", "Invalid farm size");
+    }
+    if (!parse_column_int(fields, field_count, col->cows, &farm->dairy_cows))
+    {
+        return reject_farm(csv, line, "cows", "Invalid dairy cows");
+    }
+    if (!parse_column_int(fields, field_count, col->pigs, &farm->pigs))
+    {
+        return reject_farm(csv, line, "pigs", "Invalid pigs");
+    }
+    if (!parse_column_int(fields, field_count, col->chickens, &farm->chickens))
+    {
+        return reject_farm(csv, line, "chickens", "Invalid chickens");
+    }
+    if (!resolve_farm_factor_set(csv, field_count, line, &farm->factor_set))
+    {
+        return -1;
+    }
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%d", &farm->dairy_cows) != 1)
+    double total_area = 0.0;
+    while (field_count != 0)
+    {
+        // A new farm_id starts the next farm; keep its row for the next call
+        if (field_count > 0 && col->farm_id >= 0 && farm->num_crops > 0 &&
+            (col->farm_id >= field_count || !csv_fields_equal(&fields[col->farm_id], &current_id)))
         {
-            printf("Error: Invalid dairy cows in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            csv->pending_count = field_count;
+            csv->pending_line = line;
+            break;
+        }
+        if (farm->num_crops > 0 && !keep_row(csv))
+        {
+            return -1;
+        }
+        if (field_count < 0)
+        {
+            return reject_farm(csv, line, "", "Too many fields");
         }
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%d", &farm->pigs) != 1)
+        CropData *crop = crop_arena_append(arena);
+        if (!crop)
         {
-            printf("Error: Invalid pigs in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            printf("Error: Out of memory reading farm %s (CSV line %d)\n", csv->farm_id, line);
+            return -1;
         }
+        int crop_number = 0;
+        int pesticide_number = 0;
 
-        token = strtok(NULL, ",");
-        if (!token || sscanf(token, "%d", &farm->chickens) != 1)
+        if (!parse_column_int(fields, field_count, col->crop_id, &crop_number))
         {
-            printf("Error: Invalid chickens in CSV line %d\n", line_count);
-            fclose(file);
-            return 0;
+            return reject_farm(csv, line, "crop_id", "Invalid crop_id");
+        }
+        if (!parse_column_double(fields, field_count, col->area, &crop->area))
+        {
+            return reject_farm(csv, line, "area", "Invalid area");
+        }
+        if (!parse_column_double(fields, field_count, col->nitrogen, &crop->nitrogen_kg_ha))
+        {
+            return reject_farm(csv, line, "nitrogen", "Invalid nitrogen");
         }
+        if (!parse_column_double(fields, field_count, col->phosphorus, &crop->phosphorus_kg_ha))
+        {
+            return reject_farm(csv, line, "phosphorus", "Invalid phosphorus");
+        }
+        if (!parse_column_double(fields, field_count, col->potassium, &crop->potassium_kg_ha))
+        {
+            return reject_farm(csv, line, "potassium", "Invalid potassium");
+        }
+        if (!parse_column_double(fields, field_count, col->manure, &crop->manure_kg_ha))
+        {
+            return reject_farm(csv, line, "manure", "Invalid manure");
+        }
+        if (!parse_column_double(fields, field_count, col->diesel, &crop->diesel_l_ha))
+        {
+            return reject_farm(csv, line, "diesel", "Invalid diesel");
+        }
+        if (!parse_column_double(fields, field_count, col->irrigation, &crop->irrigation_mm))
+        {
+            return reject_farm(csv, line, "irrigation", "Invalid irrigation");
+        }
+        if (!parse_column_int(fields, field_count, col->pesticide_id, &pesticide_number))
+        {
+            return reject_farm(csv, line, "pesticide_id", "Invalid pesticide_id");
+        }
+        if (!parse_column_double(fields, field_count, col->pesticide_rate, &crop->pesticide_rate))
+        {
+            return reject_farm(csv, line, "pesticide_rate", "Invalid pesticide_rate");
+        }
+
+        crop->crop_id = crop_number - 1;
+        crop->pesticide_id = pesticide_number - 1;
+        if (crop->pesticide_id < 0)
+        {
+            crop->pesticide_id = -1;
+            crop->pesticide_rate = 0.0;
+        }
+
+        total_area += crop->area;
+        farm->num_crops++;
+
+        field_count = csv_next_row(&csv->reader, fields, CSV_MAX_FIELDS);
+        line = csv->reader.line;
     }
-    else
+
+    if (!has_farm_size)
     {
-        printf("Error: No data found in CSV file\n");
-        fclose(file);
-        return 0;
+        farm->total_farm_size = total_area;
     }
-
-    fclose(file);
     return 1;
 }
 
 int is_valid_crop_type(const char *crop_type)
 {
-    // Check against the predefined crops array
-    for (int i = 0; i < num_crops; i++)
-    {
-        if (strcasecmp(crop_type, crops[i].name) == 0)
-        {
-            return 1;
-        }
-    }
-    return 0;
+    return find_crop_by_name(crop_type) >= 0;
 }
 
 int validate_input(const FarmData *farm) {
+    FarmRecord record;
+
+    // Interactive farms are limited to MAX_CROPS
+    if (farm->num_crops <= 0 || farm->num_crops > MAX_CROPS) {
+        printf("Error: Number of crops must be between 1 and %d\n", MAX_CROPS);
+        return 0;
+    }
+
+    farm_record_from_farm_data(farm, &record);
+    return validate_farm_record(&record, farm->crops);
+}
+
+// Validates a farm whose crops are rows[crop_offset..] (no limit on crop count)
+int validate_farm_record(const FarmRecord *farm, const CropData *rows) {
+    const CropData *farm_crops = rows + farm->crop_offset;
+
     // Total farm size must be positive
     if (farm->total_farm_size <= 0 || farm->total_farm_size > 100000) {
         printf("Error: Total farm size must be greater than 0 and less than 100,000 hectares\n");
@@ -695,60 +1188,65 @@ int validate_input(const FarmData *farm) {
     }
 
     // Must have at least one crop
-    if (farm->num_crops <= 0 || farm->num_crops > 10) {
-        printf("Error: Number of crops must be between 1 and 10\n");
+    if (farm->num_crops <= 0) {
+        printf("Error: Farm must have at least one crop\n");
+        return 0;
+    }
+
+    if (farm->factor_set < 0 || farm->factor_set >= factor_table.num_regions * factor_table.num_years) {
+        printf("Error: Invalid emission factor set %d\n", farm->factor_set);
         return 0;
     }
 
     double total_crop_area = 0.0;
     for (int i = 0; i < farm->num_crops; i++) {
         // Validate crop ID
-        if (farm->crops[i].crop_id < 0 || farm->crops[i].crop_id >= num_crops) {
-            printf("Error: Invalid crop ID %d for crop %d\n", farm->crops[i].crop_id, i + 1);
+        if (farm_crops[i].crop_id < 0 || farm_crops[i].crop_id >= num_crops) {
+            printf("Error: Invalid crop ID %d for crop %d\n", farm_crops[i].crop_id, i + 1);
             return 0;
         }
 
         // Validate area
-        if (farm->crops[i].area < 0 || farm->crops[i].area > 50000) {
+        if (farm_crops[i].area < 0 || farm_crops[i].area > 50000) {
             printf("Error: Crop %d area must be between 0 and 50,000 hectares\n", i + 1);
             return 0;
         }
-        total_crop_area += farm->crops[i].area;
+        total_crop_area += farm_crops[i].area;
 
         // Validate fertilizer values
-        if (farm->crops[i].nitrogen_kg_ha < 0 || farm->crops[i].nitrogen_kg_ha > 1000) {
+        if (farm_crops[i].nitrogen_kg_ha < 0 || farm_crops[i].nitrogen_kg_ha > 1000) {
             printf("Error: Crop %d nitrogen must be between 0 and 1,000 kg/ha\n", i + 1);
             return 0;
         }
-        if (farm->crops[i].phosphorus_kg_ha < 0 || farm->crops[i].phosphorus_kg_ha > 500) {
+        if (farm_crops[i].phosphorus_kg_ha < 0 || farm_crops[i].phosphorus_kg_ha > 500) {
             printf("Error: Crop %d phosphorus must be between 0 and 500 kg/ha\n", i + 1);
             return 0;
         }
-        if (farm->crops[i].potassium_kg_ha < 0 || farm->crops[i].potassium_kg_ha > 500) {
+        if (farm_crops[i].potassium_kg_ha < 0 || farm_crops[i].potassium_kg_ha > 500) {
             printf("Error: Crop %d potassium must be between 0 and 500 kg/ha\n", i + 1);
             return 0;
         }
 
         // Validate other inputs
-        if (farm->crops[i].manure_kg_ha < 0 || farm->crops[i].manure_kg_ha > 50000) {
+        if (farm_crops[i].manure_kg_ha < 0 || farm_crops[i].manure_kg_ha > 50000) {
             printf("Error: Crop %d manure must be between 0 and 50,000 kg/ha\n", i + 1);
             return 0;
         }
-        if (farm->crops[i].diesel_l_ha < 0 || farm->crops[i].diesel_l_ha > 1000) {
+        if (farm_crops[i].diesel_l_ha < 0 || farm_crops[i].diesel_l_ha > 1000) {
             printf("Error: Crop %d diesel must be between 0 and 1,000 L/ha\n", i + 1);
             return 0;
         }
-        if (farm->crops[i].irrigation_mm < 0 || farm->crops[i].irrigation_mm > 2000) {
+        if (farm_crops[i].irrigation_mm < 0 || farm_crops[i].irrigation_mm > 2000) {
             printf("Error: Crop %d irrigation must be between 0 and 2,000 mm\n", i + 1);
             return 0;
         }
 
         // Validate pesticide
-        if (farm->crops[i].pesticide_id >= num_pesticides) {
-            printf("Error: Invalid pesticide ID %d for crop %d\n", farm->crops[i].pesticide_id, i + 1);
+        if (farm_crops[i].pesticide_id >= num_pesticides) {
+            printf("Error: Invalid pesticide ID %d for crop %d\n", farm_crops[i].pesticide_id, i + 1);
             return 0;
         }
-        if (farm->crops[i].pesticide_rate < 0 || farm->crops[i].pesticide_rate > 100) {
+        if (farm_crops[i].pesticide_rate < 0 || farm_crops[i].pesticide_rate > 100) {
             printf("Error: Crop %d pesticide rate must be between 0 and 100 kg/ha\n", i + 1);
             return 0;
         }
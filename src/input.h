@@ -1,6 +1,11 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include "csv.h"
+
+// Crops a farm can have when entered interactively; CSV farms are unlimited
+#define MAX_CROPS 10
+
 // Crop structure with default agronomic parameters
 typedef struct {
     char name[30];
@@ -36,12 +41,31 @@ typedef struct {
 typedef struct {
     double total_farm_size;     // total hectares
     int num_crops;              // number of different crops
-    CropData crops[10];         // up to 10 different crops
+    CropData crops[MAX_CROPS];  // up to MAX_CROPS different crops
     int dairy_cows;             // number of dairy cows
     int pigs;                   // number of pigs
     int chickens;               // number of chickens
 } FarmData;
 
+// Growable store of crop rows shared by many farm records
+typedef struct {
+    CropData *rows;
+    size_t count;
+    size_t capacity;
+} CropArena;
+
+// Variable-length farm: its crops are rows crop_offset to
+// crop_offset + num_crops - 1 of a CropArena (or of any CropData array)
+typedef struct {
+    double total_farm_size;     // total hectares
+    size_t crop_offset;         // first crop row
+    int num_crops;              // number of crop rows
+    int dairy_cows;             // number of dairy cows
+    int pigs;                   // number of pigs
+    int chickens;               // number of chickens
+    int factor_set;             // index in factor_table.sets (region and year)
+} FarmRecord;
+
 // Legacy single-crop structure for backward compatibility
 typedef struct {
     double farm_size;           // hectares
@@ -57,17 +81,73 @@ typedef struct {
     int chickens;               // number of chickens
 } LegacyFarmData;
 
+// Column positions resolved from a multi-crop CSV header (-1 if absent)
+typedef struct {
+    int farm_id;
+    int farm_size;
+    int crop_id;
+    int area;
+    int nitrogen;
+    int phosphorus;
+    int potassium;
+    int manure;
+    int diesel;
+    int irrigation;
+    int pesticide_id;
+    int pesticide_rate;
+    int cows;
+    int pigs;
+    int chickens;
+    int region;
+    int year;
+} MultiCropColumns;
+
+// Why a CSV row was rejected
+typedef struct {
+    int line;
+    const char *field;          // column at fault (NULL if not a bad row, e.g. out of memory)
+    char reason[96];            // e.g. "Invalid nitrogen"
+} CsvRowError;
+
+// Streaming multi-crop CSV reader: consecutive rows sharing a farm_id are
+// grouped into one FarmData record. Without a farm_id column the whole
+// file is a single farm.
+//
+// With keep_going set, the raw rows of each farm are kept in rows, errors
+// are recorded in error instead of printed, and the remaining rows of a
+// rejected farm are consumed (and kept), so the caller can set the farm
+// aside and carry on with the next one.
+typedef struct {
+    CsvReader reader;
+    MultiCropColumns columns;
+    CsvField fields[CSV_MAX_FIELDS];
+    int pending_count;          // fields of a row read ahead for the next farm
+    int pending_line;
+    int keep_going;
+    CsvRow *rows;               // rows of the last farm read or rejected
+    size_t num_rows;
+    size_t row_capacity;
+    CsvField farm_key;          // farm_id field of the farm being read
+    char *farm_id;              // ID of the last farm read, in full
+    size_t farm_id_length;
+    size_t farm_id_capacity;
+    CsvRowError error;
+} MultiCropCsv;
+
 // Global crop and pesticide data
-extern Crop crops[];
+extern Crop *crops;
 extern int num_crops;
-extern Pesticide pesticides[];
+extern Pesticide *pesticides;
 extern int num_pesticides;
 
 // Function declarations
 int read_interactive_input(FarmData *farm);
 int read_legacy_interactive_input(LegacyFarmData *farm);
 int read_csv_input(const char *filename, LegacyFarmData *farm);
+int parse_legacy_csv_fields(const CsvField *fields, int field_count, int line_count, LegacyFarmData *farm);
+const char *parse_legacy_csv_row(const CsvField *fields, int field_count, LegacyFarmData *farm);
 int validate_input(const FarmData *farm);
+int validate_farm_record(const FarmRecord *farm, const CropData *rows);
 int validate_legacy_input(const LegacyFarmData *farm);
 int is_valid_crop_type(const char *crop_type);
 void display_available_crops(void);
@@ -75,5 +155,13 @@ void display_available_pesticides(void);
 int find_crop_by_name(const char *name);
 int find_pesticide_by_name(const char *name);
 void convert_legacy_to_multi_crop(const LegacyFarmData *legacy, FarmData *multi);
+int is_multi_crop_csv(const char *filename);
+int multi_crop_csv_open(MultiCropCsv *csv, const char *filename);
+int multi_crop_csv_next_farm(MultiCropCsv *csv, CropArena *arena, FarmRecord *farm);
+void multi_crop_csv_close(MultiCropCsv *csv);
+void farm_record_from_farm_data(const FarmData *farm, FarmRecord *record);
+CropData *crop_arena_append(CropArena *arena);
+void crop_arena_reset(CropArena *arena);
+void crop_arena_free(CropArena *arena);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include "lookup.h"
+
+// Seeds tried per table size before the perfect hash doubles its slots
+#define PERFECT_SEED_TRIES 256
+#define PERFECT_MAX_SLOTS 8192
+
+// Bumped whenever a table's contents change in place, so indexes rebuild
+static unsigned generation;
+
+static int fold_case(int c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int names_equal(const char *a, const char *b) {
+    while (*a && fold_case((unsigned char)*a) == fold_case((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return fold_case((unsigned char)*a) == fold_case((unsigned char)*b);
+}
+
+// FNV-1a over case-folded bytes, finished with a murmur3 mix so every seed
+// spreads the names differently
+static unsigned hash_name(const char *name, unsigned seed) {
+    unsigned h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (; *name; name++) {
+        h ^= (unsigned)fold_case((unsigned char)*name);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static const char *name_at(const NameIndex *index, int i) {
+    return index->base + (size_t)i * index->stride;
+}
+
+static void clear_slots(NameIndex *index) {
+    for (size_t s = 0; s <= index->mask; s++) {
+        index->slots[s] = -1;
+    }
+}
+
+static int resize_slots(NameIndex *index, size_t size) {
+    int *slots = realloc(index->slots, size * sizeof(int));
+    if (!slots) {
+        return 0;
+    }
+    index->slots = slots;
+    index->mask = size - 1;
+    return 1;
+}
+
+// Looks for a seed under which every name hashes to its own slot
+static int build_perfect(NameIndex *index) {
+    size_t size = 2;
+    while (size < (size_t)index->count * 2) {
+        size *= 2;
+    }
+
+    for (; size <= PERFECT_MAX_SLOTS; size *= 2) {
+        if (!resize_slots(index, size)) {
+            return 0;
+        }
+        for (unsigned seed = 0; seed < PERFECT_SEED_TRIES; seed++) {
+            int collided = 0;
+            clear_slots(index);
+            for (int i = 0; i < index->count && !collided; i++) {
+                size_t slot = hash_name(name_at(index, i), seed) & index->mask;
+                if (index->slots[slot] >= 0) {
+                    // Duplicate names can never be separated
+                    if (names_equal(name_at(index, index->slots[slot]), name_at(index, i))) {
+                        return 0;
+                    }
+                    collided = 1;
+                } else {
+                    index->slots[slot] = i;
+                }
+            }
+            if (!collided) {
+                index->seed = seed;
+                index->perfect = 1;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Open addressing at load factor <= 0.5; the first of duplicate names wins,
+// as with a linear scan
+static int build_probing(NameIndex *index) {
+    size_t size = 2;
+    while (size < (size_t)index->count * 2) {
+        size *= 2;
+    }
+    if (!resize_slots(index, size)) {
+        return 0;
+    }
+
+    clear_slots(index);
+    index->seed = 0;
+    index->perfect = 0;
+    for (int i = 0; i < index->count; i++) {
+        size_t slot = hash_name(name_at(index, i), 0) & index->mask;
+        while (index->slots[slot] >= 0 && !names_equal(name_at(index, index->slots[slot]), name_at(index, i))) {
+            slot = (slot + 1) & index->mask;
+        }
+        if (index->slots[slot] < 0) {
+            index->slots[slot] = i;
+        }
+    }
+    return 1;
+}
+
+static void build_index(NameIndex *index, const void *base, size_t stride, int count) {
+    index->base = base;
+    index->stride = stride;
+    index->count = count;
+    index->generation = generation;
+    index->perfect = 0;
+
+    if (count <= LOOKUP_PERFECT_MAX && build_perfect(index)) {
+        return;
+    }
+    if (!build_probing(index)) {
+        // Out of memory: lookups fall back to a linear scan
+        free(index->slots);
+        index->slots = NULL;
+    }
+}
+
+// Returns the index of name in the table (case-insensitive), or -1. The
+// index is (re)built on first use and whenever the table, its size or
+// lookup_generation() changes. Not thread-safe while rebuilding.
+int name_index_lookup(NameIndex *index, const void *base, size_t stride, int count, const char *name) {
+    if (index->base != base || index->stride != stride || index->count != count ||
+        index->generation != generation) {
+        build_index(index, base, stride, count);
+    }
+
+    if (!index->slots) {
+        for (int i = 0; i < count; i++) {
+            if (names_equal(name, name_at(index, i))) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    size_t slot = hash_name(name, index->seed) & index->mask;
+    if (index->perfect) {
+        int i = index->slots[slot];
+        return (i >= 0 && names_equal(name, name_at(index, i))) ? i : -1;
+    }
+
+    while (index->slots[slot] >= 0) {
+        int i = index->slots[slot];
+        if (names_equal(name, name_at(index, i))) {
+            return i;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    return -1;
+}
+
+void name_index_free(NameIndex *index) {
+    free(index->slots);
+    index->slots = NULL;
+    index->base = NULL;
+    index->count = 0;
+}
+
+unsigned lookup_generation(void) {
+    return generation;
+}
+
+// Call after editing a table in place (same address and size)
+void lookup_invalidate(void) {
+    generation++;
+}
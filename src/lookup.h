@@ -0,0 +1,30 @@
+#ifndef LOOKUP_H
+#define LOOKUP_H
+
+#include <stddef.h>
+
+// Tables up to this many names get a perfect (collision-free) hash
+#define LOOKUP_PERFECT_MAX 64
+
+// Case-insensitive name -> index map over a table of structs whose name
+// field is found at base + i * stride. Small tables use a seed-searched
+// perfect hash, so a lookup is one hash, one probe and one compare; larger
+// (user-loaded) tables use open addressing with linear probing.
+typedef struct {
+    const char *base;
+    size_t stride;
+    int count;
+    unsigned generation;        // lookup_generation() when built
+    int perfect;                // 1 if every name has a slot of its own
+    unsigned seed;
+    size_t mask;
+    int *slots;                 // table index per slot, -1 if empty
+} NameIndex;
+
+// Function declarations
+int name_index_lookup(NameIndex *index, const void *base, size_t stride, int count, const char *name);
+void name_index_free(NameIndex *index);
+unsigned lookup_generation(void);
+void lookup_invalidate(void);
+
+#endif
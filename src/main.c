@@ -9,6 +9,10 @@
  * but symbols will be replaced with ASCII equivalents.
  */
 
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +21,23 @@
 #include "report.h"
 #include "ui.h"
 #include "simple_ui.h"
+#include "batch.h"
+#include "montecarlo.h"
+#include "scenario.h"
+#include "sensitivity.h"
+#include "optimize.h"
+#include "threadpool.h"
+#include "factors.h"
+
+#ifdef _WIN32
+    #include <io.h>
+    #define dup _dup
+    #define dup2 _dup2
+    #define fdopen _fdopen
+    #define fileno _fileno
+#else
+    #include <unistd.h>
+#endif
 
 // ANSI color codes for enhanced display
 #ifdef _WIN32
@@ -93,6 +114,52 @@ void showHelp(void) {
     printf("  Multi-crop:\n");
     printf("    crop_id,area,nitrogen,phosphorus,potassium,manure,diesel,irrigation,pesticide_id,pesticide_rate\n");
     printf("    1,10.0,120.0,60.0,30.0,2000.0,80.0,450.0,1,2.5\n");
+    printf("    Optional columns: farm_id (groups rows into farms), farm_size, cows, pigs, chickens,\n");
+    printf("                      region, year (select factor pack sets)\n");
+    printf("\n");
+    printf("Streaming batch mode (every row, one result line per farm):\n");
+    printf("  carbon --batch data/sample_input.csv > results.txt\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --threads 8   (0 or auto = all CPUs)\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --rollup crop,region,size,pesticide [--rollup-only]\n");
+    printf("  Rollups are summed with --sum neumaier (default), pairwise or naive\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --format csv|jsonl [--per-crop] > results.csv\n");
+    printf("  (one CSV row or JSON object per farm, or per crop, for loading into other tools)\n");
+    printf("  --on-error skip   (set bad rows and invalid farms aside instead of stopping)\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --quarantine rejected.csv --max-error-rate 0.1\n");
+    printf("  (rejected rows go to the quarantine file; the run fails if over 0.1%% of rows are rejected)\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --report reports.txt   (or --report-append FILE)\n");
+    printf("  (the full report of every farm in one file, written through a 1 MB buffer)\n");
+    printf("  carbon --batch data/multi_farm_sample.csv --binary results.bin [--binary-plain]\n");
+    printf("  carbon --results results.bin [--rollup DIMS]   (re-total a binary result file)\n");
+    printf("  (every crop result in a columnar file; crop and pesticide ids are dictionary encoded\n");
+    printf("   unless --binary-plain; read it with the same factor pack it was written with)\n");
+    printf("  carbon --bench-sum [N]   (throughput and error of each summation mode)\n");
+    printf("  carbon --kernel-info   (show and self-check the SIMD emission kernels)\n");
+    printf("\n");
+    printf("Monte Carlo uncertainty (multi-crop CSV, spread of each category and crop):\n");
+    printf("  carbon --monte-carlo data/multi_farm_sample.csv --draws 100000 --threads auto\n");
+    printf("  Options: --draws N (default %d), --seed S, --input-noise R (relative SD of crop inputs)\n",
+           MC_DEFAULT_DRAWS);
+    printf("  Factor distributions come from the [uncertainty] section of a factor pack.\n");
+    printf("\n");
+    printf("What-if scenario grids (every combination, one table per farm):\n");
+    printf("  carbon --scenario data/multi_farm_sample.csv --grid \"n=-10:-50:10,diesel=0/-15/-30\"\n");
+    printf("  Levers: n, p, k, manure, diesel, irrigation, pesticide, cows, pigs, chickens\n");
+    printf("  Values are %% changes: V, FROM:TO:STEP or V1/V2/...\n");
+    printf("\n");
+    printf("Sensitivity (exact derivatives, levers ranked by elasticity, per farm and overall):\n");
+    printf("  carbon --sensitivity data/multi_farm_sample.csv [--top 5] [--summary]\n");
+    printf("\n");
+    printf("Emission-reduction optimizer (lowest emissions that keep a share of the yield):\n");
+    printf("  carbon --optimize data/multi_farm_sample.csv [--min-yield 95] [--summary]\n");
+    printf("  Bounds in %% (defaults %.0f, %.0f): --floor (N, P, K and irrigation, of the crop default),\n",
+           OPT_DEFAULT_FLOOR, OPT_DEFAULT_DIESEL_FLOOR);
+    printf("  --diesel-floor (of the current diesel rate); pesticides swap to the lowest-factor one of their type\n");
+    printf("\n");
+    printf("Emission factor packs (regional factors, crops and pesticides):\n");
+    printf("  carbon --factors data/factors.txt [mode options...]\n");
+    printf("  %s=data/factors.txt carbon ...   (used when --factors is not given)\n", FACTOR_PACK_ENV);
+    printf("  The pack is compiled to <pack>.bin on first use and loaded from there.\n");
     printf("\n");
     printf("For more information, see the README.md file.\n");
     printf("\n");
@@ -274,9 +341,498 @@ int runBatchMode(void) {
     return 0;
 }
 
+// Parses a --threads value: a count, or 0/auto for every CPU
+int parseThreadCount(const char *value, int *threads) {
+    char *end;
+    long count = strtol(value, &end, 10);
+
+    if (strcmp(value, "auto") == 0 || (*end == '\0' && count == 0)) {
+        *threads = available_cpu_count();
+    } else if (*end != '\0' || count < 0 || count > MAX_THREADS) {
+        printf("%sError: --threads expects a number from 0 to %d or 'auto'%s\n",
+               COLOR_WARNING, MAX_THREADS, COLOR_RESET);
+        return 0;
+    } else {
+        *threads = (int)count;
+    }
+    return 1;
+}
+
+// Parses a percentage option value from 0 to 100 into a share
+int parsePercent(const char *name, const char *value, double *share) {
+    char *end;
+    double percent = strtod(value, &end);
+
+    if (*end != '\0' || end == value || !(percent >= 0.0 && percent <= 100.0)) {
+        printf("%sError: %s expects a percentage from 0 to 100%s\n", COLOR_WARNING, name, COLOR_RESET);
+        return 0;
+    }
+    *share = percent / 100.0;
+    return 1;
+}
+
+// Parses the options that follow "--batch <file>". Returns 0 on a bad option.
+int parseBatchOptions(int argc, char *argv[], BatchOptions *options) {
+    options->input_path = argv[2];
+    options->output = stdout;
+    options->threads = 1;
+    options->rollup = 0;
+    options->sum_mode = SUM_NEUMAIER;
+    options->farm_lines = 1;
+    options->format = RESULT_TABLE;
+    options->per_crop = 0;
+    options->skip_invalid = 0;
+    options->quarantine = NULL;
+    options->quarantine_path = NULL;
+    options->max_error_rate = 1.0;
+    options->report = NULL;
+    options->report_path = NULL;
+    options->report_append = 0;
+    options->binary_path = NULL;
+    options->binary_dictionary = 1;
+    int on_error_stop = 0;
+    int error_budget = 0;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parseThreadCount(argv[++i], &options->threads)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--on-error") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "stop") == 0) {
+                options->skip_invalid = 0;
+                on_error_stop = 1;
+            } else if (strcmp(mode, "skip") == 0) {
+                options->skip_invalid = 1;
+            } else {
+                printf("%sError: --on-error expects stop or skip%s\n", COLOR_WARNING, COLOR_RESET);
+                return 0;
+            }
+        } else if ((strcmp(argv[i], "--report") == 0 || strcmp(argv[i], "--report-append") == 0) && i + 1 < argc) {
+            options->report_append = strcmp(argv[i], "--report-append") == 0;
+            options->report_path = argv[++i];
+        } else if (strcmp(argv[i], "--binary") == 0 && i + 1 < argc) {
+            options->binary_path = argv[++i];
+        } else if (strcmp(argv[i], "--binary-plain") == 0) {
+            options->binary_dictionary = 0;
+        } else if (strcmp(argv[i], "--quarantine") == 0 && i + 1 < argc) {
+            options->quarantine_path = argv[++i];
+        } else if (strcmp(argv[i], "--max-error-rate") == 0 && i + 1 < argc) {
+            if (!parsePercent("--max-error-rate", argv[++i], &options->max_error_rate)) {
+                return 0;
+            }
+            error_budget = 1;
+        } else if (strcmp(argv[i], "--rollup") == 0 && i + 1 < argc) {
+            if (!parse_rollup_dimensions(argv[++i], &options->rollup)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parse_result_format(argv[++i], &options->format)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--per-crop") == 0) {
+            options->per_crop = 1;
+        } else if (strcmp(argv[i], "--rollup-only") == 0) {
+            options->farm_lines = 0;
+        } else if (strcmp(argv[i], "--sum") == 0 && i + 1 < argc) {
+            if (!parse_sum_mode(argv[++i], &options->sum_mode)) {
+                return 0;
+            }
+        } else {
+            printf("%sError: Unknown batch option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 0;
+        }
+    }
+    if (!options->farm_lines && !options->rollup) {
+        printf("%sError: --rollup-only needs --rollup%s\n", COLOR_WARNING, COLOR_RESET);
+        return 0;
+    }
+    if (options->per_crop && options->format == RESULT_TABLE) {
+        printf("%sError: --per-crop needs --format csv or jsonl%s\n", COLOR_WARNING, COLOR_RESET);
+        return 0;
+    }
+    // Rollup tables are text only; in a records stream they would break it up
+    if (options->format != RESULT_TABLE && options->rollup) {
+        printf("%sError: --format %s cannot be used with rollup tables (they are printed as text)%s\n",
+               COLOR_WARNING, result_format_name(options->format), COLOR_RESET);
+        return 0;
+    }
+
+    // Setting bad rows aside is what a quarantine or error budget is for
+    if (options->quarantine_path || error_budget) {
+        if (on_error_stop) {
+            printf("%sError: --quarantine and --max-error-rate need --on-error skip%s\n", COLOR_WARNING, COLOR_RESET);
+            return 0;
+        }
+        options->skip_invalid = 1;
+    }
+    return 1;
+}
+
+// Parses the options that follow "--monte-carlo <file>". Returns 0 on a bad option.
+int parseMonteCarloOptions(int argc, char *argv[], MonteCarloOptions *options) {
+    options->input_path = argv[2];
+    options->output = stdout;
+    options->draws = MC_DEFAULT_DRAWS;
+    options->seed = 1;
+    options->input_noise = 0.0;
+    options->threads = 1;
+
+    for (int i = 3; i < argc; i++) {
+        char *end;
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parseThreadCount(argv[++i], &options->threads)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc) {
+            options->draws = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || options->draws < 1 || options->draws > MC_MAX_DRAWS) {
+                printf("%sError: --draws expects a number from 1 to %d%s\n", COLOR_WARNING, MC_MAX_DRAWS, COLOR_RESET);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            const char *value = argv[++i];
+            options->seed = (uint64_t)strtoull(value, &end, 10);
+            if (*value == '-' || *value == '\0' || *end != '\0') {
+                printf("%sError: --seed expects a non-negative integer%s\n", COLOR_WARNING, COLOR_RESET);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--input-noise") == 0 && i + 1 < argc) {
+            options->input_noise = strtod(argv[++i], &end);
+            if (*end != '\0' || !(options->input_noise >= 0.0 && options->input_noise <= 1.0)) {
+                printf("%sError: --input-noise expects a relative deviation from 0 to 1%s\n", COLOR_WARNING, COLOR_RESET);
+                return 0;
+            }
+        } else {
+            printf("%sError: Unknown Monte Carlo option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parses the options that follow "--scenario <file>". Returns 0 on a bad option.
+int parseScenarioOptions(int argc, char *argv[], ScenarioOptions *options) {
+    int have_grid = 0;
+
+    options->input_path = argv[2];
+    options->output = stdout;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            if (!parse_scenario_grid(argv[++i], &options->grid)) {
+                return 0;
+            }
+            have_grid = 1;
+        } else {
+            printf("%sError: Unknown scenario option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 0;
+        }
+    }
+    if (!have_grid) {
+        printf("%sError: --scenario needs a --grid, e.g. --grid \"n=-10:-50:10,diesel=0/-20\"%s\n",
+               COLOR_WARNING, COLOR_RESET);
+        return 0;
+    }
+    return 1;
+}
+
+// Parses the options that follow "--sensitivity <file>". Returns 0 on a bad option.
+int parseSensitivityOptions(int argc, char *argv[], SensitivityOptions *options) {
+    options->input_path = argv[2];
+    options->output = stdout;
+    options->top = 0;
+    options->per_farm = 1;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            char *end;
+            long top = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || top < 0 || top > 1000) {
+                printf("%sError: --top expects a number from 0 (all) to 1000%s\n", COLOR_WARNING, COLOR_RESET);
+                return 0;
+            }
+            options->top = (int)top;
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            options->per_farm = 0;
+        } else {
+            printf("%sError: Unknown sensitivity option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parses the options that follow "--optimize <file>". Returns 0 on a bad option.
+int parseOptimizeOptions(int argc, char *argv[], OptimizeOptions *options) {
+    options->input_path = argv[2];
+    options->output = stdout;
+    options->bounds.min_yield = OPT_DEFAULT_MIN_YIELD / 100.0;
+    options->bounds.floor = OPT_DEFAULT_FLOOR / 100.0;
+    options->bounds.diesel_floor = OPT_DEFAULT_DIESEL_FLOOR / 100.0;
+    options->per_farm = 1;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--min-yield") == 0 && i + 1 < argc) {
+            if (!parsePercent("--min-yield", argv[++i], &options->bounds.min_yield)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--floor") == 0 && i + 1 < argc) {
+            if (!parsePercent("--floor", argv[++i], &options->bounds.floor)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--diesel-floor") == 0 && i + 1 < argc) {
+            if (!parsePercent("--diesel-floor", argv[++i], &options->bounds.diesel_floor)) {
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            options->per_farm = 0;
+        } else {
+            printf("%sError: Unknown optimize option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int runOptimize(const OptimizeOptions *options) {
+    long farms = 0;
+
+    if (!run_optimize(options, &farms)) {
+        fprintf(stderr, "%sOptimization stopped after %ld farm(s).%s\n", COLOR_WARNING, farms, COLOR_RESET);
+        return 1;
+    }
+    fprintf(stderr, "%sOptimized %ld farm(s) from %s%s\n",
+            COLOR_SUCCESS, farms, options->input_path, COLOR_RESET);
+    return 0;
+}
+
+int runSensitivity(const SensitivityOptions *options) {
+    long farms = 0;
+
+    if (!run_sensitivity(options, &farms)) {
+        fprintf(stderr, "%sSensitivity run stopped after %ld farm(s).%s\n", COLOR_WARNING, farms, COLOR_RESET);
+        return 1;
+    }
+    fprintf(stderr, "%sDifferentiated %ld farm(s) from %s%s\n",
+            COLOR_SUCCESS, farms, options->input_path, COLOR_RESET);
+    return 0;
+}
+
+int runScenarios(const ScenarioOptions *options) {
+    long farms = 0;
+
+    if (!run_scenarios(options, &farms)) {
+        fprintf(stderr, "%sScenario run stopped after %ld farm(s).%s\n", COLOR_WARNING, farms, COLOR_RESET);
+        return 1;
+    }
+    fprintf(stderr, "%sEvaluated %ld scenario(s) for each of %ld farm(s) from %s%s\n",
+            COLOR_SUCCESS, scenario_count(&options->grid), farms, options->input_path, COLOR_RESET);
+    return 0;
+}
+
+int runMonteCarlo(const MonteCarloOptions *options) {
+    long farms = 0;
+
+    if (!run_monte_carlo(options, &farms)) {
+        fprintf(stderr, "%sMonte Carlo run stopped after %ld farm(s).%s\n", COLOR_WARNING, farms, COLOR_RESET);
+        return 1;
+    }
+    fprintf(stderr, "%sSampled %ld farm(s) from %s, %ld draws each (seed %llu)%s\n",
+            COLOR_SUCCESS, farms, options->input_path, options->draws,
+            (unsigned long long)options->seed, COLOR_RESET);
+    return 0;
+}
+
+// With --format csv or jsonl stdout carries nothing but records, yet the
+// readers and validators print their diagnostics with printf. The records
+// get a stream of their own on the original stdout, and stdout itself is
+// pointed at stderr. Returns 0 if that fails.
+static int separateRecords(BatchOptions *options) {
+    FILE *records = NULL;
+    int fd;
+
+    fflush(stdout);
+    fd = dup(fileno(stdout));
+    if (fd >= 0) {
+        records = fdopen(fd, "w");
+    }
+    if (!records || dup2(fileno(stderr), fileno(stdout)) < 0) {
+        fprintf(stderr, "%sError: Cannot separate records from diagnostics%s\n", COLOR_WARNING, COLOR_RESET);
+        if (records) fclose(records);
+        return 0;
+    }
+    options->output = records;
+    return 1;
+}
+
+int runStreamingBatch(BatchOptions *options) {
+    BatchStats stats = {0};
+    ReportWriter report;
+
+    if (options->format != RESULT_TABLE && !separateRecords(options)) {
+        return 1;
+    }
+    if (options->quarantine_path) {
+        options->quarantine = fopen(options->quarantine_path, "w");
+        if (!options->quarantine) {
+            printf("%sError: Cannot create quarantine file %s%s\n", COLOR_WARNING, options->quarantine_path, COLOR_RESET);
+            return 1;
+        }
+    }
+    if (options->report_path) {
+        if (!report_writer_open(&report, options->report_path, options->report_append)) {
+            printf("%sError: Cannot create report file %s%s\n", COLOR_WARNING, options->report_path, COLOR_RESET);
+            if (options->quarantine) fclose(options->quarantine);
+            return 1;
+        }
+        options->report = &report;
+    }
+    int ok = run_batch(options, &stats);
+    if (options->output != stdout) {
+        if (ferror(options->output) | (fclose(options->output) != 0)) {
+            fprintf(stderr, "%sError: Could not write the results%s\n", COLOR_WARNING, COLOR_RESET);
+            ok = 0;
+        }
+        options->output = stdout;
+    }
+    fflush(stdout);
+    if (options->quarantine) {
+        // ferror() catches writes that failed before the final flush
+        if (ferror(options->quarantine) | (fclose(options->quarantine) != 0)) {
+            printf("%sError: Could not write quarantine file %s%s\n", COLOR_WARNING, options->quarantine_path, COLOR_RESET);
+            ok = 0;
+        }
+        options->quarantine = NULL;
+    }
+    if (options->report) {
+        if (!report_writer_close(options->report)) {
+            printf("%sError: Could not write report file %s%s\n", COLOR_WARNING, options->report_path, COLOR_RESET);
+            ok = 0;
+        }
+        options->report = NULL;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%sBatch processing stopped after %ld farm(s).%s\n",
+                COLOR_WARNING, stats.farms_processed, COLOR_RESET);
+        return 1;
+    }
+
+    fprintf(stderr, "%sProcessed %ld farm(s) from %s%s\n",
+            COLOR_SUCCESS, stats.farms_processed, options->input_path, COLOR_RESET);
+    if (options->report_path) {
+        fprintf(stderr, "%sFull reports written to %s%s\n", COLOR_SUCCESS, options->report_path, COLOR_RESET);
+    }
+    if (options->binary_path) {
+        fprintf(stderr, "%sCrop results written to %s%s\n", COLOR_SUCCESS, options->binary_path, COLOR_RESET);
+    }
+    if (stats.farms_skipped > 0) {
+        fprintf(stderr, "%sSkipped %ld invalid farm(s) (%ld row(s))%s%s%s\n",
+                COLOR_WARNING, stats.farms_skipped, stats.rows_rejected,
+                options->quarantine_path ? ", see " : "",
+                options->quarantine_path ? options->quarantine_path : "", COLOR_RESET);
+    }
+    return 0;
+}
+
+// Re-aggregates a binary result file written by --batch --binary: maps it
+// and totals its crop rows by the rollup dimensions (crop by default)
+int runResultFile(int argc, char *argv[]) {
+    unsigned dimensions = 1u << ROLLUP_CROP;
+    SumMode mode = SUM_NEUMAIER;
+    ResultFile file;
+    Rollup rollup;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--rollup") == 0 && i + 1 < argc) {
+            if (!parse_rollup_dimensions(argv[++i], &dimensions)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sum") == 0 && i + 1 < argc) {
+            if (!parse_sum_mode(argv[++i], &mode)) {
+                return 1;
+            }
+        } else {
+            printf("%sError: Unknown results option '%s'%s\n", COLOR_WARNING, argv[i], COLOR_RESET);
+            return 1;
+        }
+    }
+
+    if (!result_file_open(&file, argv[2])) {
+        return 1;
+    }
+    if (!rollup_init(&rollup, dimensions, mode, 0)) {
+        printf("%sError: Out of memory%s\n", COLOR_WARNING, COLOR_RESET);
+        result_file_close(&file);
+        return 1;
+    }
+    int ok = rollup_result_file(&file, &rollup);
+    if (ok) {
+        printf("%s: %llu crop result(s) of %llu farm(s) in %lu group(s), %.1f MB%s\n", argv[2],
+               (unsigned long long)file.header->num_rows, (unsigned long long)file.header->num_farms,
+               (unsigned long)result_file_groups(&file), (double)file.size / (1024.0 * 1024.0),
+               (file.header->flags & RESULT_FILE_DICTIONARY) ? ", dictionary encoded" : "");
+        print_rollup(stdout, &rollup);
+    }
+    rollup_free(&rollup);
+    result_file_close(&file);
+    return ok ? 0 : 1;
+}
+
+// Lists the SIMD kernels this CPU supports and checks each one against the
+// scalar kernel. Returns non-zero if any variant exceeds KERNEL_MAX_ULP.
+int runKernelInfo(void) {
+    int failures = 0;
+
+    printf("Emission kernel variants (selected: %s)\n", kernel_variant_name(get_kernel_variant()));
+    for (int v = 0; v < KERNEL_COUNT; v++) {
+        long long ulp = kernel_max_ulp_difference((KernelVariant)v, 100003);
+        if (ulp < 0) {
+            printf("  %-8s not supported on this CPU\n", kernel_variant_name((KernelVariant)v));
+            continue;
+        }
+        int ok = ulp <= KERNEL_MAX_ULP;
+        printf("  %-8s max difference vs scalar: %lld ULP %s\n",
+               kernel_variant_name((KernelVariant)v), ulp, ok ? "(ok)" : "(FAILED)");
+        if (!ok) failures++;
+    }
+    printf("Set CARBON_KERNEL=scalar|sse2|avx2|avx512 to force a variant.\n");
+    return failures ? 1 : 0;
+}
+
+int runSumBenchmark(int argc, char *argv[]) {
+    size_t terms = SUM_BENCH_DEFAULT_TERMS;
+
+    if (argc > 2) {
+        char *end;
+        long long value = strtoll(argv[2], &end, 10);
+        if (*end != '\0' || value < 1 || value > 1000000000LL) {
+            printf("%sError: --bench-sum expects a number of terms from 1 to 1000000000%s\n",
+                   COLOR_WARNING, COLOR_RESET);
+            return 1;
+        }
+        terms = (size_t)value;
+    }
+    return run_sum_benchmark(stdout, terms) ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
     int choice;
     int continue_program = 1;
+
+    // A factor pack replaces the built-in factors for every mode
+    const char *factor_pack = getenv(FACTOR_PACK_ENV);
+    if (argc > 2 && strcmp(argv[1], "--factors") == 0) {
+        factor_pack = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    if (factor_pack && *factor_pack && !load_factor_pack(factor_pack)) {
+        printf("%sFailed to load factor pack: %s%s\n", COLOR_WARNING, factor_pack, COLOR_RESET);
+        return 1;
+    }
     
     // If command line arguments are provided, handle legacy mode for backward compatibility
     if (argc > 1) {
@@ -287,7 +843,93 @@ int main(int argc, char *argv[]) {
             return runAdvancedUiMode();
         } else if (strcmp(argv[1], "--simple") == 0) {
             return runSimpleUiMode();
+        } else if (strcmp(argv[1], "--kernel-info") == 0) {
+            return runKernelInfo();
+        } else if (strcmp(argv[1], "--bench-sum") == 0) {
+            return runSumBenchmark(argc, argv);
+        } else if (strcmp(argv[1], "--results") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --results <file.bin> [--rollup DIMS] [--sum MODE]%s\n",
+                       COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            return runResultFile(argc, argv);
+        } else if (strcmp(argv[1], "--batch") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --batch <file.csv> [--threads N] [--rollup DIMS] [--rollup-only] [--sum MODE] [--format table|csv|jsonl] [--per-crop] [--on-error stop|skip] [--quarantine FILE] [--max-error-rate PCT] [--report FILE] [--binary FILE]%s\n", COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            BatchOptions options;
+            if (!parseBatchOptions(argc, argv, &options)) {
+                return 1;
+            }
+            return runStreamingBatch(&options);
+        } else if (strcmp(argv[1], "--monte-carlo") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --monte-carlo <file.csv> [--draws N] [--seed S] [--threads N] [--input-noise R]%s\n",
+                       COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            MonteCarloOptions options;
+            if (!parseMonteCarloOptions(argc, argv, &options)) {
+                return 1;
+            }
+            return runMonteCarlo(&options);
+        } else if (strcmp(argv[1], "--scenario") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --scenario <file.csv> --grid \"lever=values,...\"%s\n",
+                       COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            ScenarioOptions options;
+            if (!parseScenarioOptions(argc, argv, &options)) {
+                return 1;
+            }
+            return runScenarios(&options);
+        } else if (strcmp(argv[1], "--sensitivity") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --sensitivity <file.csv> [--top N] [--summary]%s\n",
+                       COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            SensitivityOptions options;
+            if (!parseSensitivityOptions(argc, argv, &options)) {
+                return 1;
+            }
+            return runSensitivity(&options);
+        } else if (strcmp(argv[1], "--optimize") == 0) {
+            if (argc < 3) {
+                printf("%sUsage: %s --optimize <file.csv> [--min-yield PCT] [--floor PCT] [--diesel-floor PCT] [--summary]%s\n",
+                       COLOR_WARNING, argv[0], COLOR_RESET);
+                return 1;
+            }
+            OptimizeOptions options;
+            if (!parseOptimizeOptions(argc, argv, &options)) {
+                return 1;
+            }
+            return runOptimize(&options);
         } else {
+            // Multi-crop CSV files are reported farm by farm
+            if (is_multi_crop_csv(argv[1])) {
+                FarmReport last;
+
+                printf("Reading multi-crop input from CSV file: %s\n", argv[1]);
+                int farms = report_multi_crop_file(argv[1], &last);
+                if (farms < 0) {
+                    farm_report_free(&last);
+                    printf("%sFailed to read input data. Exiting.%s\n", COLOR_WARNING, COLOR_RESET);
+                    return 1;
+                }
+                if (farms == 1) {
+                    save_farm_record_report_to_file(&last.farm, &last.results, last.crop_results, "report.txt");
+                } else {
+                    printf("%sReported %d farms. Use --batch for a one-line-per-farm summary.%s\n",
+                           COLOR_SUCCESS, farms, COLOR_RESET);
+                }
+                farm_report_free(&last);
+                return 0;
+            }
+
             // CSV file mode - legacy support
             LegacyFarmData legacy_farm = {0};
             EmissionResults results;
@@ -0,0 +1,514 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "montecarlo.h"
+#include "batch.h"
+#include "threadpool.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Sampled result series of a farm: the categories, then one total per crop
+enum {
+    SERIES_FERTILIZER = 0,
+    SERIES_MANURE,
+    SERIES_FUEL,
+    SERIES_IRRIGATION,
+    SERIES_PESTICIDE,
+    SERIES_LIVESTOCK,
+    SERIES_TOTAL,
+    SERIES_CROPS
+};
+
+// Crop inputs perturbed by --input-noise
+enum {
+    NOISE_NITROGEN = 0,
+    NOISE_PHOSPHORUS,
+    NOISE_POTASSIUM,
+    NOISE_MANURE,
+    NOISE_DIESEL,
+    NOISE_IRRIGATION,
+    NOISE_PESTICIDE,
+    NOISE_INPUTS
+};
+
+// Default ranges follow the spread of the IPCC 2006/2019 defaults: direct
+// N2O and manure factors span about an order of magnitude, fuel combustion
+// factors are tight, enteric fermentation is within roughly +-20-30%
+FactorUncertainty factor_uncertainty[MC_NUM_FACTORS] = {
+    {DIST_LOGNORMAL,  0.5,  0.0},   // nitrogen
+    {DIST_NORMAL,     0.2,  0.0},   // phosphorus
+    {DIST_NORMAL,     0.2,  0.0},   // potassium
+    {DIST_LOGNORMAL,  0.5,  0.0},   // manure
+    {DIST_NORMAL,     0.05, 0.0},   // diesel
+    {DIST_TRIANGULAR, 0.7,  1.5},   // irrigation (pumping energy varies)
+    {DIST_NORMAL,     0.2,  0.0},   // cow
+    {DIST_NORMAL,     0.3,  0.0},   // pig
+    {DIST_NORMAL,     0.3,  0.0},   // chicken
+    {DIST_LOGNORMAL,  0.4,  0.0}    // pesticide
+};
+
+static const char *const factor_names[MC_NUM_FACTORS] = {
+    "nitrogen", "phosphorus", "potassium", "manure", "diesel",
+    "irrigation", "cow", "pig", "chicken", "pesticide"
+};
+
+static const char *const category_labels[SERIES_CROPS] = {
+    "Fertilizer", "Manure", "Fuel", "Irrigation", "Pesticide", "Livestock", "TOTAL"
+};
+
+// One farm being sampled. The series hold (SERIES_CROPS + num_crops) rows
+// of draws values each.
+typedef struct {
+    const FarmRecord *farm;
+    const CropData *rows;       // the farm's crops
+    EmissionFactors factors;
+    double total_crop_area;
+    long farm_index;            // position in the file, part of the RNG key
+    long draws;
+    uint64_t seed;
+    double input_noise;
+    double *series;
+    int failed;                 // a task ran out of memory
+} McFarmJob;
+
+typedef struct {
+    McFarmJob *job;
+    long begin;
+    long end;
+} McChunk;
+
+typedef struct {
+    double *values;
+    long count;
+    McSummary *summary;
+} McSeriesTask;
+
+const char *mc_factor_name(int factor) {
+    return factor >= 0 && factor < MC_NUM_FACTORS ? factor_names[factor] : NULL;
+}
+
+// Parses "none", "normal SD", "lognormal SIGMA" or "triangular LOW HIGH"
+int parse_factor_uncertainty(const char *text, FactorUncertainty *uncertainty) {
+    char name[16];
+    double a = 0.0, b = 0.0;
+    char extra;
+    int fields = sscanf(text, "%15s %lf %lf %c", name, &a, &b, &extra);
+
+    if (fields == 1 && strcmp(name, "none") == 0) {
+        uncertainty->distribution = DIST_NONE;
+    } else if (fields == 2 && strcmp(name, "normal") == 0 && a >= 0.0) {
+        uncertainty->distribution = DIST_NORMAL;
+    } else if (fields == 2 && strcmp(name, "lognormal") == 0 && a >= 0.0) {
+        uncertainty->distribution = DIST_LOGNORMAL;
+    } else if (fields == 3 && strcmp(name, "triangular") == 0 && a >= 0.0 && a <= 1.0 && b >= 1.0 && b > a) {
+        uncertainty->distribution = DIST_TRIANGULAR;
+    } else {
+        return 0;
+    }
+    uncertainty->a = a;
+    uncertainty->b = b;
+    return 1;
+}
+
+// Counter-based generator: the bits for (key, counter) are a SplitMix64
+// finalizer of the pair, so every draw is produced independently of the
+// others and results do not depend on how draws are split across threads
+static uint64_t mc_random(uint64_t key, uint64_t counter) {
+    uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in the open interval (0, 1)
+static double mc_uniform(uint64_t bits) {
+    return ((double)(bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Key of one random stream (a factor, or one input of one crop) of a farm
+static uint64_t stream_key(uint64_t seed, long farm_index, long stream) {
+    return mc_random(mc_random(seed, (uint64_t)farm_index), (uint64_t)stream);
+}
+
+// Standard normals for draws [begin, begin + count) by Box-Muller: draws
+// 2k and 2k + 1 are the cosine and sine halves of pair k. begin is even.
+static void fill_normals(uint64_t key, long begin, long count, double *out) {
+    for (long i = 0; i < count; i += 2) {
+        uint64_t pair = (uint64_t)(begin + i) >> 1;
+        double u1 = mc_uniform(mc_random(key, 2 * pair));
+        double u2 = mc_uniform(mc_random(key, 2 * pair + 1));
+        double radius = sqrt(-2.0 * log(u1));
+        double angle = 2.0 * M_PI * u2;
+
+        out[i] = radius * cos(angle);
+        if (i + 1 < count) {
+            out[i + 1] = radius * sin(angle);
+        }
+    }
+}
+
+// Multipliers on a factor for draws [begin, begin + count)
+static void fill_multipliers(const FactorUncertainty *uncertainty, uint64_t key,
+                             long begin, long count, double *out) {
+    double a = uncertainty->a;
+    double b = uncertainty->b;
+
+    switch (uncertainty->distribution) {
+        case DIST_NORMAL:
+            // Truncated at zero: a factor cannot turn negative
+            fill_normals(key, begin, count, out);
+            for (long i = 0; i < count; i++) {
+                double m = 1.0 + a * out[i];
+                out[i] = m > 0.0 ? m : 0.0;
+            }
+            break;
+        case DIST_LOGNORMAL:
+            fill_normals(key, begin, count, out);
+            for (long i = 0; i < count; i++) {
+                out[i] = exp(a * out[i] - 0.5 * a * a);
+            }
+            break;
+        case DIST_TRIANGULAR: {
+            double mode_cdf = (1.0 - a) / (b - a);
+            for (long i = 0; i < count; i++) {
+                double u = mc_uniform(mc_random(key, (uint64_t)(begin + i)));
+                out[i] = u < mode_cdf ? a + sqrt(u * (b - a) * (1.0 - a))
+                                      : b - sqrt((1.0 - u) * (b - a) * (b - 1.0));
+            }
+            break;
+        }
+        default:
+            for (long i = 0; i < count; i++) {
+                out[i] = 1.0;
+            }
+            break;
+    }
+}
+
+// Evaluates draws [begin, end) of a farm. Each crop is one pass over the
+// chunk's draws with the factor multipliers as columns, so the arithmetic
+// loop is branch-free and vectorizes across draws. With every multiplier
+// at 1 it reproduces calculate_emissions() exactly.
+static void evaluate_chunk(void *arg, int worker) {
+    McChunk *chunk = arg;
+    McFarmJob *job = chunk->job;
+    const EmissionFactors *f = &job->factors;
+    long begin = chunk->begin;
+    long n = chunk->end - begin;
+    (void)worker;
+
+    double *scratch = malloc((size_t)n * (MC_NUM_FACTORS + NOISE_INPUTS + 1) * sizeof(double));
+    if (!scratch) {
+        job->failed = 1;
+        return;
+    }
+    double *m[MC_NUM_FACTORS];
+    double *noise[NOISE_INPUTS];
+    double *livestock = scratch + (size_t)n * (MC_NUM_FACTORS + NOISE_INPUTS);
+    for (int k = 0; k < MC_NUM_FACTORS; k++) {
+        m[k] = scratch + (size_t)n * k;
+        fill_multipliers(&factor_uncertainty[k], stream_key(job->seed, job->farm_index, k), begin, n, m[k]);
+    }
+    for (int k = 0; k < NOISE_INPUTS; k++) {
+        noise[k] = scratch + (size_t)n * (MC_NUM_FACTORS + k);
+    }
+
+    double *series[SERIES_CROPS];
+    for (int s = 0; s < SERIES_CROPS; s++) {
+        series[s] = job->series + (size_t)s * job->draws + begin;
+        memset(series[s], 0, (size_t)n * sizeof(double));
+    }
+
+    int cows = job->farm->dairy_cows, pigs = job->farm->pigs, chickens = job->farm->chickens;
+    for (long d = 0; d < n; d++) {
+        livestock[d] = cows * (f->cow * m[MC_COW][d]) / 1000.0 +
+                       pigs * (f->pig * m[MC_PIG][d]) / 1000.0 +
+                       chickens * (f->chicken * m[MC_CHICKEN][d]) / 1000.0;
+    }
+
+    FactorUncertainty input_noise = {job->input_noise > 0.0 ? DIST_NORMAL : DIST_NONE, job->input_noise, 0.0};
+    for (int k = 0; k < NOISE_INPUTS && input_noise.distribution == DIST_NONE; k++) {
+        fill_multipliers(&input_noise, 0, begin, n, noise[k]);
+    }
+    for (int i = 0; i < job->farm->num_crops; i++) {
+        const CropData *crop = &job->rows[i];
+        double *crop_total = job->series + (size_t)(SERIES_CROPS + i) * job->draws + begin;
+        double share = job->total_crop_area > 0 ? crop->area / job->total_crop_area : 0.0;
+        double ef = crop->pesticide_id >= 0 && crop->pesticide_rate > 0 ? pesticides[crop->pesticide_id].ef : 0.0;
+        double q_n = crop->nitrogen_kg_ha * crop->area;
+        double q_p = crop->phosphorus_kg_ha * crop->area;
+        double q_k = crop->potassium_kg_ha * crop->area;
+        double q_manure = crop->manure_kg_ha * crop->area;
+        double q_diesel = crop->diesel_l_ha * crop->area;
+        double q_water = crop->irrigation_mm * 10.0 * crop->area;
+        double q_pesticide = crop->pesticide_rate * crop->area;
+
+        // Without input noise the columns stay at 1 from the start
+        for (int k = 0; k < NOISE_INPUTS && input_noise.distribution != DIST_NONE; k++) {
+            long stream = MC_NUM_FACTORS + (long)i * NOISE_INPUTS + k;
+            fill_multipliers(&input_noise, stream_key(job->seed, job->farm_index, stream), begin, n, noise[k]);
+        }
+
+        for (long d = 0; d < n; d++) {
+            double fertilizer = q_n * noise[NOISE_NITROGEN][d] * (f->nitrogen * m[MC_NITROGEN][d]) / 1000.0 +
+                                q_p * noise[NOISE_PHOSPHORUS][d] * (f->phosphorus * m[MC_PHOSPHORUS][d]) / 1000.0 +
+                                q_k * noise[NOISE_POTASSIUM][d] * (f->potassium * m[MC_POTASSIUM][d]) / 1000.0;
+            double manure = q_manure * noise[NOISE_MANURE][d] * (f->manure * m[MC_MANURE][d]) / 1000.0;
+            double fuel = q_diesel * noise[NOISE_DIESEL][d] * (f->diesel * m[MC_DIESEL][d]) / 1000.0;
+            double irrigation = q_water * noise[NOISE_IRRIGATION][d] * (f->irrigation * m[MC_IRRIGATION][d]) / 1000.0;
+            double pesticide = q_pesticide * noise[NOISE_PESTICIDE][d] * (ef * m[MC_PESTICIDE][d]) / 1000.0;
+            double allocated = livestock[d] * share;
+
+            series[SERIES_FERTILIZER][d] += fertilizer;
+            series[SERIES_MANURE][d] += manure;
+            series[SERIES_FUEL][d] += fuel;
+            series[SERIES_IRRIGATION][d] += irrigation;
+            series[SERIES_PESTICIDE][d] += pesticide;
+            crop_total[d] = fertilizer + manure + fuel + irrigation + pesticide + allocated;
+        }
+    }
+
+    for (long d = 0; d < n; d++) {
+        series[SERIES_LIVESTOCK][d] = livestock[d];
+        series[SERIES_TOTAL][d] = series[SERIES_FERTILIZER][d] + series[SERIES_MANURE][d] +
+                                  series[SERIES_FUEL][d] + series[SERIES_IRRIGATION][d] +
+                                  series[SERIES_PESTICIDE][d] + livestock[d];
+    }
+    free(scratch);
+}
+
+// Partially orders values so that values[k] is the k-th smallest, with
+// nothing larger before it and nothing smaller after it
+static void select_kth(double *values, long count, long k) {
+    long low = 0, high = count - 1;
+
+    while (low < high) {
+        // Median of three as pivot
+        long mid = low + (high - low) / 2;
+        double a = values[low], b = values[mid], c = values[high];
+        double pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+        long i = low, j = high;
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                double t = values[i];
+                values[i] = values[j];
+                values[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) {
+            high = j;
+        } else if (k >= i) {
+            low = i;
+        } else {
+            return;
+        }
+    }
+}
+
+// Nearest-rank percentile index for fraction p of count values
+static long rank_index(double p, long count) {
+    long rank = (long)ceil(p * (double)count);
+    return rank < 1 ? 0 : (rank > count ? count - 1 : rank - 1);
+}
+
+// Mean, standard deviation and percentiles of one series. The series is
+// reordered in the process.
+static void summarize_series(void *arg, int worker) {
+    McSeriesTask *task = arg;
+    double *values = task->values;
+    long count = task->count;
+    McSummary *summary = task->summary;
+    (void)worker;
+
+    // Summed as offsets from the first draw, which keeps the mean exact
+    // when the draws are all equal (no uncertainty) and limits rounding
+    double shift = values[0];
+    double sum = 0.0;
+    for (long d = 0; d < count; d++) {
+        sum += values[d] - shift;
+    }
+    double mean = shift + sum / (double)count;
+    double squares = 0.0;
+    for (long d = 0; d < count; d++) {
+        double diff = values[d] - mean;
+        squares += diff * diff;
+    }
+    summary->mean = mean;
+    summary->std_dev = count > 1 ? sqrt(squares / (double)(count - 1)) : 0.0;
+
+    // Median first, then each tail percentile within its own half
+    long median = rank_index(0.5, count);
+    long low = rank_index(0.025, count);
+    long high = rank_index(0.975, count);
+    select_kth(values, count, median);
+    summary->p50 = values[median];
+    select_kth(values, median + 1, low);
+    summary->p2_5 = values[low];
+    select_kth(values + median, count - median, high - median);
+    summary->p97_5 = values[high];
+}
+
+// Runs every task on the pool, or in order on this thread without one.
+// Returns 0 if the pool ran out of memory queueing a task; the tasks
+// already queued have finished by then.
+static int run_tasks(ThreadPool *pool, TaskFunction function, void *tasks, size_t task_size, long count) {
+    int ok = 1;
+
+    for (long t = 0; t < count && ok; t++) {
+        void *task = (char *)tasks + (size_t)t * task_size;
+        if (pool) {
+            ok = thread_pool_submit(pool, function, task);
+        } else {
+            function(task, 0);
+        }
+    }
+    if (pool) {
+        thread_pool_wait(pool);
+    }
+    return ok;
+}
+
+static void print_summary_row(FILE *out, const char *label, double point, const McSummary *summary) {
+    fprintf(out, "%-16.16s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            label, point, summary->mean, summary->std_dev, summary->p2_5, summary->p50, summary->p97_5);
+}
+
+// Samples one validated farm and prints its table. Returns 0 on failure.
+static int sample_farm(const MonteCarloOptions *options, ThreadPool *pool, FarmReport *report,
+                       const char *farm_id, long farm_index) {
+    const FarmRecord *farm = &report->farm;
+    long draws = options->draws;
+    int num_series = SERIES_CROPS + farm->num_crops;
+    long num_chunks = (draws + MC_CHUNK_DRAWS - 1) / MC_CHUNK_DRAWS;
+
+    McFarmJob job;
+    memset(&job, 0, sizeof(job));
+    job.farm = farm;
+    job.rows = report->crops.rows + farm->crop_offset;
+    job.factors = factor_table.sets[farm->factor_set];
+    job.farm_index = farm_index;
+    job.draws = draws;
+    job.seed = options->seed;
+    job.input_noise = options->input_noise;
+    for (int i = 0; i < farm->num_crops; i++) {
+        job.total_crop_area += job.rows[i].area;
+    }
+
+    job.series = malloc((size_t)num_series * (size_t)draws * sizeof(double));
+    McChunk *chunks = malloc((size_t)num_chunks * sizeof(McChunk));
+    McSeriesTask *series_tasks = malloc((size_t)num_series * sizeof(McSeriesTask));
+    McSummary *summaries = malloc((size_t)num_series * sizeof(McSummary));
+    int ok = job.series && chunks && series_tasks && summaries;
+
+    if (ok) {
+        for (long c = 0; c < num_chunks; c++) {
+            chunks[c].job = &job;
+            chunks[c].begin = c * MC_CHUNK_DRAWS;
+            chunks[c].end = c == num_chunks - 1 ? draws : (c + 1) * MC_CHUNK_DRAWS;
+        }
+        ok = run_tasks(pool, evaluate_chunk, chunks, sizeof(McChunk), num_chunks) && !job.failed;
+    }
+    if (ok) {
+        for (int s = 0; s < num_series; s++) {
+            series_tasks[s].values = job.series + (size_t)s * draws;
+            series_tasks[s].count = draws;
+            series_tasks[s].summary = &summaries[s];
+        }
+        ok = run_tasks(pool, summarize_series, series_tasks, sizeof(McSeriesTask), num_series);
+    }
+    if (ok) {
+        const EmissionResults *point = &report->results;
+        const double point_values[SERIES_CROPS] = {
+            point->fertilizer_emissions, point->manure_emissions, point->fuel_emissions,
+            point->irrigation_emissions, point->pesticide_emissions, point->livestock_emissions,
+            point->total_emissions
+        };
+        FILE *out = options->output;
+
+        fprintf(out, "\nFarm %s: %ld draws, tonnes CO2e\n", farm_id, draws);
+        fprintf(out, "%-16s %10s %10s %10s %10s %10s %10s\n",
+                "Category", "Point", "Mean", "Std dev", "P2.5", "P50", "P97.5");
+        for (int s = 0; s < SERIES_CROPS; s++) {
+            print_summary_row(out, category_labels[s], point_values[s], &summaries[s]);
+        }
+        for (int i = 0; i < farm->num_crops; i++) {
+            print_summary_row(out, crops[job.rows[i].crop_id].name, report->crop_results[i].total_emissions,
+                              &summaries[SERIES_CROPS + i]);
+        }
+    } else {
+        printf("Error: Out of memory sampling farm %s (%ld draws)\n", farm_id, draws);
+    }
+
+    free(job.series);
+    free(chunks);
+    free(series_tasks);
+    free(summaries);
+    return ok;
+}
+
+// Samples every farm of a multi-crop CSV file, one after another; each
+// farm's draws are split into chunks evaluated in parallel
+int run_monte_carlo(const MonteCarloOptions *options, long *farms_processed) {
+    MultiCropCsv csv;
+    FarmReport report;
+    ThreadPool *pool = NULL;
+    int status;
+
+    *farms_processed = 0;
+    if (!is_multi_crop_csv(options->input_path)) {
+        printf("Error: Monte Carlo mode needs a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    }
+    if (!multi_crop_csv_open(&csv, options->input_path)) {
+        return 0;
+    }
+    if (options->threads > 1) {
+        pool = thread_pool_create(options->threads);
+    }
+
+    memset(&report, 0, sizeof(report));
+    while (1) {
+        crop_arena_reset(&report.crops);
+        status = multi_crop_csv_next_farm(&csv, &report.crops, &report.farm);
+        if (status <= 0) {
+            break;
+        }
+        if (!validate_farm_record(&report.farm, report.crops.rows)) {
+            printf("Error: Validation failed for farm %s\n", csv.farm_id);
+            status = -1;
+            break;
+        }
+
+        size_t needed = (size_t)report.farm.num_crops;
+        if (needed > report.crop_results_capacity) {
+            CropEmissionResults *crop_results = realloc(report.crop_results, needed * sizeof(CropEmissionResults));
+            if (!crop_results) {
+                printf("Error: Out of memory\n");
+                status = -1;
+                break;
+            }
+            report.crop_results = crop_results;
+            report.crop_results_capacity = needed;
+        }
+
+        calculate_farm_record_emissions(&report.farm, report.crops.rows, &report.results, report.crop_results);
+        if (!sample_farm(options, pool, &report, csv.farm_id, *farms_processed)) {
+            status = -1;
+            break;
+        }
+        (*farms_processed)++;
+    }
+
+    thread_pool_destroy(pool);
+    farm_report_free(&report);
+    multi_crop_csv_close(&csv);
+    return status == 0;
+}
@@ -0,0 +1,73 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "input.h"
+#include "compute.h"
+
+// Draws per farm when --draws is not given, and the accepted range
+#define MC_DEFAULT_DRAWS 10000
+#define MC_MAX_DRAWS 10000000
+
+// Draws evaluated per task; tasks are the unit of work for the thread pool
+#define MC_CHUNK_DRAWS 2048
+
+// Uncertain emission factors, in EmissionFactors field order, then the
+// pesticide emission factors (one multiplier shared by all pesticides)
+typedef enum {
+    MC_NITROGEN = 0,
+    MC_PHOSPHORUS,
+    MC_POTASSIUM,
+    MC_MANURE,
+    MC_DIESEL,
+    MC_IRRIGATION,
+    MC_COW,
+    MC_PIG,
+    MC_CHICKEN,
+    MC_PESTICIDE,
+    MC_NUM_FACTORS
+} McFactor;
+
+typedef enum {
+    DIST_NONE = 0,              // factor is exact
+    DIST_NORMAL,                // a = relative standard deviation
+    DIST_LOGNORMAL,             // a = standard deviation of the log (mean kept)
+    DIST_TRIANGULAR             // a, b = low and high multipliers, mode 1
+} Distribution;
+
+// Uncertainty of one factor, applied as a multiplier with mean 1 (for
+// normal and lognormal; triangular has mode 1) on the factor in effect
+typedef struct {
+    int distribution;           // Distribution
+    double a;
+    double b;
+} FactorUncertainty;
+
+// Built-in uncertainties; a factor pack's [uncertainty] section replaces them
+extern FactorUncertainty factor_uncertainty[MC_NUM_FACTORS];
+
+typedef struct {
+    const char *input_path;     // multi-crop CSV file
+    FILE *output;
+    long draws;                 // samples per farm
+    uint64_t seed;
+    double input_noise;         // relative standard deviation of crop inputs
+    int threads;
+} MonteCarloOptions;
+
+// Distribution of one result over the draws (tonnes CO2e)
+typedef struct {
+    double mean;
+    double std_dev;
+    double p2_5;
+    double p50;
+    double p97_5;
+} McSummary;
+
+// Function declarations
+const char *mc_factor_name(int factor);
+int parse_factor_uncertainty(const char *text, FactorUncertainty *uncertainty);
+int run_monte_carlo(const MonteCarloOptions *options, long *farms_processed);
+
+#endif
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+
+// Yield response of each input: the share of a crop's yield lost when its
+// rate is cut by the whole crop default (diesel: by the whole current rate).
+// Cuts down to the default cost no yield, as the default is the agronomic
+// rate. Rough linear responses; they keep the plan an LP.
+static const struct {
+    const char *label;
+    const char *unit;
+    double response;
+} opt_inputs[NUM_OPT_INPUTS] = {
+    {"Nitrogen",   "kg N/ha",    0.30},
+    {"Phosphorus", "kg P2O5/ha", 0.10},
+    {"Potassium",  "kg K2O/ha",  0.08},
+    {"Diesel",     "L/ha",       0.05},
+    {"Irrigation", "mm",         0.40},
+    {"Pesticide",  "",           0.0}
+};
+
+void optimized_plan_init(OptimizedPlan *plan) {
+    memset(plan, 0, sizeof(*plan));
+}
+
+void optimized_plan_free(OptimizedPlan *plan) {
+    free(plan->rows);
+    free(plan->moves);
+    free(plan->costly);
+    free(plan->steps);
+    memset(plan, 0, sizeof(*plan));
+}
+
+static int reserve_plan(OptimizedPlan *plan, int num_rows) {
+    if (num_rows <= plan->capacity) {
+        return 1;
+    }
+    int capacity = plan->capacity > 0 ? plan->capacity : 16;
+    while (capacity < num_rows) {
+        capacity *= 2;
+    }
+    CropData *rows = realloc(plan->rows, (size_t)capacity * sizeof(CropData));
+    if (rows) plan->rows = rows;
+    OptimizeMove *moves = realloc(plan->moves, (size_t)capacity * OPT_MOVES_PER_CROP * sizeof(OptimizeMove));
+    if (moves) plan->moves = moves;
+    OptimizeMove **costly = realloc(plan->costly, (size_t)capacity * OPT_MOVES_PER_CROP * sizeof(OptimizeMove *));
+    if (costly) plan->costly = costly;
+    PlanStep *steps = realloc(plan->steps, (size_t)capacity * NUM_OPT_INPUTS * sizeof(PlanStep));
+    if (steps) plan->steps = steps;
+    if (!rows || !moves || !costly || !steps) {
+        return 0;
+    }
+    plan->capacity = capacity;
+    return 1;
+}
+
+static double *input_rate(CropData *crop, int input) {
+    switch (input) {
+        case OPT_NITROGEN:   return &crop->nitrogen_kg_ha;
+        case OPT_PHOSPHORUS: return &crop->phosphorus_kg_ha;
+        case OPT_POTASSIUM:  return &crop->potassium_kg_ha;
+        case OPT_DIESEL:     return &crop->diesel_l_ha;
+        default:             return &crop->irrigation_mm;
+    }
+}
+
+// The pesticide of the same type with the lowest emission factor
+static int cheapest_alternative(int pesticide_id) {
+    int best = pesticide_id;
+
+    for (int p = 0; p < num_pesticides; p++) {
+        if (strcmp(pesticides[p].type, pesticides[pesticide_id].type) == 0 &&
+            pesticides[p].ef < pesticides[best].ef) {
+            best = p;
+        }
+    }
+    return best;
+}
+
+static int add_move(OptimizeMove *moves, int count, int crop, int input,
+                    double max_cut, double saving, double loss, double to) {
+    if (max_cut <= 0 || saving <= 0) {
+        return count;
+    }
+    OptimizeMove *move = &moves[count];
+    move->crop = crop;
+    move->input = input;
+    move->max_cut = max_cut;
+    move->saving = saving;
+    move->loss = loss;
+    move->to = to;
+    move->taken = 0.0;
+    return count + 1;
+}
+
+// Lists the linear pieces of one crop in input order
+static int crop_moves(const CropData *crop, int index, const EmissionFactors *f,
+                      const OptimizeBounds *bounds, OptimizeMove *moves, int count) {
+    const Crop *defaults = &crops[crop->crop_id];
+    double crop_yield = defaults->yield * crop->area;
+    const double default_rate[] = {defaults->n_rate, defaults->p_rate, defaults->k_rate, 0.0, defaults->irrigation};
+    const double factor[] = {f->nitrogen, f->phosphorus, f->potassium, f->diesel, f->irrigation * 10.0};
+
+    for (int input = OPT_NITROGEN; input <= OPT_IRRIGATION; input++) {
+        double rate = *input_rate((CropData *)crop, input);
+        double saving = crop->area * factor[input] / 1000.0;
+        double low;
+
+        if (input == OPT_DIESEL) {
+            low = rate * bounds->diesel_floor;
+            if (rate > 0) {
+                count = add_move(moves, count, index, input, rate - low, saving,
+                                 opt_inputs[input].response * crop_yield / rate, low);
+            }
+            continue;
+        }
+        // Free down to the default, then the yield response below it
+        double target = default_rate[input];
+        low = target * bounds->floor;
+        if (rate > target) {
+            count = add_move(moves, count, index, input, rate - target, saving, 0.0, target);
+        }
+        if (target > 0) {
+            double from = rate < target ? rate : target;
+            count = add_move(moves, count, index, input, from - low, saving,
+                             opt_inputs[input].response * crop_yield / target, low);
+        }
+    }
+
+    if (crop->pesticide_id >= 0 && crop->pesticide_rate > 0) {
+        int best = cheapest_alternative(crop->pesticide_id);
+        double saving = crop->pesticide_rate * crop->area *
+                        (pesticides[crop->pesticide_id].ef - pesticides[best].ef) / 1000.0;
+        count = add_move(moves, count, index, OPT_PESTICIDE, 1.0, saving, 0.0, best);
+    }
+    return count;
+}
+
+// Costly pieces first by t CO2e saved per t of yield lost, then in list order
+static int compare_moves(const void *a, const void *b) {
+    const OptimizeMove *left = *(const OptimizeMove *const *)a;
+    const OptimizeMove *right = *(const OptimizeMove *const *)b;
+    double l = left->saving / left->loss;
+    double r = right->saving / right->loss;
+
+    if (l != r) {
+        return l < r ? 1 : -1;
+    }
+    return left < right ? -1 : (left > right);
+}
+
+// Finds the lowest-emission plan that keeps the farm's total yield at or
+// above bounds->min_yield of its current yield. Emissions and yield are
+// linear in every rate and the rates are boxed, so the LP is a fractional
+// knapsack: take every piece that costs no yield, then the rest by saving
+// per tonne of yield lost until the yield budget runs out. Returns 0 if out
+// of memory.
+int optimize_farm(const FarmRecord *farm, const CropData *rows, const OptimizeBounds *bounds, OptimizedPlan *plan) {
+    const CropData *farm_crops = rows + farm->crop_offset;
+    const EmissionFactors *f = &factor_table.sets[farm->factor_set];
+    FarmRecord planned = *farm;
+    OptimizeMove **costly;
+    int move_count = 0;
+    int costly_count = 0;
+
+    if (!reserve_plan(plan, farm->num_crops > 0 ? farm->num_crops : 1)) {
+        return 0;
+    }
+    costly = plan->costly;
+
+    memcpy(plan->rows, farm_crops, (size_t)farm->num_crops * sizeof(CropData));
+    plan->base_yield = 0.0;
+    for (int i = 0; i < farm->num_crops; i++) {
+        plan->base_yield += crops[farm_crops[i].crop_id].yield * farm_crops[i].area;
+        move_count = crop_moves(&farm_crops[i], i, f, bounds, plan->moves, move_count);
+    }
+
+    double budget = plan->base_yield * (1.0 - bounds->min_yield);
+    for (int m = 0; m < move_count; m++) {
+        OptimizeMove *move = &plan->moves[m];
+        if (move->loss <= 0) {
+            move->taken = move->max_cut;
+        } else {
+            costly[costly_count++] = move;
+        }
+    }
+    qsort(costly, (size_t)costly_count, sizeof(*costly), compare_moves);
+    for (int m = 0; m < costly_count && budget > 0; m++) {
+        OptimizeMove *move = costly[m];
+        double affordable = budget / move->loss;
+        move->taken = affordable < move->max_cut ? affordable : move->max_cut;
+        budget -= move->taken * move->loss;
+    }
+
+    // Apply the plan and merge the pieces of each crop input into a step
+    plan->step_count = 0;
+    plan->plan_yield = plan->base_yield;
+    for (int m = 0; m < move_count; m++) {
+        const OptimizeMove *move = &plan->moves[m];
+        CropData *row = &plan->rows[move->crop];
+        if (move->taken <= 0) continue;
+
+        PlanStep *step = plan->step_count > 0 ? &plan->steps[plan->step_count - 1] : NULL;
+        if (!step || step->crop != move->crop || step->input != move->input) {
+            step = &plan->steps[plan->step_count++];
+            step->crop = move->crop;
+            step->input = move->input;
+            step->from = move->input == OPT_PESTICIDE ? row->pesticide_id : *input_rate(row, move->input);
+            step->saving = 0.0;
+            step->yield_loss = 0.0;
+        }
+        if (move->input == OPT_PESTICIDE) {
+            row->pesticide_id = (int)move->to;
+            step->to = move->to;
+        } else {
+            double *rate = input_rate(row, move->input);
+            *rate = move->taken < move->max_cut ? *rate - move->taken : move->to;
+            step->to = *rate;
+        }
+        step->saving += move->taken * move->saving;
+        step->yield_loss += move->taken * move->loss;
+        plan->plan_yield -= move->taken * move->loss;
+    }
+
+    calculate_farm_record_totals(farm, rows, &plan->base, NULL);
+    planned.crop_offset = 0;
+    calculate_farm_record_totals(&planned, plan->rows, &plan->optimized, NULL);
+    return 1;
+}
+
+void print_optimized_plan(FILE *out, const char *farm_id, const OptimizedPlan *plan) {
+    double base = plan->base.total_emissions;
+    double optimized = plan->optimized.total_emissions;
+
+    fprintf(out, "\nFarm %s: %.2f -> %.2f t CO2e (%.1f%%), yield %.1f -> %.1f t (%.1f%%)\n",
+            farm_id, base, optimized, base > 0 ? (optimized - base) / base * 100.0 : 0.0,
+            plan->base_yield, plan->plan_yield,
+            plan->base_yield > 0 ? plan->plan_yield / plan->base_yield * 100.0 : 100.0);
+    if (plan->step_count == 0) {
+        fprintf(out, "  No reduction fits within the bounds.\n");
+        return;
+    }
+    fprintf(out, "  %-12s %-11s %12s %12s %-11s %12s %12s\n",
+            "Crop", "Input", "Current", "Planned", "Unit", "t CO2e saved", "Yield loss t");
+    for (int s = 0; s < plan->step_count; s++) {
+        const PlanStep *step = &plan->steps[s];
+        const CropData *row = &plan->rows[step->crop];
+
+        fprintf(out, "  %-12.12s %-11s ", crops[row->crop_id].name, opt_inputs[step->input].label);
+        if (step->input == OPT_PESTICIDE) {
+            fprintf(out, "%12.12s %12.12s %-11s",
+                    pesticides[(int)step->from].trade_name, pesticides[(int)step->to].trade_name, "swap");
+        } else {
+            fprintf(out, "%12.1f %12.1f %-11s", step->from, step->to, opt_inputs[step->input].unit);
+        }
+        fprintf(out, " %12.4f %12.3f\n", step->saving, step->yield_loss);
+    }
+}
+
+static void print_summary_line(FILE *out, const char *label, double base, double optimized,
+                               double base_yield, double plan_yield) {
+    fprintf(out, "%-16s %14.2f %14.2f %10.1f %14.1f %14.1f\n", label, base, optimized,
+            base > 0 ? (optimized - base) / base * 100.0 : 0.0, base_yield, plan_yield);
+}
+
+// Optimizes every farm of a multi-crop CSV file, printing each plan (or one
+// line per farm) and the totals over all farms
+int run_optimize(const OptimizeOptions *options, long *farms_processed) {
+    MultiCropCsv csv;
+    CropArena arena;
+    FarmRecord farm;
+    OptimizedPlan plan;
+    double base = 0.0, optimized = 0.0, base_yield = 0.0, plan_yield = 0.0;
+    int status;
+
+    *farms_processed = 0;
+    if (!is_multi_crop_csv(options->input_path)) {
+        printf("Error: Optimize mode needs a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    }
+    if (!multi_crop_csv_open(&csv, options->input_path)) {
+        return 0;
+    }
+
+    optimized_plan_init(&plan);
+    memset(&arena, 0, sizeof(arena));
+    if (!options->per_farm) {
+        fprintf(options->output, "%-16s %14s %14s %10s %14s %14s\n",
+                "Farm", "Current tCO2e", "Planned tCO2e", "Change %", "Current yield", "Planned yield");
+    }
+    while (1) {
+        crop_arena_reset(&arena);
+        status = multi_crop_csv_next_farm(&csv, &arena, &farm);
+        if (status <= 0) {
+            break;
+        }
+        if (!validate_farm_record(&farm, arena.rows)) {
+            printf("Error: Validation failed for farm %s\n", csv.farm_id);
+            status = -1;
+            break;
+        }
+        if (!optimize_farm(&farm, arena.rows, &options->bounds, &plan)) {
+            printf("Error: Out of memory\n");
+            status = -1;
+            break;
+        }
+
+        if (options->per_farm) {
+            print_optimized_plan(options->output, csv.farm_id, &plan);
+        } else {
+            print_summary_line(options->output, csv.farm_id, plan.base.total_emissions,
+                               plan.optimized.total_emissions, plan.base_yield, plan.plan_yield);
+        }
+        base += plan.base.total_emissions;
+        optimized += plan.optimized.total_emissions;
+        base_yield += plan.base_yield;
+        plan_yield += plan.plan_yield;
+        (*farms_processed)++;
+    }
+
+    if (status == 0 && *farms_processed > 0) {
+        if (options->per_farm) {
+            fprintf(options->output, "\n%-16s %14s %14s %10s %14s %14s\n",
+                    "", "Current tCO2e", "Planned tCO2e", "Change %", "Current yield", "Planned yield");
+        }
+        print_summary_line(options->output, "All farms", base, optimized, base_yield, plan_yield);
+    }
+
+    crop_arena_free(&arena);
+    multi_crop_csv_close(&csv);
+    optimized_plan_free(&plan);
+    return status == 0;
+}
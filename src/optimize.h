@@ -0,0 +1,84 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <stdio.h>
+#include "input.h"
+#include "compute.h"
+
+// Default bounds of the optimizer, in percent
+#define OPT_DEFAULT_MIN_YIELD 95.0      // of the farm's current total yield
+#define OPT_DEFAULT_FLOOR 50.0          // of the crop's default N, P, K and irrigation
+#define OPT_DEFAULT_DIESEL_FLOOR 70.0   // of the current diesel rate
+
+// Linear pieces an input of one crop can be cut along: N, P, K and
+// irrigation above and below the crop default, diesel and a pesticide swap
+#define OPT_MOVES_PER_CROP 10
+
+// Crop inputs the optimizer can reduce
+typedef enum {
+    OPT_NITROGEN = 0,
+    OPT_PHOSPHORUS,
+    OPT_POTASSIUM,
+    OPT_DIESEL,
+    OPT_IRRIGATION,
+    OPT_PESTICIDE,
+    NUM_OPT_INPUTS
+} OptimizeInput;
+
+typedef struct {
+    double min_yield;           // share of the current total yield to keep (0-1)
+    double floor;               // lowest N, P, K and irrigation, share of the crop default
+    double diesel_floor;        // lowest diesel rate, share of the current rate
+} OptimizeBounds;
+
+// One linear piece of the plan: cutting an input of a crop by a unit (kg,
+// L or mm per ha; a pesticide swap is one unit) saves `saving` t CO2e and
+// loses `loss` t of yield, up to max_cut units
+typedef struct {
+    int crop;                   // row within the farm
+    int input;                  // OptimizeInput
+    double max_cut;
+    double saving;
+    double loss;
+    double to;                  // rate (or pesticide index) once fully cut
+    double taken;               // units the plan cuts
+} OptimizeMove;
+
+// One change of the plan, per crop and input
+typedef struct {
+    int crop;
+    int input;
+    double from;                // rate, or pesticide index
+    double to;
+    double saving;              // t CO2e
+    double yield_loss;          // t
+} PlanStep;
+
+typedef struct {
+    CropData *rows;             // the farm's crop rows with the plan applied
+    OptimizeMove *moves;
+    OptimizeMove **costly;      // pieces that cost yield, in greedy order
+    PlanStep *steps;
+    int step_count;
+    int capacity;               // crops the buffers hold
+    EmissionTotals base;
+    EmissionTotals optimized;
+    double base_yield;          // t
+    double plan_yield;          // t
+} OptimizedPlan;
+
+typedef struct {
+    const char *input_path;     // multi-crop CSV file
+    FILE *output;
+    OptimizeBounds bounds;
+    int per_farm;               // print every farm's plan, not just one line per farm
+} OptimizeOptions;
+
+// Function declarations
+void optimized_plan_init(OptimizedPlan *plan);
+void optimized_plan_free(OptimizedPlan *plan);
+int optimize_farm(const FarmRecord *farm, const CropData *rows, const OptimizeBounds *bounds, OptimizedPlan *plan);
+void print_optimized_plan(FILE *out, const char *farm_id, const OptimizedPlan *plan);
+int run_optimize(const OptimizeOptions *options, long *farms_processed);
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+#include "ring_buffer.h"
+
+#ifndef _WIN32
+    #include <pthread.h>
+#endif
+
+// Runs the three stages one block at a time on the caller's thread
+static long run_sequential(const PipelineStages *stages, void *block) {
+    long count = 0;
+    while (stages->read(block, stages->read_context)) {
+        stages->compute(block);
+        stages->write(block, stages->write_context);
+        count++;
+    }
+    return count;
+}
+
+#ifndef _WIN32
+
+// A block travelling through the pipeline with its position in the input
+typedef struct {
+    void *block;
+    long sequence;
+} PipelineSlot;
+
+// Blocks circulate free -> filled -> computed -> free. Every ring can hold
+// all slots, so pushes never fail; a stage waits only when its input ring
+// is empty, and the reader stalls when the writer has not returned any
+// free slots yet, which bounds memory to the slots allocated up front.
+typedef struct {
+    const PipelineStages *stages;
+    PipelineSlot *slots;
+    int num_slots;
+    RingBuffer free_slots;
+    RingBuffer filled;
+    RingBuffer computed;
+    PipelineSlot **pending;     // writer's reorder window, num_slots entries
+    int reading_done;           // set once the reader has pushed its last block
+    long total_blocks;          // valid once reading_done is set
+} Pipeline;
+
+static void push_wait(RingBuffer *ring, void *item) {
+    unsigned attempt = 0;
+    while (!ring_buffer_push(ring, item)) {
+        ring_buffer_backoff(&attempt);
+    }
+}
+
+static void *compute_main(void *arg) {
+    Pipeline *pipeline = arg;
+    unsigned attempt = 0;
+    void *item;
+
+    while (1) {
+        if (ring_buffer_pop(&pipeline->filled, &item)) {
+            PipelineSlot *slot = item;
+            pipeline->stages->compute(slot->block);
+            push_wait(&pipeline->computed, slot);
+            attempt = 0;
+        } else if (__atomic_load_n(&pipeline->reading_done, __ATOMIC_ACQUIRE)) {
+            // The reader is finished, so an empty ring now stays empty
+            if (!ring_buffer_pop(&pipeline->filled, &item)) {
+                break;
+            }
+            PipelineSlot *slot = item;
+            pipeline->stages->compute(slot->block);
+            push_wait(&pipeline->computed, slot);
+        } else {
+            ring_buffer_backoff(&attempt);
+        }
+    }
+    return NULL;
+}
+
+// Restores input order: blocks finish out of order, so each one waits in
+// pending until every block before it has been written
+static void *writer_main(void *arg) {
+    Pipeline *pipeline = arg;
+    PipelineSlot **pending = pipeline->pending;
+    long next = 0;
+    unsigned attempt = 0;
+    void *item;
+
+    while (1) {
+        if (__atomic_load_n(&pipeline->reading_done, __ATOMIC_ACQUIRE) &&
+            next == pipeline->total_blocks) {
+            break;
+        }
+        if (!ring_buffer_pop(&pipeline->computed, &item)) {
+            ring_buffer_backoff(&attempt);
+            continue;
+        }
+        attempt = 0;
+
+        // At most num_slots blocks are in flight, so their sequence numbers
+        // are distinct modulo num_slots
+        PipelineSlot *slot = item;
+        pending[slot->sequence % pipeline->num_slots] = slot;
+
+        PipelineSlot *ready;
+        while ((ready = pending[next % pipeline->num_slots]) != NULL && ready->sequence == next) {
+            pending[next % pipeline->num_slots] = NULL;
+            pipeline->stages->write(ready->block, pipeline->stages->write_context);
+            push_wait(&pipeline->free_slots, ready);
+            next++;
+        }
+    }
+    return NULL;
+}
+
+static int pipeline_init(Pipeline *pipeline, const PipelineStages *stages, void **blocks, int num_blocks) {
+    pipeline->stages = stages;
+    pipeline->num_slots = num_blocks;
+    pipeline->reading_done = 0;
+    pipeline->total_blocks = 0;
+    pipeline->slots = malloc((size_t)num_blocks * sizeof(PipelineSlot));
+    pipeline->pending = calloc((size_t)num_blocks, sizeof(PipelineSlot *));
+
+    int ok = pipeline->slots != NULL && pipeline->pending != NULL;
+    ok = ring_buffer_init(&pipeline->free_slots, (size_t)num_blocks) && ok;
+    ok = ring_buffer_init(&pipeline->filled, (size_t)num_blocks) && ok;
+    ok = ring_buffer_init(&pipeline->computed, (size_t)num_blocks) && ok;
+    if (!ok) {
+        return 0;
+    }
+
+    for (int i = 0; i < num_blocks; i++) {
+        pipeline->slots[i].block = blocks[i];
+        pipeline->slots[i].sequence = 0;
+        ring_buffer_push(&pipeline->free_slots, &pipeline->slots[i]);
+    }
+    return 1;
+}
+
+static void pipeline_free(Pipeline *pipeline) {
+    ring_buffer_free(&pipeline->free_slots);
+    ring_buffer_free(&pipeline->filled);
+    ring_buffer_free(&pipeline->computed);
+    free(pipeline->slots);
+    free(pipeline->pending);
+}
+
+static void finish_reading(Pipeline *pipeline, long total_blocks) {
+    pipeline->total_blocks = total_blocks;
+    __atomic_store_n(&pipeline->reading_done, 1, __ATOMIC_RELEASE);
+}
+
+#endif
+
+// Streams blocks through read -> compute -> write. With more than one worker
+// the caller's thread reads, `workers` threads compute and a writer thread
+// emits results in input order, all connected by lock-free rings, so disk
+// reads, evaluation and output overlap. Otherwise (and on Windows) the stages
+// run one after another on the caller's thread. Returns the number of blocks,
+// or -1 if the pipeline could not be allocated (nothing is read then).
+long run_pipeline(const PipelineStages *stages, void **blocks, int num_blocks, int workers) {
+#ifndef _WIN32
+    if (workers > 1 && num_blocks > 1) {
+        Pipeline pipeline;
+        pthread_t writer;
+        pthread_t *threads = malloc((size_t)workers * sizeof(pthread_t));
+
+        memset(&pipeline, 0, sizeof(pipeline));
+        if (!threads || !pipeline_init(&pipeline, stages, blocks, num_blocks)) {
+            printf("Error: Out of memory\n");
+            pipeline_free(&pipeline);
+            free(threads);
+            return -1;
+        }
+        if (pthread_create(&writer, NULL, writer_main, &pipeline) == 0) {
+            int started = 0;
+            while (started < workers &&
+                   pthread_create(&threads[started], NULL, compute_main, &pipeline) == 0) {
+                started++;
+            }
+
+            long count = 0;
+            if (started > 0) {
+                unsigned attempt = 0;
+                void *item;
+                while (1) {
+                    if (!ring_buffer_pop(&pipeline.free_slots, &item)) {
+                        ring_buffer_backoff(&attempt);
+                        continue;
+                    }
+                    attempt = 0;
+
+                    PipelineSlot *slot = item;
+                    if (!stages->read(slot->block, stages->read_context)) {
+                        break;
+                    }
+                    slot->sequence = count++;
+                    push_wait(&pipeline.filled, slot);
+                }
+            }
+            finish_reading(&pipeline, count);
+
+            for (int i = 0; i < started; i++) {
+                pthread_join(threads[i], NULL);
+            }
+            pthread_join(writer, NULL);
+            pipeline_free(&pipeline);
+            free(threads);
+
+            if (started > 0) {
+                return count;
+            }
+            return run_sequential(stages, blocks[0]);
+        }
+
+        // Could not start the writer thread: fall back to a single thread
+        pipeline_free(&pipeline);
+        free(threads);
+    }
+#else
+    (void)workers;
+#endif
+    (void)num_blocks;
+    return run_sequential(stages, blocks[0]);
+}
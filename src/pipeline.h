@@ -0,0 +1,25 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// Fills the next block from the input. Returns 0 (leaving the block unused)
+// once there is nothing more to read.
+typedef int (*PipelineReadFunction)(void *block, void *context);
+
+// Evaluates one block; called concurrently on different blocks
+typedef void (*PipelineComputeFunction)(void *block);
+
+// Consumes one evaluated block; blocks arrive in the order they were read
+typedef void (*PipelineWriteFunction)(void *block, void *context);
+
+typedef struct {
+    PipelineReadFunction read;
+    PipelineComputeFunction compute;
+    PipelineWriteFunction write;
+    void *read_context;
+    void *write_context;
+} PipelineStages;
+
+// Function declarations
+long run_pipeline(const PipelineStages *stages, void **blocks, int num_blocks, int workers);
+
+#endif
@@ -7,7 +7,8 @@
 // Windows users: run 'chcp 65001' before execution for UTF-8 support
 #define USE_UTF8_SYMBOLS 0
 
-void print_report(const FarmData *farm, const EmissionResults *results) {
+static void print_farm_report(double total_farm_size, const EmissionResults *results,
+                              const CropEmissionResults *crop_results) {
     // Set locale for UTF-8 support (Windows users should run 'chcp 65001' first)
     setlocale(LC_ALL, "");
     
@@ -24,7 +25,7 @@ void print_report(const FarmData *farm, const EmissionResults *results) {
         printf("-------------------------------------------------------------------\n");
         
         for (int i = 0; i < results->num_crops; i++) {
-            const CropEmissionResults *crop_result = &results->crop_results[i];
+            const CropEmissionResults *crop_result = &crop_results[i];
             printf("%-12s %8.1f %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
                    crops[crop_result->crop_id].name,
                    crop_result->area,
@@ -38,7 +39,7 @@ void print_report(const FarmData *farm, const EmissionResults *results) {
         
         printf("-------------------------------------------------------------------\n");
         printf("FARM TOTAL   %8.1f %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
-               farm->total_farm_size,
+               total_farm_size,
                results->fertilizer_emissions,
                results->fuel_emissions,
                results->irrigation_emissions,
@@ -47,15 +48,15 @@ void print_report(const FarmData *farm, const EmissionResults *results) {
                results->total_emissions);
         
         printf("Per Hectare            %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
-               results->fertilizer_emissions / farm->total_farm_size,
-               results->fuel_emissions / farm->total_farm_size,
-               results->irrigation_emissions / farm->total_farm_size,
-               results->pesticide_emissions / farm->total_farm_size,
-               results->livestock_emissions / farm->total_farm_size,
+               results->fertilizer_emissions / total_farm_size,
+               results->fuel_emissions / total_farm_size,
+               results->irrigation_emissions / total_farm_size,
+               results->pesticide_emissions / total_farm_size,
+               results->livestock_emissions / total_farm_size,
                results->per_hectare_emissions);
     } else {
         // Legacy single-crop report
-        printf("Farm Size: %.1f ha\n", farm->total_farm_size);
+        printf("Farm Size: %.1f ha\n", total_farm_size);
         printf("----------------------------------------\n");
         printf("EMISSION BREAKDOWN:\n");
         printf("Fertilizer Emissions: %.2f %s\n", results->fertilizer_emissions, co2_unit);
@@ -76,6 +77,16 @@ void print_report(const FarmData *farm, const EmissionResults *results) {
     print_recommendations(results);
 }
 
+void print_report(const FarmData *farm, const EmissionResults *results) {
+    print_farm_report(farm->total_farm_size, results, results->crop_results);
+}
+
+// Prints the report for a farm with any number of crops
+void print_farm_record_report(const FarmRecord *farm, const EmissionResults *results,
+                              const CropEmissionResults *crop_results) {
+    print_farm_report(farm->total_farm_size, results, crop_results);
+}
+
 void print_legacy_report(const LegacyFarmData *farm, const EmissionResults *results) {
     // Set locale for UTF-8 support (Windows users should run 'chcp 65001' first)
     setlocale(LC_ALL, "");
@@ -103,97 +114,190 @@ void print_legacy_report(const LegacyFarmData *farm, const EmissionResults *resu
     print_recommendations(results);
 }
 
-void save_report_to_file(const FarmData *farm, const EmissionResults *results, const char *filename) {
-    FILE *file = fopen(filename, "w");
-    if (!file) {
-        printf("Warning: Could not save report to %s\n", filename);
-        return;
-    }
-    
+static void write_emission_line(ReportWriter *writer, const char *label, double value, const char *unit) {
+    report_writer_text(writer, label);
+    report_writer_fixed(writer, value, 0, 2);
+    report_writer_text(writer, " ");
+    report_writer_text(writer, unit);
+    report_writer_text(writer, "\n");
+}
+
+// Appends the saved-report layout of one farm: a crop table when
+// num_crops > 0, otherwise the category breakdown. farm_id may be NULL.
+void write_farm_report(ReportWriter *writer, const char *farm_id, double total_farm_size,
+                       const EmissionTotals *totals, const CropEmissionResults *crop_results, int num_crops) {
     const char* co2_unit = USE_UTF8_SYMBOLS ? "tCO₂e" : "tCO2e";
-    
-    fprintf(file, "Farm Carbon Footprint Report\n");
-    fprintf(file, "===================================================================\n");
-    
-    if (results->num_crops > 0) {
+    const double per_hectare[] = {
+        totals->fertilizer_emissions / total_farm_size,
+        totals->fuel_emissions / total_farm_size,
+        totals->irrigation_emissions / total_farm_size,
+        totals->pesticide_emissions / total_farm_size,
+        totals->livestock_emissions / total_farm_size,
+        totals->per_hectare_emissions
+    };
+    const int widths[] = {10, 8, 7, 8, 7, 7};
+
+    report_writer_text(writer, "Farm Carbon Footprint Report\n");
+    report_writer_text(writer, "===================================================================\n");
+    if (farm_id) {
+        report_writer_text(writer, "Farm ID: ");
+        report_writer_text(writer, farm_id);
+        report_writer_text(writer, "\n");
+    }
+
+    if (num_crops > 0) {
         // Multi-crop report
-        fprintf(file, "Crop          Area(ha)   Fert(%s)   Fuel   Irrig   Pestic   Live.   Total\n", co2_unit);
-        fprintf(file, "-------------------------------------------------------------------\n");
-        
-        for (int i = 0; i < results->num_crops; i++) {
-            const CropEmissionResults *crop_result = &results->crop_results[i];
-            fprintf(file, "%-12s %8.1f %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
-                   crops[crop_result->crop_id].name,
-                   crop_result->area,
-                   crop_result->fertilizer_emissions,
-                   crop_result->fuel_emissions,
-                   crop_result->irrigation_emissions,
-                   crop_result->pesticide_emissions,
-                   crop_result->livestock_emissions,
-                   crop_result->total_emissions);
+        report_writer_text(writer, "Crop          Area(ha)   Fert(");
+        report_writer_text(writer, co2_unit);
+        report_writer_text(writer, ")   Fuel   Irrig   Pestic   Live.   Total\n");
+        report_writer_text(writer, "-------------------------------------------------------------------\n");
+
+        for (int i = 0; i < num_crops; i++) {
+            const CropEmissionResults *crop_result = &crop_results[i];
+            const double values[] = {
+                crop_result->fertilizer_emissions, crop_result->fuel_emissions,
+                crop_result->irrigation_emissions, crop_result->pesticide_emissions,
+                crop_result->livestock_emissions, crop_result->total_emissions
+            };
+            report_writer_left(writer, crops[crop_result->crop_id].name, 12);
+            report_writer_text(writer, " ");
+            report_writer_fixed(writer, crop_result->area, 8, 1);
+            for (int c = 0; c < 6; c++) {
+                report_writer_text(writer, " ");
+                report_writer_fixed(writer, values[c], widths[c], 2);
+            }
+            report_writer_text(writer, "\n");
         }
-        
-        fprintf(file, "-------------------------------------------------------------------\n");
-        fprintf(file, "FARM TOTAL   %8.1f %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
-               farm->total_farm_size,
-               results->fertilizer_emissions,
-               results->fuel_emissions,
-               results->irrigation_emissions,
-               results->pesticide_emissions,
-               results->livestock_emissions,
-               results->total_emissions);
-        
-        fprintf(file, "Per Hectare            %10.2f %8.2f %7.2f %8.2f %7.2f %7.2f\n",
-               results->fertilizer_emissions / farm->total_farm_size,
-               results->fuel_emissions / farm->total_farm_size,
-               results->irrigation_emissions / farm->total_farm_size,
-               results->pesticide_emissions / farm->total_farm_size,
-               results->livestock_emissions / farm->total_farm_size,
-               results->per_hectare_emissions);
+
+        const double farm_values[] = {
+            totals->fertilizer_emissions, totals->fuel_emissions, totals->irrigation_emissions,
+            totals->pesticide_emissions, totals->livestock_emissions, totals->total_emissions
+        };
+        report_writer_text(writer, "-------------------------------------------------------------------\n");
+        report_writer_text(writer, "FARM TOTAL   ");
+        report_writer_fixed(writer, total_farm_size, 8, 1);
+        for (int c = 0; c < 6; c++) {
+            report_writer_text(writer, " ");
+            report_writer_fixed(writer, farm_values[c], widths[c], 2);
+        }
+        report_writer_text(writer, "\n");
+
+        report_writer_text(writer, "Per Hectare           ");
+        for (int c = 0; c < 6; c++) {
+            report_writer_text(writer, " ");
+            report_writer_fixed(writer, per_hectare[c], widths[c], 2);
+        }
+        report_writer_text(writer, "\n");
     } else {
         // Legacy format
-        fprintf(file, "Farm Size: %.1f ha\n", farm->total_farm_size);
-        fprintf(file, "\nEmission Breakdown:\n");
-        fprintf(file, "Fertilizer Emissions: %.2f %s\n", results->fertilizer_emissions, co2_unit);
-        fprintf(file, "Manure Emissions: %.2f %s\n", results->manure_emissions, co2_unit);
-        fprintf(file, "Fuel Emissions: %.2f %s\n", results->fuel_emissions, co2_unit);
-        fprintf(file, "Irrigation Emissions: %.2f %s\n", results->irrigation_emissions, co2_unit);
-        fprintf(file, "Pesticide Emissions: %.2f %s\n", results->pesticide_emissions, co2_unit);
-        fprintf(file, "Livestock Emissions: %.2f %s\n", results->livestock_emissions, co2_unit);
-        fprintf(file, "\nTotal Emissions: %.2f %s\n", results->total_emissions, co2_unit);
-        fprintf(file, "Per Hectare: %.2f %s/ha\n", results->per_hectare_emissions, co2_unit);
+        report_writer_text(writer, "Farm Size: ");
+        report_writer_fixed(writer, total_farm_size, 0, 1);
+        report_writer_text(writer, " ha\n");
+        report_writer_text(writer, "\nEmission Breakdown:\n");
+        write_emission_line(writer, "Fertilizer Emissions: ", totals->fertilizer_emissions, co2_unit);
+        write_emission_line(writer, "Manure Emissions: ", totals->manure_emissions, co2_unit);
+        write_emission_line(writer, "Fuel Emissions: ", totals->fuel_emissions, co2_unit);
+        write_emission_line(writer, "Irrigation Emissions: ", totals->irrigation_emissions, co2_unit);
+        write_emission_line(writer, "Pesticide Emissions: ", totals->pesticide_emissions, co2_unit);
+        write_emission_line(writer, "Livestock Emissions: ", totals->livestock_emissions, co2_unit);
+        write_emission_line(writer, "\nTotal Emissions: ", totals->total_emissions, co2_unit);
+        report_writer_text(writer, "Per Hectare: ");
+        report_writer_fixed(writer, totals->per_hectare_emissions, 0, 2);
+        report_writer_text(writer, " ");
+        report_writer_text(writer, co2_unit);
+        report_writer_text(writer, "/ha\n");
+    }
+
+    report_writer_text(writer, "===================================================================\n");
+    report_writer_text(writer, "Units: all emissions in ");
+    report_writer_text(writer, co2_unit);
+    report_writer_text(writer, " (tons of CO2 equivalent).\n");
+}
+
+// Appends the saved-report layout of a legacy single-crop farm
+void write_legacy_report(ReportWriter *writer, const char *farm_id, const LegacyFarmData *farm,
+                         const EmissionTotals *totals) {
+    const char* co2_unit = USE_UTF8_SYMBOLS ? "tCO₂e" : "tCO2e";
+
+    report_writer_text(writer, "Farm Carbon Footprint Report\n");
+    report_writer_text(writer, "============================\n");
+    if (farm_id) {
+        report_writer_text(writer, "Farm ID: ");
+        report_writer_text(writer, farm_id);
+        report_writer_text(writer, "\n");
+    }
+    report_writer_text(writer, "Farm Size: ");
+    report_writer_fixed(writer, farm->farm_size, 0, 1);
+    report_writer_text(writer, " ha\n");
+    report_writer_text(writer, "Crop Type: ");
+    report_writer_text(writer, farm->crop_type);
+    report_writer_text(writer, "\n");
+    report_writer_text(writer, "\nEmission Breakdown:\n");
+    write_emission_line(writer, "Fertilizer Emissions: ", totals->fertilizer_emissions, co2_unit);
+    write_emission_line(writer, "Manure Emissions: ", totals->manure_emissions, co2_unit);
+    write_emission_line(writer, "Fuel Emissions: ", totals->fuel_emissions, co2_unit);
+    write_emission_line(writer, "Irrigation Emissions: ", totals->irrigation_emissions, co2_unit);
+    write_emission_line(writer, "Livestock Emissions: ", totals->livestock_emissions, co2_unit);
+    write_emission_line(writer, "\nTotal Emissions: ", totals->total_emissions, co2_unit);
+    report_writer_text(writer, "Per Hectare: ");
+    report_writer_fixed(writer, totals->per_hectare_emissions, 0, 2);
+    report_writer_text(writer, " ");
+    report_writer_text(writer, co2_unit);
+    report_writer_text(writer, "/ha\n");
+}
+
+static void totals_from_results(EmissionTotals *totals, const EmissionResults *results) {
+    totals->fertilizer_emissions = results->fertilizer_emissions;
+    totals->manure_emissions = results->manure_emissions;
+    totals->fuel_emissions = results->fuel_emissions;
+    totals->irrigation_emissions = results->irrigation_emissions;
+    totals->pesticide_emissions = results->pesticide_emissions;
+    totals->livestock_emissions = results->livestock_emissions;
+    totals->total_emissions = results->total_emissions;
+    totals->per_hectare_emissions = results->per_hectare_emissions;
+}
+
+static void save_farm_report(double total_farm_size, const EmissionResults *results,
+                             const CropEmissionResults *crop_results, const char *filename) {
+    ReportWriter writer;
+    EmissionTotals totals;
+
+    if (!report_writer_open(&writer, filename, 0)) {
+        printf("Warning: Could not save report to %s\n", filename);
+        return;
+    }
+    totals_from_results(&totals, results);
+    write_farm_report(&writer, NULL, total_farm_size, &totals, crop_results, results->num_crops);
+    if (!report_writer_close(&writer)) {
+        printf("Warning: Could not save report to %s\n", filename);
+        return;
     }
-    
-    fprintf(file, "===================================================================\n");
-    fprintf(file, "Units: all emissions in %s (tons of CO2 equivalent).\n", co2_unit);
-    
-    fclose(file);
     printf("Report saved to %s\n", filename);
 }
 
+void save_report_to_file(const FarmData *farm, const EmissionResults *results, const char *filename) {
+    save_farm_report(farm->total_farm_size, results, results->crop_results, filename);
+}
+
+void save_farm_record_report_to_file(const FarmRecord *farm, const EmissionResults *results,
+                                     const CropEmissionResults *crop_results, const char *filename) {
+    save_farm_report(farm->total_farm_size, results, crop_results, filename);
+}
+
 void save_legacy_report_to_file(const LegacyFarmData *farm, const EmissionResults *results, const char *filename) {
-    FILE *file = fopen(filename, "w");
-    if (!file) {
+    ReportWriter writer;
+    EmissionTotals totals;
+
+    if (!report_writer_open(&writer, filename, 0)) {
+        printf("Warning: Could not save report to %s\n", filename);
+        return;
+    }
+    totals_from_results(&totals, results);
+    write_legacy_report(&writer, NULL, farm, &totals);
+    if (!report_writer_close(&writer)) {
         printf("Warning: Could not save report to %s\n", filename);
         return;
     }
-    
-    const char* co2_unit = USE_UTF8_SYMBOLS ? "tCO₂e" : "tCO2e";
-    
-    fprintf(file, "Farm Carbon Footprint Report\n");
-    fprintf(file, "============================\n");
-    fprintf(file, "Farm Size: %.1f ha\n", farm->farm_size);
-    fprintf(file, "Crop Type: %s\n", farm->crop_type);
-    fprintf(file, "\nEmission Breakdown:\n");
-    fprintf(file, "Fertilizer Emissions: %.2f %s\n", results->fertilizer_emissions, co2_unit);
-    fprintf(file, "Manure Emissions: %.2f %s\n", results->manure_emissions, co2_unit);
-    fprintf(file, "Fuel Emissions: %.2f %s\n", results->fuel_emissions, co2_unit);
-    fprintf(file, "Irrigation Emissions: %.2f %s\n", results->irrigation_emissions, co2_unit);
-    fprintf(file, "Livestock Emissions: %.2f %s\n", results->livestock_emissions, co2_unit);
-    fprintf(file, "\nTotal Emissions: %.2f %s\n", results->total_emissions, co2_unit);
-    fprintf(file, "Per Hectare: %.2f %s/ha\n", results->per_hectare_emissions, co2_unit);
-    
-    fclose(file);
     printf("Report saved to %s\n", filename);
 }
 
@@ -3,12 +3,21 @@
 
 #include "input.h"
 #include "compute.h"
+#include "report_writer.h"
 
 // Function declarations
 void print_report(const FarmData *farm, const EmissionResults *results);
+void print_farm_record_report(const FarmRecord *farm, const EmissionResults *results,
+                              const CropEmissionResults *crop_results);
 void print_legacy_report(const LegacyFarmData *farm, const EmissionResults *results);
 void save_report_to_file(const FarmData *farm, const EmissionResults *results, const char *filename);
+void save_farm_record_report_to_file(const FarmRecord *farm, const EmissionResults *results,
+                                     const CropEmissionResults *crop_results, const char *filename);
 void save_legacy_report_to_file(const LegacyFarmData *farm, const EmissionResults *results, const char *filename);
+void write_farm_report(ReportWriter *writer, const char *farm_id, double total_farm_size,
+                       const EmissionTotals *totals, const CropEmissionResults *crop_results, int num_crops);
+void write_legacy_report(ReportWriter *writer, const char *farm_id, const LegacyFarmData *farm,
+                         const EmissionTotals *totals);
 void print_recommendations(const EmissionResults *results);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "report_writer.h"
+
+static const double powers_of_ten[FIXED_MAX_DECIMALS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+// Opens path for a run's reports, truncated or (append) added to. The file
+// is unbuffered by stdio; the writer's own buffer takes its place. Returns
+// 0 if the file cannot be opened.
+int report_writer_open(ReportWriter *writer, const char *path, int append) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, append ? "a" : "w");
+    if (!writer->file) {
+        return 0;
+    }
+    setvbuf(writer->file, NULL, _IONBF, 0);
+    writer->data = malloc(REPORT_WRITER_BUFFER);
+    if (!writer->data) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return 0;
+    }
+    writer->capacity = REPORT_WRITER_BUFFER;
+    return 1;
+}
+
+// Makes room for length more bytes: a file writer flushes, a memory writer
+// grows. Returns 0 if the bytes still do not fit.
+static int reserve(ReportWriter *writer, size_t length) {
+    if (writer->capacity - writer->length >= length) {
+        return 1;
+    }
+    if (writer->file) {
+        report_writer_flush(writer);
+        return writer->capacity - writer->length >= length;
+    }
+
+    size_t capacity = writer->capacity ? writer->capacity * 2 : 4096;
+    while (capacity - writer->length < length) {
+        capacity *= 2;
+    }
+    char *data = realloc(writer->data, capacity);
+    if (!data) {
+        writer->failed = 1;
+        return 0;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+    return 1;
+}
+
+void report_writer_write(ReportWriter *writer, const char *text, size_t length) {
+    if (reserve(writer, length)) {
+        memcpy(writer->data + writer->length, text, length);
+        writer->length += length;
+    } else if (writer->file && !writer->failed) {
+        // Larger than the whole buffer: write it straight through
+        if (fwrite(text, 1, length, writer->file) != length) {
+            writer->failed = 1;
+        }
+    }
+}
+
+void report_writer_text(ReportWriter *writer, const char *text) {
+    report_writer_write(writer, text, strlen(text));
+}
+
+static void write_spaces(ReportWriter *writer, long count) {
+    static const char spaces[] = "                                ";
+
+    while (count > 0) {
+        size_t pad = count < (long)sizeof(spaces) - 1 ? (size_t)count : sizeof(spaces) - 1;
+        report_writer_write(writer, spaces, pad);
+        count -= (long)pad;
+    }
+}
+
+// Text padded with spaces on the right to width, like "%-*s"
+void report_writer_left(ReportWriter *writer, const char *text, int width) {
+    size_t length = strlen(text);
+
+    report_writer_write(writer, text, length);
+    write_spaces(writer, (long)width - (long)length);
+}
+
+// A number with a fixed count of decimals, padded on the left to width:
+// the same text as "%*.*f"
+void report_writer_fixed(ReportWriter *writer, double value, int width, int decimals) {
+    char text[FIXED_TEXT_MAX];
+    size_t length = format_fixed(text, value, decimals);
+
+    write_spaces(writer, (long)width - (long)length);
+    report_writer_write(writer, text, length);
+}
+
+// Appends what a memory writer collected; a failure in it carries over
+void report_writer_append(ReportWriter *writer, const ReportWriter *part) {
+    if (part->failed) {
+        writer->failed = 1;
+    }
+    if (part->length > 0) {
+        report_writer_write(writer, part->data, part->length);
+    }
+}
+
+// Empties a memory writer for reuse
+void report_writer_reset(ReportWriter *writer) {
+    writer->length = 0;
+    writer->failed = 0;
+}
+
+// Writes out what a file writer has collected. Returns 0 once any write has
+// failed.
+int report_writer_flush(ReportWriter *writer) {
+    if (writer->file && writer->length > 0 && !writer->failed) {
+        if (fwrite(writer->data, 1, writer->length, writer->file) != writer->length) {
+            writer->failed = 1;
+        }
+    }
+    if (writer->file) {
+        writer->length = 0;
+    }
+    return !writer->failed;
+}
+
+// Flushes and closes a file writer, or frees a memory writer. Returns 0 if
+// any write or allocation failed.
+int report_writer_close(ReportWriter *writer) {
+    int ok = report_writer_flush(writer);
+
+    if (writer->file && fclose(writer->file) != 0) {
+        ok = 0;
+    }
+    free(writer->data);
+    memset(writer, 0, sizeof(*writer));
+    return ok;
+}
+
+// Formats value with decimals digits after the point, exactly as printf's
+// "%.*f" does, and returns the length written to text (FIXED_TEXT_MAX
+// bytes). The scaled value is split into whole and fractional parts; its
+// rounding can only be in doubt when the fraction is exactly one half, and
+// then the exact product (recovered with fma) decides, with true ties
+// rounded to even. Values too large for 52 bits of digits, infinities and
+// NaN fall back to snprintf.
+size_t format_fixed(char *text, double value, int decimals) {
+    if (decimals < 0 || decimals > FIXED_MAX_DECIMALS) {
+        int length = snprintf(text, FIXED_TEXT_MAX, "%.*f", decimals < 0 ? 6 : decimals, value);
+        return length < FIXED_TEXT_MAX ? (size_t)length : FIXED_TEXT_MAX - 1;
+    }
+
+    double magnitude = fabs(value);
+    double scale = powers_of_ten[decimals];
+    double scaled = magnitude * scale;
+    if (!(scaled < 4503599627370496.0)) {
+        int length = snprintf(text, FIXED_TEXT_MAX, "%.*f", decimals, value);
+        return length < FIXED_TEXT_MAX ? (size_t)length : FIXED_TEXT_MAX - 1;
+    }
+
+    double whole = floor(scaled);
+    double fraction = scaled - whole;
+    uint64_t digits = (uint64_t)whole;
+    if (fraction > 0.5) {
+        digits++;
+    } else if (fraction == 0.5) {
+        double error = fma(magnitude, scale, -scaled);
+        if (error > 0.0 || (error == 0.0 && (digits & 1))) {
+            digits++;
+        }
+    }
+
+    // Digits are produced backwards into the end of a scratch buffer
+    char scratch[32];
+    char *end = scratch + sizeof(scratch);
+    char *p = end;
+    for (int i = 0; i < decimals; i++) {
+        *--p = (char)('0' + digits % 10);
+        digits /= 10;
+    }
+    if (decimals > 0) {
+        *--p = '.';
+    }
+    do {
+        *--p = (char)('0' + digits % 10);
+        digits /= 10;
+    } while (digits > 0);
+    if (signbit(value)) {
+        *--p = '-';
+    }
+
+    size_t length = (size_t)(end - p);
+    memcpy(text, p, length);
+    text[length] = '\0';
+    return length;
+}
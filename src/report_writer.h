@@ -0,0 +1,41 @@
+#ifndef REPORT_WRITER_H
+#define REPORT_WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Bytes a file writer collects before each write to its file
+#define REPORT_WRITER_BUFFER (1 << 20)
+
+// Most decimals format_fixed() handles itself; more go through snprintf
+#define FIXED_MAX_DECIMALS 9
+
+// Longest text format_fixed() produces, including the terminator
+#define FIXED_TEXT_MAX 330
+
+// Append-only text writer with its own large buffer, so a report of many
+// farms costs one write per megabyte instead of stdio calls per field.
+// A zero-initialised writer has no file and collects its text in memory,
+// growing as needed, so worker threads can format reports that one thread
+// then appends to the file writer in order.
+typedef struct {
+    FILE *file;                 // NULL for a memory writer
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;                 // set after a failed allocation or write
+} ReportWriter;
+
+// Function declarations
+int report_writer_open(ReportWriter *writer, const char *path, int append);
+void report_writer_write(ReportWriter *writer, const char *text, size_t length);
+void report_writer_text(ReportWriter *writer, const char *text);
+void report_writer_left(ReportWriter *writer, const char *text, int width);
+void report_writer_fixed(ReportWriter *writer, double value, int width, int decimals);
+void report_writer_append(ReportWriter *writer, const ReportWriter *part);
+void report_writer_reset(ReportWriter *writer);
+int report_writer_flush(ReportWriter *writer);
+int report_writer_close(ReportWriter *writer);
+size_t format_fixed(char *text, double value, int decimals);
+
+#endif
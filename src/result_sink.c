@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "result_sink.h"
+
+static const char *const result_format_names[NUM_RESULT_FORMATS] = {"table", "csv", "jsonl"};
+
+// Numeric columns after farm_id, crop (and num_crops for farms), in order
+static const char *const farm_columns[] = {
+    "farm_size_ha", "fertilizer_tco2e", "manure_tco2e", "fuel_tco2e", "irrigation_tco2e",
+    "pesticide_tco2e", "livestock_tco2e", "total_tco2e", "per_hectare_tco2e"
+};
+static const char *const crop_columns[] = {
+    "area_ha", "fertilizer_tco2e", "manure_tco2e", "fuel_tco2e", "irrigation_tco2e",
+    "pesticide_tco2e", "livestock_tco2e", "total_tco2e"
+};
+
+#define NUM_FARM_COLUMNS (int)(sizeof(farm_columns) / sizeof(farm_columns[0]))
+#define NUM_CROP_COLUMNS (int)(sizeof(crop_columns) / sizeof(crop_columns[0]))
+
+int parse_result_format(const char *name, ResultFormat *format) {
+    for (int f = 0; f < NUM_RESULT_FORMATS; f++) {
+        if (strcmp(name, result_format_names[f]) == 0) {
+            *format = (ResultFormat)f;
+            return 1;
+        }
+    }
+    printf("Error: Unknown output format '%s' (use table, csv or jsonl)\n", name);
+    return 0;
+}
+
+const char *result_format_name(ResultFormat format) {
+    return result_format_names[format];
+}
+
+// The CSV column header; JSON Lines objects name their own fields and the
+// table has its own header (write_batch_header)
+void write_result_header(FILE *out, ResultFormat format, int per_crop) {
+    const char *const *columns = per_crop ? crop_columns : farm_columns;
+    int count = per_crop ? NUM_CROP_COLUMNS : NUM_FARM_COLUMNS;
+
+    if (format != RESULT_CSV) {
+        return;
+    }
+    fputs(per_crop ? "farm_id,crop" : "farm_id,crop,num_crops", out);
+    for (int c = 0; c < count; c++) {
+        fprintf(out, ",%s", columns[c]);
+    }
+    fputc('\n', out);
+}
+
+// A CSV field, quoted only when it holds a comma, quote or line break
+static void write_csv_text(ReportWriter *out, const char *text) {
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+        report_writer_text(out, text);
+        return;
+    }
+    report_writer_write(out, "\"", 1);
+    for (const char *c = text; *c; c++) {
+        report_writer_write(out, c, 1);
+        if (*c == '"') {
+            report_writer_write(out, "\"", 1);
+        }
+    }
+    report_writer_write(out, "\"", 1);
+}
+
+// A JSON string with quotes, backslashes and control characters escaped
+static void write_json_text(ReportWriter *out, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+
+    report_writer_write(out, "\"", 1);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            char escaped[2] = {'\\', (char)*c};
+            report_writer_write(out, escaped, 2);
+        } else if (*c < 0x20) {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[*c >> 4], hex[*c & 15]};
+            report_writer_write(out, escaped, 6);
+        } else {
+            report_writer_write(out, (const char *)c, 1);
+        }
+    }
+    report_writer_write(out, "\"", 1);
+}
+
+// Writes "name": for JSON, or the separating comma for CSV
+static void write_key(ReportWriter *out, ResultFormat format, const char *name, int first) {
+    if (!first) {
+        report_writer_write(out, ",", 1);
+    }
+    if (format == RESULT_JSONL) {
+        write_json_text(out, name);
+        report_writer_write(out, ":", 1);
+    }
+}
+
+// A text field; NULL is an empty CSV field or JSON null
+static void write_text_field(ReportWriter *out, ResultFormat format, const char *name, const char *text, int first) {
+    write_key(out, format, name, first);
+    if (format == RESULT_JSONL) {
+        if (text) {
+            write_json_text(out, text);
+        } else {
+            report_writer_write(out, "null", 4);
+        }
+    } else if (text) {
+        write_csv_text(out, text);
+    }
+}
+
+// Fixed-point numbers through format_fixed(); NaN and infinities have no
+// JSON spelling, so they are left empty (CSV) or null
+static void write_number_fields(ReportWriter *out, ResultFormat format, const char *const *names,
+                                const double *values, int count) {
+    for (int c = 0; c < count; c++) {
+        write_key(out, format, names[c], 0);
+        if (isfinite(values[c])) {
+            report_writer_fixed(out, values[c], 0, RESULT_DECIMALS);
+        } else if (format == RESULT_JSONL) {
+            report_writer_write(out, "null", 4);
+        }
+    }
+}
+
+// One farm's totals as a CSV row or JSON object. crop is the farm's only
+// crop, or NULL when it has several.
+void write_farm_result(ReportWriter *out, ResultFormat format, const char *farm_id, const char *crop,
+                       int num_crops, double farm_size, const EmissionTotals *results) {
+    const double values[NUM_FARM_COLUMNS] = {
+        farm_size,
+        results->fertilizer_emissions,
+        results->manure_emissions,
+        results->fuel_emissions,
+        results->irrigation_emissions,
+        results->pesticide_emissions,
+        results->livestock_emissions,
+        results->total_emissions,
+        results->per_hectare_emissions
+    };
+    char count[16];
+
+    if (format == RESULT_JSONL) {
+        report_writer_write(out, "{", 1);
+    }
+    write_text_field(out, format, "farm_id", farm_id, 1);
+    write_text_field(out, format, "crop", crop, 0);
+    write_key(out, format, "num_crops", 0);
+    snprintf(count, sizeof(count), "%d", num_crops);
+    report_writer_text(out, count);
+    write_number_fields(out, format, farm_columns, values, NUM_FARM_COLUMNS);
+    report_writer_text(out, format == RESULT_JSONL ? "}\n" : "\n");
+}
+
+// One crop's results (livestock share included) as a CSV row or JSON object
+void write_crop_result(ReportWriter *out, ResultFormat format, const char *farm_id, const char *crop,
+                       const CropEmissionResults *result) {
+    const double values[NUM_CROP_COLUMNS] = {
+        result->area,
+        result->fertilizer_emissions,
+        result->manure_emissions,
+        result->fuel_emissions,
+        result->irrigation_emissions,
+        result->pesticide_emissions,
+        result->livestock_emissions,
+        result->total_emissions
+    };
+
+    if (format == RESULT_JSONL) {
+        report_writer_write(out, "{", 1);
+    }
+    write_text_field(out, format, "farm_id", farm_id, 1);
+    write_text_field(out, format, "crop", crop, 0);
+    write_number_fields(out, format, crop_columns, values, NUM_CROP_COLUMNS);
+    report_writer_text(out, format == RESULT_JSONL ? "}\n" : "\n");
+}
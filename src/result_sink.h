@@ -0,0 +1,29 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <stdio.h>
+#include "compute.h"
+#include "report_writer.h"
+
+// Layout of batch results on the output
+typedef enum {
+    RESULT_TABLE = 0,           // aligned columns for reading
+    RESULT_CSV,                 // one CSV row per farm or crop, with a header
+    RESULT_JSONL,               // one JSON object per line per farm or crop
+    NUM_RESULT_FORMATS
+} ResultFormat;
+
+// Decimals of every emission, area and farm size in CSV and JSON Lines
+// output (tonnes CO2e to the gram)
+#define RESULT_DECIMALS 6
+
+// Function declarations
+int parse_result_format(const char *name, ResultFormat *format);
+const char *result_format_name(ResultFormat format);
+void write_result_header(FILE *out, ResultFormat format, int per_crop);
+void write_farm_result(ReportWriter *out, ResultFormat format, const char *farm_id, const char *crop,
+                       int num_crops, double farm_size, const EmissionTotals *results);
+void write_crop_result(ReportWriter *out, ResultFormat format, const char *farm_id, const char *crop,
+                       const CropEmissionResults *result);
+
+#endif
@@ -0,0 +1,539 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "result_store.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#define NUM_DOUBLE_COLUMNS (NUM_RESULT_COLUMNS - RESULT_NUM_INT_COLUMNS)
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+// Bytes before the codes of a dictionary column with count values
+static size_t dictionary_codes_offset(size_t count) {
+    return align8(sizeof(uint32_t) + count * sizeof(int32_t));
+}
+
+static void write_bytes(ResultStore *store, const void *data, size_t size) {
+    if (store->failed || size == 0) {
+        return;
+    }
+    if (fwrite(data, 1, size, store->file) != size) {
+        store->failed = 1;
+    }
+    store->position += size;
+}
+
+// Zero bytes up to the next multiple of 8
+static void write_padding(ResultStore *store) {
+    static const unsigned char zeros[8] = {0};
+    write_bytes(store, zeros, align8((size_t)store->position) - (size_t)store->position);
+}
+
+static void write_file_header(ResultStore *store, uint64_t index_offset) {
+    ResultFileHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESULT_FILE_MAGIC, sizeof(header.magic));
+    header.version = RESULT_FILE_VERSION;
+    header.byte_order = RESULT_FILE_BYTE_ORDER;
+    header.num_columns = NUM_RESULT_COLUMNS;
+    header.flags = store->dictionary ? RESULT_FILE_DICTIONARY : 0;
+    header.num_rows = store->num_rows;
+    header.num_farms = store->num_farms;
+    header.num_groups = store->num_groups;
+    header.index_offset = index_offset;
+    write_bytes(store, &header, sizeof(header));
+}
+
+// Creates path with an unfinished header. Without dictionary every integer
+// column is stored plain. Returns 0 if the file cannot be created.
+int result_store_create(ResultStore *store, const char *path, int dictionary) {
+    int ok = 1;
+
+    memset(store, 0, sizeof(*store));
+    store->dictionary = dictionary;
+    for (int c = 0; c < RESULT_NUM_INT_COLUMNS; c++) {
+        store->ints[c] = malloc(RESULT_GROUP_ROWS * sizeof(int32_t));
+        ok = ok && store->ints[c];
+    }
+    for (int c = 0; c < NUM_DOUBLE_COLUMNS; c++) {
+        store->doubles[c] = malloc(RESULT_GROUP_ROWS * sizeof(double));
+        ok = ok && store->doubles[c];
+    }
+    store->codes = malloc((size_t)RESULT_NUM_INT_COLUMNS * RESULT_GROUP_ROWS);
+    if (ok && store->codes) {
+        store->file = fopen(path, "wb");
+    }
+    if (!store->file) {
+        result_store_close(store, 0);
+        return 0;
+    }
+    write_file_header(store, 0);
+    if (store->failed) {
+        result_store_close(store, 0);
+        return 0;
+    }
+    return 1;
+}
+
+// One-byte codes into a dictionary of the distinct values, in order of
+// first appearance. Returns the dictionary size, or -1 if a value is out of
+// range or there are too many of them.
+static int build_dictionary(const int32_t *values, size_t count, int32_t *dictionary, uint8_t *codes) {
+    int16_t code_of[RESULT_DICTIONARY_RANGE + 1];
+    int size = 0;
+
+    memset(code_of, 0xff, sizeof(code_of));
+    for (size_t i = 0; i < count; i++) {
+        int32_t value = values[i];
+        if (value < -1 || value >= RESULT_DICTIONARY_RANGE) {
+            return -1;
+        }
+        int16_t *code = &code_of[value + 1];
+        if (*code < 0) {
+            if (size == RESULT_DICTIONARY_SIZE) {
+                return -1;
+            }
+            dictionary[size] = value;
+            *code = (int16_t)size++;
+        }
+        codes[i] = (uint8_t)*code;
+    }
+    return size;
+}
+
+// Writes the staged rows as one row group
+static void flush_group(ResultStore *store) {
+    ResultGroupHeader header;
+    int32_t dictionary[RESULT_NUM_INT_COLUMNS][RESULT_DICTIONARY_SIZE];
+    int dictionary_size[RESULT_NUM_INT_COLUMNS];
+    size_t rows = store->rows;
+
+    if (rows == 0) {
+        return;
+    }
+    if (store->num_groups == store->group_capacity) {
+        size_t capacity = store->group_capacity ? store->group_capacity * 2 : 64;
+        uint64_t *offsets = realloc(store->group_offset, capacity * sizeof(uint64_t));
+        if (!offsets) {
+            store->failed = 1;
+            return;
+        }
+        store->group_offset = offsets;
+        store->group_capacity = capacity;
+    }
+
+    // Lay the columns out after the group header
+    memset(&header, 0, sizeof(header));
+    header.num_rows = rows;
+    uint64_t offset = store->position + align8(sizeof(header));
+    for (int c = 0; c < NUM_RESULT_COLUMNS; c++) {
+        size_t size;
+        if (c < RESULT_NUM_INT_COLUMNS) {
+            dictionary_size[c] = store->dictionary ?
+                build_dictionary(store->ints[c], rows, dictionary[c], store->codes + (size_t)c * RESULT_GROUP_ROWS) : -1;
+            if (dictionary_size[c] >= 0) {
+                header.encoding[c] = RESULT_DICTIONARY8;
+                size = dictionary_codes_offset((size_t)dictionary_size[c]) + rows;
+            } else {
+                header.encoding[c] = RESULT_PLAIN;
+                size = rows * sizeof(int32_t);
+            }
+        } else {
+            header.encoding[c] = RESULT_PLAIN;
+            size = rows * sizeof(double);
+        }
+        header.offset[c] = offset;
+        header.size[c] = size;
+        offset += align8(size);
+    }
+
+    store->group_offset[store->num_groups++] = store->position;
+    write_bytes(store, &header, sizeof(header));
+    write_padding(store);
+    for (int c = 0; c < NUM_RESULT_COLUMNS; c++) {
+        if (c >= RESULT_NUM_INT_COLUMNS) {
+            write_bytes(store, store->doubles[c - RESULT_NUM_INT_COLUMNS], rows * sizeof(double));
+        } else if (header.encoding[c] == RESULT_DICTIONARY8) {
+            uint32_t count = (uint32_t)dictionary_size[c];
+            write_bytes(store, &count, sizeof(count));
+            write_bytes(store, dictionary[c], count * sizeof(int32_t));
+            write_padding(store);
+            write_bytes(store, store->codes + (size_t)c * RESULT_GROUP_ROWS, rows);
+        } else {
+            write_bytes(store, store->ints[c], rows * sizeof(int32_t));
+        }
+        write_padding(store);
+    }
+    store->num_rows += rows;
+    store->rows = 0;
+}
+
+// Appends the crop rows of an evaluated block, in order. Returns 0 once a
+// write has failed.
+int result_store_add(ResultStore *store, const ResultBlock *block) {
+    const CropEmissionColumns *emissions = block->emissions;
+    const double *sources[NUM_DOUBLE_COLUMNS] = {
+        NULL, block->area, emissions->fertilizer, emissions->manure, emissions->fuel,
+        emissions->irrigation, emissions->pesticide, emissions->livestock, emissions->total
+    };
+    size_t first = block->crop_start[0];
+    size_t num_rows = block->crop_start[block->num_farms] - first;
+    size_t done = 0;
+    size_t f = 0;
+
+    while (done < num_rows && !store->failed) {
+        size_t count = RESULT_GROUP_ROWS - store->rows;
+        size_t at = store->rows;
+        if (count > num_rows - done) {
+            count = num_rows - done;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            size_t row = first + done + i;
+            while (block->crop_start[f + 1] <= row) {
+                f++;
+            }
+            store->ints[RESULT_FARM][at + i] = (int32_t)(store->num_farms + f);
+            store->ints[RESULT_CROP_ID][at + i] = block->crop_id[row];
+            store->ints[RESULT_PESTICIDE_ID][at + i] = block->pesticide_id[row];
+            store->ints[RESULT_FACTOR_SET][at + i] = block->factor_set ? block->factor_set[f] : factor_table.default_set;
+            store->doubles[0][at + i] = block->total_farm_size[f];
+        }
+        for (int c = 1; c < NUM_DOUBLE_COLUMNS; c++) {
+            memcpy(store->doubles[c] + at, sources[c] + first + done, count * sizeof(double));
+        }
+
+        store->rows += count;
+        done += count;
+        if (store->rows == RESULT_GROUP_ROWS) {
+            flush_group(store);
+        }
+    }
+    store->num_farms += block->num_farms;
+    return !store->failed;
+}
+
+// Writes the last group and the group index, completes the header and
+// closes the file. A file that is not complete (its run failed) is closed
+// as it is, with index_offset still 0, so readers refuse it. Returns 0 if
+// any write failed.
+int result_store_close(ResultStore *store, int complete) {
+    int ok = store->file != NULL;
+
+    if (store->file && !complete) {
+        if (fclose(store->file) != 0) {
+            ok = 0;
+        }
+    } else if (store->file) {
+        flush_group(store);
+        uint64_t index_offset = store->position;
+        write_bytes(store, store->group_offset, store->num_groups * sizeof(uint64_t));
+        if (fseek(store->file, 0, SEEK_SET) != 0) {
+            store->failed = 1;
+        }
+        write_file_header(store, index_offset);
+        if (fclose(store->file) != 0 || store->failed) {
+            ok = 0;
+        }
+    }
+    for (int c = 0; c < RESULT_NUM_INT_COLUMNS; c++) {
+        free(store->ints[c]);
+    }
+    for (int c = 0; c < NUM_DOUBLE_COLUMNS; c++) {
+        free(store->doubles[c]);
+    }
+    free(store->codes);
+    free(store->group_offset);
+    memset(store, 0, sizeof(*store));
+    return ok;
+}
+
+// Maps a result file and checks its header and group index
+int result_file_open(ResultFile *file, const char *path) {
+    memset(file, 0, sizeof(*file));
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        printf("Error: Cannot open file \"%s\"\n", path);
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        printf("Error: Cannot determine size of \"%s\"\n", path);
+        CloseHandle(handle);
+        return 0;
+    }
+    file->file_handle = handle;
+    file->size = (size_t)size.QuadPart;
+
+    if (file->size > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            printf("Error: Cannot map file \"%s\"\n", path);
+            CloseHandle(handle);
+            return 0;
+        }
+        file->map_handle = mapping;
+        file->data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!file->data) {
+            printf("Error: Cannot map file \"%s\"\n", path);
+            CloseHandle(mapping);
+            CloseHandle(handle);
+            return 0;
+        }
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: Cannot open file \"%s\"\n", path);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("Error: Cannot determine size of \"%s\"\n", path);
+        close(fd);
+        return 0;
+    }
+    file->size = (size_t)st.st_size;
+
+    if (file->size > 0) {
+        void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            printf("Error: Cannot map file \"%s\"\n", path);
+            close(fd);
+            return 0;
+        }
+        file->data = (const unsigned char *)map;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+
+    const ResultFileHeader *header = (const ResultFileHeader *)file->data;
+    const char *problem = NULL;
+    if (file->size < sizeof(ResultFileHeader) || memcmp(header->magic, RESULT_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        problem = "is not a result file";
+    } else if (header->byte_order != RESULT_FILE_BYTE_ORDER) {
+        problem = "was written with a different byte order";
+    } else if (header->version != RESULT_FILE_VERSION || header->num_columns != NUM_RESULT_COLUMNS) {
+        problem = "has an unsupported version";
+    } else if (header->index_offset == 0) {
+        problem = "is incomplete (the run that wrote it did not finish)";
+    } else if (header->index_offset % 8 != 0 || header->index_offset > file->size ||
+               header->num_groups > (file->size - header->index_offset) / sizeof(uint64_t)) {
+        problem = "is damaged";
+    }
+    if (problem) {
+        printf("Error: \"%s\" %s\n", path, problem);
+        result_file_close(file);
+        return 0;
+    }
+    file->header = header;
+    file->group_offset = (const uint64_t *)(file->data + header->index_offset);
+    return 1;
+}
+
+void result_file_close(ResultFile *file) {
+#ifdef _WIN32
+    if (file->data) UnmapViewOfFile(file->data);
+    if (file->map_handle) CloseHandle(file->map_handle);
+    if (file->file_handle) CloseHandle(file->file_handle);
+#else
+    if (file->data) munmap((void *)file->data, file->size);
+#endif
+    memset(file, 0, sizeof(*file));
+}
+
+size_t result_file_groups(const ResultFile *file) {
+    return (size_t)file->header->num_groups;
+}
+
+// Finds the columns of group index, checking that every one lies inside
+// the file and has the size its encoding implies. Nothing is copied.
+int result_file_group(const ResultFile *file, size_t index, ResultGroup *group) {
+    uint64_t offset = file->group_offset[index];
+    const ResultGroupHeader *header;
+
+    memset(group, 0, sizeof(*group));
+    if (offset % 8 != 0 || offset > file->size || file->size - offset < sizeof(ResultGroupHeader)) {
+        printf("Error: Result file is damaged (group %lu)\n", (unsigned long)index);
+        return 0;
+    }
+    header = (const ResultGroupHeader *)(file->data + offset);
+    if (header->num_rows > RESULT_GROUP_ROWS) {
+        printf("Error: Result file is damaged (group %lu)\n", (unsigned long)index);
+        return 0;
+    }
+    group->num_rows = (size_t)header->num_rows;
+
+    for (int c = 0; c < NUM_RESULT_COLUMNS; c++) {
+        uint64_t start = header->offset[c];
+        uint64_t size = header->size[c];
+        int ok = start % 8 == 0 && start <= file->size && size <= file->size - start;
+
+        if (ok && header->encoding[c] == RESULT_DICTIONARY8 && c < RESULT_NUM_INT_COLUMNS) {
+            uint32_t count = size >= sizeof(uint32_t) ? *(const uint32_t *)(file->data + start) : 0;
+            ok = size >= sizeof(uint32_t) && count >= 1 && count <= RESULT_DICTIONARY_SIZE &&
+                 size == dictionary_codes_offset(count) + group->num_rows;
+        } else if (ok && header->encoding[c] == RESULT_PLAIN) {
+            size_t width = c < RESULT_NUM_INT_COLUMNS ? sizeof(int32_t) : sizeof(double);
+            ok = size == group->num_rows * width;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            printf("Error: Result file is damaged (group %lu, column %d)\n", (unsigned long)index, c);
+            return 0;
+        }
+        group->encoding[c] = (ResultEncoding)header->encoding[c];
+        group->column[c] = file->data + start;
+        group->size[c] = (size_t)size;
+    }
+    return 1;
+}
+
+// A double column of the group, read in place; NULL for integer columns
+const double *result_group_doubles(const ResultGroup *group, ResultColumn column) {
+    if (column < RESULT_NUM_INT_COLUMNS || column >= NUM_RESULT_COLUMNS) {
+        return NULL;
+    }
+    return (const double *)group->column[column];
+}
+
+// Decodes an integer column of the group into values (num_rows entries)
+void result_group_ints(const ResultGroup *group, ResultColumn column, int *values) {
+    const unsigned char *data = group->column[column];
+
+    if (group->encoding[column] == RESULT_DICTIONARY8) {
+        const int32_t *dictionary = (const int32_t *)(data + sizeof(uint32_t));
+        uint32_t count = *(const uint32_t *)data;
+        const uint8_t *codes = data + dictionary_codes_offset(count);
+        for (size_t i = 0; i < group->num_rows; i++) {
+            values[i] = codes[i] < count ? dictionary[codes[i]] : -2;
+        }
+    } else {
+        const int32_t *plain = (const int32_t *)data;
+        for (size_t i = 0; i < group->num_rows; i++) {
+            values[i] = plain[i];
+        }
+    }
+}
+
+// Totals every row of a result file into a total rollup, group by group
+// through a partial as the batch engine does block by block. The partials
+// are row groups, not blocks, so the totals match the batch run's only up
+// to rounding. Only the columns the rollup's dimensions need are decoded
+// (crop, pesticide and factor set ids, farm size); the value columns are
+// summed in place. Returns 0 if the file
+// is damaged, was written with other crop, pesticide or factor tables, or
+// memory runs out.
+int rollup_result_file(const ResultFile *file, Rollup *rollup) {
+    int by_crop = (rollup->dimensions & (1u << ROLLUP_CROP)) != 0;
+    int by_pesticide = (rollup->dimensions & (1u << ROLLUP_PESTICIDE_TYPE)) != 0;
+    int by_region = (rollup->dimensions & (1u << ROLLUP_REGION)) != 0;
+    int by_size = (rollup->dimensions & (1u << ROLLUP_SIZE_BAND)) != 0;
+    int *crop_id = by_crop ? malloc(RESULT_GROUP_ROWS * sizeof(int)) : NULL;
+    int *pesticide_id = by_pesticide ? malloc(RESULT_GROUP_ROWS * sizeof(int)) : NULL;
+    int *factor_set = by_region ? malloc(RESULT_GROUP_ROWS * sizeof(int)) : NULL;
+    size_t *crop_start = malloc((RESULT_GROUP_ROWS + 1) * sizeof(size_t));
+    int num_sets = factor_table.num_regions * factor_table.num_years;
+    Rollup partial;
+    int ok = 1;
+
+    if ((by_crop && !crop_id) || (by_pesticide && !pesticide_id) || (by_region && !factor_set) ||
+        !crop_start || !rollup_init(&partial, rollup->dimensions, rollup->mode, 1)) {
+        printf("Error: Out of memory\n");
+        free(crop_id);
+        free(pesticide_id);
+        free(factor_set);
+        free(crop_start);
+        return 0;
+    }
+
+    // Every crop row is given to the rollup as a farm of its own, carrying
+    // the farm columns stored on it
+    for (size_t i = 0; i <= RESULT_GROUP_ROWS; i++) {
+        crop_start[i] = i;
+    }
+
+    for (size_t g = 0; ok && g < result_file_groups(file); g++) {
+        ResultGroup group;
+        if (!result_file_group(file, g, &group)) {
+            ok = 0;
+            break;
+        }
+        size_t n = group.num_rows;
+
+        if (by_crop) {
+            result_group_ints(&group, RESULT_CROP_ID, crop_id);
+        }
+        if (by_pesticide) {
+            result_group_ints(&group, RESULT_PESTICIDE_ID, pesticide_id);
+        }
+        if (by_region) {
+            result_group_ints(&group, RESULT_FACTOR_SET, factor_set);
+        }
+        for (size_t i = 0; i < n; i++) {
+            if ((by_crop && (crop_id[i] < 0 || crop_id[i] >= num_crops)) ||
+                (by_pesticide && (pesticide_id[i] < -1 || pesticide_id[i] >= num_pesticides)) ||
+                (by_region && (factor_set[i] < 0 || factor_set[i] >= num_sets))) {
+                printf("Error: Result file does not match the loaded crop, pesticide or factor tables\n");
+                ok = 0;
+                break;
+            }
+        }
+        if (!ok) break;
+
+        // The value columns are only read (the casts drop const for the
+        // kernel's column types). Ids and farm sizes not decoded are left
+        // NULL; the rollup reads only those of its dimensions.
+        FarmColumns farms = {
+            crop_start, by_size ? result_group_doubles(&group, RESULT_FARM_SIZE) : NULL, NULL, NULL, NULL,
+            factor_set
+        };
+        CropEmissionColumns emissions = {
+            (double *)result_group_doubles(&group, RESULT_FERTILIZER),
+            (double *)result_group_doubles(&group, RESULT_MANURE),
+            (double *)result_group_doubles(&group, RESULT_FUEL),
+            (double *)result_group_doubles(&group, RESULT_IRRIGATION),
+            (double *)result_group_doubles(&group, RESULT_PESTICIDE),
+            (double *)result_group_doubles(&group, RESULT_LIVESTOCK),
+            (double *)result_group_doubles(&group, RESULT_TOTAL)
+        };
+        rollup_reset(&partial);
+        if (n > 0 && !rollup_add_farms(&partial, &farms, n, crop_id, pesticide_id,
+                                       result_group_doubles(&group, RESULT_AREA), &emissions)) {
+            printf("Error: Out of memory\n");
+            ok = 0;
+            break;
+        }
+        rollup_merge(rollup, &partial);
+    }
+
+    rollup_free(&partial);
+    free(crop_id);
+    free(pesticide_id);
+    free(factor_set);
+    free(crop_start);
+    return ok;
+}
@@ -0,0 +1,144 @@
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "compute_batch.h"
+#include "rollup.h"
+
+// Binary columnar file of per-crop results. After a fixed header come row
+// groups; each group has a header giving the offset, size and encoding of
+// every column, followed by the columns one after another (8-byte aligned),
+// so a reader maps the file and touches only the columns it needs. An
+// index of group offsets is written last and the header rewritten to point
+// at it, so a file cut short is never mistaken for a complete one. Values
+// are stored in the writer's byte order, which the header records.
+#define RESULT_FILE_MAGIC "CFRESULT"
+#define RESULT_FILE_VERSION 1
+#define RESULT_FILE_BYTE_ORDER 0x01020304u
+
+// Crop rows per row group
+#define RESULT_GROUP_ROWS 65536
+
+// Integer columns with at most this many distinct values in a group may be
+// stored as one-byte codes into a dictionary of the values
+#define RESULT_DICTIONARY_SIZE 256
+
+// Integer values from -1 up to this range can be dictionary encoded
+#define RESULT_DICTIONARY_RANGE 4096
+
+// Header flag: the writer was allowed to dictionary encode
+#define RESULT_FILE_DICTIONARY 1u
+
+// Columns of a result file, one entry per crop row. Integer columns come
+// first; the farm columns repeat on every row of the farm.
+typedef enum {
+    RESULT_FARM = 0,            // 0-based farm number in the run
+    RESULT_CROP_ID,
+    RESULT_PESTICIDE_ID,        // -1 if none
+    RESULT_FACTOR_SET,          // factor set of the farm
+    RESULT_FARM_SIZE,           // first double column: hectares
+    RESULT_AREA,                // hectares
+    RESULT_FERTILIZER,          // tonnes CO2e
+    RESULT_MANURE,
+    RESULT_FUEL,
+    RESULT_IRRIGATION,
+    RESULT_PESTICIDE,
+    RESULT_LIVESTOCK,
+    RESULT_TOTAL,
+    NUM_RESULT_COLUMNS
+} ResultColumn;
+
+#define RESULT_NUM_INT_COLUMNS RESULT_FARM_SIZE
+
+// How a column's values are laid out
+typedef enum {
+    RESULT_PLAIN = 0,           // int32_t or double per row
+    RESULT_DICTIONARY8          // uint32_t count, int32_t values[count], padding, uint8_t code per row
+} ResultEncoding;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        // RESULT_FILE_BYTE_ORDER as the writer stored it
+    uint32_t num_columns;
+    uint32_t flags;
+    uint64_t num_rows;
+    uint64_t num_farms;
+    uint64_t num_groups;
+    uint64_t index_offset;      // num_groups group offsets; 0 while unfinished
+} ResultFileHeader;
+
+typedef struct {
+    uint64_t num_rows;
+    uint64_t offset[NUM_RESULT_COLUMNS];    // from the start of the file
+    uint64_t size[NUM_RESULT_COLUMNS];      // bytes
+    uint32_t encoding[NUM_RESULT_COLUMNS];
+    uint32_t reserved;
+} ResultGroupHeader;
+
+// One block of evaluated farms, column by column, as the batch engine holds
+// them; farm f owns crop rows [crop_start[f], crop_start[f + 1])
+typedef struct {
+    size_t num_farms;
+    const size_t *crop_start;
+    const double *total_farm_size;
+    const int *factor_set;      // NULL when every farm uses the default set
+    const int *crop_id;
+    const int *pesticide_id;
+    const double *area;
+    const CropEmissionColumns *emissions;
+} ResultBlock;
+
+// Writer of a result file. Rows are staged column by column and written a
+// group at a time.
+typedef struct {
+    FILE *file;
+    int dictionary;             // dictionary encode integer columns where it fits
+    int failed;
+    uint64_t position;          // bytes written so far
+    size_t rows;                // staged rows
+    int32_t *ints[RESULT_NUM_INT_COLUMNS];
+    double *doubles[NUM_RESULT_COLUMNS - RESULT_NUM_INT_COLUMNS];
+    uint8_t *codes;
+    uint64_t num_rows;
+    uint64_t num_farms;
+    uint64_t *group_offset;
+    size_t num_groups;
+    size_t group_capacity;
+} ResultStore;
+
+// A result file mapped read-only
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const ResultFileHeader *header;
+    const uint64_t *group_offset;
+#ifdef _WIN32
+    void *file_handle;
+    void *map_handle;
+#endif
+} ResultFile;
+
+// One row group of a mapped file; columns point into the mapping
+typedef struct {
+    size_t num_rows;
+    ResultEncoding encoding[NUM_RESULT_COLUMNS];
+    const unsigned char *column[NUM_RESULT_COLUMNS];
+    size_t size[NUM_RESULT_COLUMNS];
+} ResultGroup;
+
+// Function declarations
+int result_store_create(ResultStore *store, const char *path, int dictionary);
+int result_store_add(ResultStore *store, const ResultBlock *block);
+int result_store_close(ResultStore *store, int complete);
+int result_file_open(ResultFile *file, const char *path);
+void result_file_close(ResultFile *file);
+size_t result_file_groups(const ResultFile *file);
+int result_file_group(const ResultFile *file, size_t index, ResultGroup *group);
+const double *result_group_doubles(const ResultGroup *group, ResultColumn column);
+void result_group_ints(const ResultGroup *group, ResultColumn column, int *values);
+int rollup_result_file(const ResultFile *file, Rollup *rollup);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include "ring_buffer.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sched.h>
+    #include <time.h>
+#endif
+
+int ring_buffer_init(RingBuffer *ring, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    ring->cells = malloc(size * sizeof(RingCell));
+    if (!ring->cells) {
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        ring->cells[i].sequence = i;
+        ring->cells[i].item = NULL;
+    }
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    return 1;
+}
+
+void ring_buffer_free(RingBuffer *ring) {
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+// Returns 0 if the ring is full
+int ring_buffer_push(RingBuffer *ring, void *item) {
+    size_t position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    while (1) {
+        RingCell *cell = &ring->cells[position & ring->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)(sequence - position);
+
+        if (diff == 0) {
+            // Slot is free: claim it, or retry from the new head if another
+            // producer got there first
+            if (__atomic_compare_exchange_n(&ring->head, &position, position + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->item = item;
+                __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Returns 0 if the ring is empty
+int ring_buffer_pop(RingBuffer *ring, void **item) {
+    size_t position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        RingCell *cell = &ring->cells[position & ring->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)(sequence - (position + 1));
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &position, position + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *item = cell->item;
+                // Hand the slot back to producers one lap later
+                __atomic_store_n(&cell->sequence, position + ring->mask + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Waits a little longer on each call: spin briefly, then yield the CPU,
+// then sleep, so a stalled stage does not burn a core
+void ring_buffer_backoff(unsigned *attempt) {
+    unsigned n = (*attempt)++;
+
+    if (n < 16) {
+        return;
+    }
+#ifdef _WIN32
+    Sleep(n < 64 ? 0 : 1);
+#else
+    if (n < 64) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, 50000};
+        nanosleep(&pause, NULL);
+    }
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+// One slot of the ring; the sequence number tells producers and consumers
+// whose turn it is to use the slot
+typedef struct {
+    size_t sequence;
+    void *item;
+} RingCell;
+
+// Bounded lock-free multi-producer/multi-consumer queue of pointers.
+// Capacity is rounded up to a power of two. Push fails when the ring is
+// full and pop fails when it is empty; callers back off and retry, which
+// gives the pipeline its backpressure.
+typedef struct {
+    RingCell *cells;
+    size_t mask;
+    char pad0[64];
+    size_t head;                // next slot to push (producers)
+    char pad1[64];
+    size_t tail;                // next slot to pop (consumers)
+    char pad2[64];
+} RingBuffer;
+
+// Function declarations
+int ring_buffer_init(RingBuffer *ring, size_t capacity);
+void ring_buffer_free(RingBuffer *ring);
+int ring_buffer_push(RingBuffer *ring, void *item);
+int ring_buffer_pop(RingBuffer *ring, void **item);
+void ring_buffer_backoff(unsigned *attempt);
+
+#endif
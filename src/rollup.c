@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rollup.h"
+
+static const char *const dimension_names[NUM_ROLLUP_DIMENSIONS] = {
+    "crop", "region", "size", "pesticide"
+};
+
+static const char *const dimension_titles[NUM_ROLLUP_DIMENSIONS] = {
+    "Emissions by crop", "Emissions by region", "Emissions by farm size", "Emissions by pesticide type"
+};
+
+static const double size_band_floor[ROLLUP_SIZE_BANDS] = {0.0, 10.0, 50.0, 100.0, 500.0, 1000.0};
+
+static const char *const size_band_names[ROLLUP_SIZE_BANDS] = {
+    "<10 ha", "10-50 ha", "50-100 ha", "100-500 ha", "500-1000 ha", ">=1000 ha"
+};
+
+// Parses a comma-separated list of dimensions (crop, region, size,
+// pesticide) or "all". Returns 0 on an unknown name.
+int parse_rollup_dimensions(const char *spec, unsigned *dimensions) {
+    char name[32];
+
+    *dimensions = 0;
+    while (*spec) {
+        size_t length = strcspn(spec, ",");
+        int found = -1;
+
+        if (length == 0 || length >= sizeof(name)) {
+            printf("Error: Bad rollup list near '%s'\n", spec);
+            return 0;
+        }
+        memcpy(name, spec, length);
+        name[length] = '\0';
+        if (strcmp(name, "all") == 0) {
+            *dimensions |= ROLLUP_ALL_DIMENSIONS;
+            found = 0;
+        }
+        for (int d = 0; d < NUM_ROLLUP_DIMENSIONS && found < 0; d++) {
+            if (strcmp(name, dimension_names[d]) == 0) {
+                *dimensions |= 1u << d;
+                found = d;
+            }
+        }
+        if (found < 0) {
+            printf("Error: Unknown rollup '%s' (use crop, region, size, pesticide or all)\n", name);
+            return 0;
+        }
+        spec += length;
+        if (*spec == ',') spec++;
+    }
+    return *dimensions != 0;
+}
+
+// Numbers the distinct pesticide types; group 0 is rows without a pesticide
+static int group_pesticide_types(Rollup *rollup) {
+    int count = 1;
+
+    rollup->pesticide_group = malloc((size_t)(num_pesticides > 0 ? num_pesticides : 1) * sizeof(int));
+    rollup->pesticide_types = malloc((size_t)(num_pesticides + 1) * sizeof(char *));
+    if (!rollup->pesticide_group || !rollup->pesticide_types) {
+        return 0;
+    }
+    rollup->pesticide_types[0] = "None";
+    for (int p = 0; p < num_pesticides; p++) {
+        int group = 1;
+        while (group < count && strcmp(rollup->pesticide_types[group], pesticides[p].type) != 0) {
+            group++;
+        }
+        if (group == count) {
+            rollup->pesticide_types[count++] = pesticides[p].type;
+        }
+        rollup->pesticide_group[p] = group;
+    }
+    return count;
+}
+
+// Sets up empty groups for the given dimensions: the sums of one block
+// when partial is set, otherwise running totals. Returns 0 if out of memory.
+int rollup_init(Rollup *rollup, unsigned dimensions, SumMode mode, int partial) {
+    memset(rollup, 0, sizeof(*rollup));
+    rollup->dimensions = dimensions;
+    rollup->mode = mode;
+
+    int pesticide_types = group_pesticide_types(rollup);
+    if (!pesticide_types) {
+        rollup_free(rollup);
+        return 0;
+    }
+    const int groups[NUM_ROLLUP_DIMENSIONS] = {
+        num_crops, factor_table.num_regions, ROLLUP_SIZE_BANDS, pesticide_types
+    };
+    for (int d = 0; d < NUM_ROLLUP_DIMENSIONS; d++) {
+        rollup->group_offset[d] = rollup->total_groups;
+        rollup->num_groups[d] = (dimensions & (1u << d)) ? groups[d] : 0;
+        rollup->total_groups += rollup->num_groups[d];
+    }
+
+    size_t total = (size_t)rollup->total_groups + 1;
+    rollup->rows = calloc(total, sizeof(long));
+    if (partial) {
+        rollup->sums = calloc(total * NUM_ROLLUP_COLUMNS, sizeof(double));
+        rollup->group_start = calloc(total, sizeof(size_t));
+    } else {
+        rollup->totals = calloc(total * NUM_ROLLUP_COLUMNS, sizeof(SumAccumulator));
+    }
+    if (!rollup->rows || (partial ? !rollup->sums || !rollup->group_start : !rollup->totals)) {
+        rollup_free(rollup);
+        return 0;
+    }
+    return 1;
+}
+
+void rollup_reset(Rollup *rollup) {
+    size_t total = (size_t)rollup->total_groups;
+    memset(rollup->rows, 0, total * sizeof(long));
+    if (rollup->sums) {
+        memset(rollup->sums, 0, total * NUM_ROLLUP_COLUMNS * sizeof(double));
+    }
+    if (rollup->totals) {
+        memset(rollup->totals, 0, total * NUM_ROLLUP_COLUMNS * sizeof(SumAccumulator));
+    }
+}
+
+void rollup_free(Rollup *rollup) {
+    free(rollup->rows);
+    free(rollup->sums);
+    free(rollup->totals);
+    free(rollup->pesticide_group);
+    free(rollup->pesticide_types);
+    free(rollup->keys);
+    free(rollup->order);
+    free(rollup->gathered);
+    free(rollup->group_start);
+    memset(rollup, 0, sizeof(*rollup));
+}
+
+static int size_band(double farm_size) {
+    int band = ROLLUP_SIZE_BANDS - 1;
+    while (band > 0 && farm_size < size_band_floor[band]) {
+        band--;
+    }
+    return band;
+}
+
+// Group of every crop row along one dimension
+static void group_keys(const Rollup *rollup, int dimension, const FarmColumns *farms, size_t num_farms,
+                       const int *crop_id, const int *pesticide_id, int *keys) {
+    int offset = rollup->group_offset[dimension];
+    size_t first = farms->crop_start[0];
+    size_t num_rows = farms->crop_start[num_farms] - first;
+
+    switch (dimension) {
+        case ROLLUP_CROP:
+            for (size_t i = 0; i < num_rows; i++) {
+                keys[i] = offset + crop_id[first + i];
+            }
+            break;
+        case ROLLUP_PESTICIDE_TYPE:
+            for (size_t i = 0; i < num_rows; i++) {
+                int id = pesticide_id[first + i];
+                keys[i] = offset + (id >= 0 ? rollup->pesticide_group[id] : 0);
+            }
+            break;
+        default:
+            // Farm-level dimensions: every row of a farm shares its group
+            for (size_t f = 0; f < num_farms; f++) {
+                int key;
+                if (dimension == ROLLUP_REGION) {
+                    int set = farms->factor_set ? farms->factor_set[f] : factor_table.default_set;
+                    key = offset + set / factor_table.num_years;
+                } else {
+                    key = offset + size_band(farms->total_farm_size[f]);
+                }
+                for (size_t i = farms->crop_start[f]; i < farms->crop_start[f + 1]; i++) {
+                    keys[i - first] = key;
+                }
+            }
+            break;
+    }
+}
+
+static int reserve_scratch(Rollup *rollup, size_t num_rows) {
+    if (num_rows <= rollup->scratch_capacity) {
+        return 1;
+    }
+    int *keys = realloc(rollup->keys, num_rows * sizeof(int));
+    if (keys) rollup->keys = keys;
+    size_t *order = realloc(rollup->order, num_rows * sizeof(size_t));
+    if (order) rollup->order = order;
+    double *gathered = realloc(rollup->gathered, num_rows * sizeof(double));
+    if (gathered) rollup->gathered = gathered;
+    if (!keys || !order || !gathered) {
+        return 0;
+    }
+    rollup->scratch_capacity = num_rows;
+    return 1;
+}
+
+// Adds the evaluated crop rows of num_farms farms (laid out as for
+// calculate_farm_columns) to a partial rollup. For each dimension the rows
+// are counting-sorted by group, keeping input order within a group, and
+// every column is then gathered in that order and summed group by group.
+// Returns 0 if out of memory.
+int rollup_add_farms(Rollup *rollup, const FarmColumns *farms, size_t num_farms,
+                     const int *crop_id, const int *pesticide_id, const double *area,
+                     const CropEmissionColumns *emissions) {
+    size_t first = farms->crop_start[0];
+    size_t num_rows = farms->crop_start[num_farms] - first;
+    size_t *group_start = rollup->group_start;
+    const double *columns[NUM_ROLLUP_COLUMNS] = {
+        area, emissions->fertilizer, emissions->manure, emissions->fuel, emissions->irrigation,
+        emissions->pesticide, emissions->livestock, emissions->total
+    };
+
+    if (!reserve_scratch(rollup, num_rows)) {
+        return 0;
+    }
+
+    for (int d = 0; d < NUM_ROLLUP_DIMENSIONS; d++) {
+        if (!(rollup->dimensions & (1u << d))) continue;
+        int begin = rollup->group_offset[d];
+        int end = begin + rollup->num_groups[d];
+
+        group_keys(rollup, d, farms, num_farms, crop_id, pesticide_id, rollup->keys);
+        memset(group_start + begin, 0, (size_t)(end - begin + 1) * sizeof(size_t));
+        for (size_t i = 0; i < num_rows; i++) {
+            group_start[rollup->keys[i] + 1]++;
+        }
+        for (int g = begin; g < end; g++) {
+            rollup->rows[g] += (long)group_start[g + 1];
+            group_start[g + 1] += group_start[g];
+        }
+        for (size_t i = 0; i < num_rows; i++) {
+            rollup->order[group_start[rollup->keys[i]]++] = i;
+        }
+        // The scatter moved each start to the next group's; shift back
+        for (int g = end; g > begin; g--) {
+            group_start[g] = group_start[g - 1];
+        }
+        group_start[begin] = 0;
+
+        for (int c = 0; c < NUM_ROLLUP_COLUMNS; c++) {
+            const double *values = columns[c] + first;
+            for (size_t i = 0; i < num_rows; i++) {
+                rollup->gathered[i] = values[rollup->order[i]];
+            }
+            for (int g = begin; g < end; g++) {
+                size_t count = group_start[g + 1] - group_start[g];
+                if (count > 0) {
+                    rollup->sums[(size_t)g * NUM_ROLLUP_COLUMNS + c] +=
+                        sum_values(rollup->mode, rollup->gathered + group_start[g], count);
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// Pushes a partial rollup's sums into a total with the same dimensions.
+// Partials must be merged in input order for reproducible totals.
+void rollup_merge(Rollup *into, const Rollup *part) {
+    for (int g = 0; g < into->total_groups; g++) {
+        into->rows[g] += part->rows[g];
+    }
+    for (int g = 0; g < into->total_groups; g++) {
+        if (part->rows[g] == 0) continue;
+        for (int c = 0; c < NUM_ROLLUP_COLUMNS; c++) {
+            size_t cell = (size_t)g * NUM_ROLLUP_COLUMNS + c;
+            sum_accumulator_add(into->mode, &into->totals[cell], part->sums[cell]);
+        }
+    }
+}
+
+double rollup_value(const Rollup *rollup, int group, int column) {
+    size_t cell = (size_t)group * NUM_ROLLUP_COLUMNS + column;
+    if (rollup->totals) {
+        return sum_accumulator_value(rollup->mode, &rollup->totals[cell]);
+    }
+    return rollup->sums[cell];
+}
+
+static const char *group_name(const Rollup *rollup, int dimension, int index) {
+    switch (dimension) {
+        case ROLLUP_CROP:           return crops[index].name;
+        case ROLLUP_REGION:         return factor_table.regions[index].name;
+        case ROLLUP_SIZE_BAND:      return size_band_names[index];
+        default:                    return rollup->pesticide_types[index];
+    }
+}
+
+static void print_rollup_line(FILE *out, const char *label, long rows, const double *values) {
+    fprintf(out, "%-14.14s %10ld %12.1f", label, rows, values[ROLLUP_AREA]);
+    for (int c = ROLLUP_FERTILIZER; c < NUM_ROLLUP_COLUMNS; c++) {
+        fprintf(out, " %12.2f", values[c]);
+    }
+    fprintf(out, " %8.2f\n", values[ROLLUP_AREA] > 0 ? values[ROLLUP_TOTAL] / values[ROLLUP_AREA] : 0.0);
+}
+
+// One table per enabled dimension, listing the groups that have rows
+void print_rollup(FILE *out, const Rollup *rollup) {
+    for (int d = 0; d < NUM_ROLLUP_DIMENSIONS; d++) {
+        if (!(rollup->dimensions & (1u << d))) continue;
+
+        SumAccumulator all[NUM_ROLLUP_COLUMNS];
+        double values[NUM_ROLLUP_COLUMNS];
+        long all_rows = 0;
+
+        memset(all, 0, sizeof(all));
+        fprintf(out, "\n%s (t CO2e)\n", dimension_titles[d]);
+        fprintf(out, "%-14s %10s %12s %12s %12s %12s %12s %12s %12s %12s %8s\n",
+                "Group", "Crop rows", "Area(ha)", "Fert", "Manure", "Fuel", "Irrig", "Pestic", "Live.",
+                "Total", "Per ha");
+        for (int i = 0; i < rollup->num_groups[d]; i++) {
+            int group = rollup->group_offset[d] + i;
+            if (rollup->rows[group] == 0) continue;
+
+            for (int c = 0; c < NUM_ROLLUP_COLUMNS; c++) {
+                values[c] = rollup_value(rollup, group, c);
+                sum_accumulator_add(rollup->mode, &all[c], values[c]);
+            }
+            all_rows += rollup->rows[group];
+            print_rollup_line(out, group_name(rollup, d, i), rollup->rows[group], values);
+        }
+        for (int c = 0; c < NUM_ROLLUP_COLUMNS; c++) {
+            values[c] = sum_accumulator_value(rollup->mode, &all[c]);
+        }
+        print_rollup_line(out, "All", all_rows, values);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "input.h"
+#include "compute.h"
+#include "compute_batch.h"
+#include "summation.h"
+
+// Dimensions crop rows can be grouped by
+typedef enum {
+    ROLLUP_CROP = 0,
+    ROLLUP_REGION,              // factor pack region of the farm
+    ROLLUP_SIZE_BAND,           // band of the farm's total size
+    ROLLUP_PESTICIDE_TYPE,
+    NUM_ROLLUP_DIMENSIONS
+} RollupDimension;
+
+#define ROLLUP_ALL_DIMENSIONS ((1u << NUM_ROLLUP_DIMENSIONS) - 1)
+
+// Farm size bands, by lower bound in hectares
+#define ROLLUP_SIZE_BANDS 6
+
+// Columns summed per group
+typedef enum {
+    ROLLUP_AREA = 0,
+    ROLLUP_FERTILIZER,
+    ROLLUP_MANURE,
+    ROLLUP_FUEL,
+    ROLLUP_IRRIGATION,
+    ROLLUP_PESTICIDE,
+    ROLLUP_LIVESTOCK,
+    ROLLUP_TOTAL,
+    NUM_ROLLUP_COLUMNS
+} RollupColumn;
+
+// Group-by sums of crop results over the enabled dimensions. The groups of
+// every dimension are dense small integers (crop, region, size band or
+// pesticide type index), so each dimension is a slice of one array of
+// groups and a crop row is found by index, not by a hash lookup.
+//
+// A partial rollup holds the sums of one block of rows: the rows of each
+// group are gathered together and summed with the rollup's SumMode. A
+// total rollup pushes the partials' sums, in input order, into one
+// SumAccumulator per cell, so the result depends on the input and the
+// block size but not on which thread evaluated a block.
+typedef struct {
+    unsigned dimensions;                    // bit per RollupDimension
+    SumMode mode;
+    int group_offset[NUM_ROLLUP_DIMENSIONS];  // first group of each dimension
+    int num_groups[NUM_ROLLUP_DIMENSIONS];
+    int total_groups;
+    long *rows;                             // crop rows per group
+    double *sums;                           // partial: total_groups x NUM_ROLLUP_COLUMNS
+    SumAccumulator *totals;                 // total: the same cells, NULL in a partial
+    int *pesticide_group;                   // pesticide type group per pesticide
+    const char **pesticide_types;           // names of the type groups
+
+    // Scratch for grouping a block, grown to its row count
+    int *keys;                              // group of each crop row
+    size_t *order;                          // rows sorted by group
+    double *gathered;                       // one column in that order
+    size_t scratch_capacity;
+    size_t *group_start;                    // total_groups + 1 entries
+} Rollup;
+
+// Function declarations
+int parse_rollup_dimensions(const char *spec, unsigned *dimensions);
+int rollup_init(Rollup *rollup, unsigned dimensions, SumMode mode, int partial);
+void rollup_reset(Rollup *rollup);
+void rollup_free(Rollup *rollup);
+int rollup_add_farms(Rollup *rollup, const FarmColumns *farms, size_t num_farms,
+                     const int *crop_id, const int *pesticide_id, const double *area,
+                     const CropEmissionColumns *emissions);
+void rollup_merge(Rollup *into, const Rollup *part);
+double rollup_value(const Rollup *rollup, int group, int column);
+void print_rollup(FILE *out, const Rollup *rollup);
+
+#endif
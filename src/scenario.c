@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "scenario.h"
+
+// Farm total categories, in EmissionTotals order
+enum {
+    CATEGORY_FERTILIZER = 0,
+    CATEGORY_MANURE,
+    CATEGORY_FUEL,
+    CATEGORY_IRRIGATION,
+    CATEGORY_PESTICIDE,
+    CATEGORY_LIVESTOCK,
+    NUM_CATEGORIES
+};
+
+// Crop levers come first in ScenarioLever; the rest scale livestock
+#define NUM_CROP_LEVERS LEVER_COWS
+
+static const struct {
+    const char *name;
+    const char *alias;
+    int category;               // farm total the lever feeds
+} levers[NUM_LEVERS] = {
+    {"n",          "nitrogen",   CATEGORY_FERTILIZER},
+    {"p",          "phosphorus", CATEGORY_FERTILIZER},
+    {"k",          "potassium",  CATEGORY_FERTILIZER},
+    {"manure",     NULL,         CATEGORY_MANURE},
+    {"diesel",     NULL,         CATEGORY_FUEL},
+    {"irrigation", "irr",        CATEGORY_IRRIGATION},
+    {"pesticide",  "pest",       CATEGORY_PESTICIDE},
+    {"cows",       NULL,         CATEGORY_LIVESTOCK},
+    {"pigs",       NULL,         CATEGORY_LIVESTOCK},
+    {"chickens",   NULL,         CATEGORY_LIVESTOCK}
+};
+
+const char *scenario_lever_name(int lever) {
+    return lever >= 0 && lever < NUM_LEVERS ? levers[lever].name : NULL;
+}
+
+static int find_lever(const char *name) {
+    for (int l = 0; l < NUM_LEVERS; l++) {
+        if (strcmp(name, levers[l].name) == 0 || (levers[l].alias && strcmp(name, levers[l].alias) == 0)) {
+            return l;
+        }
+    }
+    return -1;
+}
+
+// A percentage change: an input can be cut to nothing but not below
+static int parse_delta(const char *text, double *delta) {
+    char *end;
+    *delta = strtod(text, &end);
+    return end != text && *end == '\0' && *delta >= -100.0 && *delta <= 1000.0;
+}
+
+// Parses "VALUE", "FROM:TO:STEP" (inclusive, stepping towards TO) or
+// "V1/V2/..." into an axis
+static int parse_axis_values(char *spec, ScenarioAxis *axis) {
+    char *colon = strchr(spec, ':');
+    axis->num_values = 0;
+
+    if (colon) {
+        char *second = strchr(colon + 1, ':');
+        double from, to, step;
+        if (!second) return 0;
+        *colon = '\0';
+        *second = '\0';
+        if (!parse_delta(spec, &from) || !parse_delta(colon + 1, &to)) return 0;
+
+        char *end;
+        step = fabs(strtod(second + 1, &end));
+        if (*end != '\0' || !(step > 0.0)) return 0;
+        double steps = floor(fabs(to - from) / step + 1e-9);
+        if (steps + 1 > SCENARIO_MAX_VALUES) return 0;
+        for (int i = 0; i <= (int)steps; i++) {
+            axis->values[axis->num_values++] = to >= from ? from + i * step : from - i * step;
+        }
+        return 1;
+    }
+
+    for (char *value = strtok(spec, "/"); value; value = strtok(NULL, "/")) {
+        if (axis->num_values == SCENARIO_MAX_VALUES || !parse_delta(value, &axis->values[axis->num_values])) {
+            return 0;
+        }
+        axis->num_values++;
+    }
+    return axis->num_values > 0;
+}
+
+// Parses a grid such as "n=-10:-50:10,diesel=0/-15/-30,irrigation=-40".
+// Values are percentage changes from the farm's own inputs.
+int parse_scenario_grid(const char *text, ScenarioGrid *grid) {
+    char buffer[1024];
+    char *items[NUM_LEVERS + 1];
+    int num_items = 0;
+
+    memset(grid, 0, sizeof(*grid));
+    if (strlen(text) >= sizeof(buffer)) {
+        printf("Error: Scenario grid is too long\n");
+        return 0;
+    }
+    strcpy(buffer, text);
+
+    // Split first: the value lists are tokenized with strtok as well
+    for (char *item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        if (num_items == NUM_LEVERS + 1) break;
+        items[num_items++] = item;
+    }
+    if (num_items == 0 || num_items > NUM_LEVERS) {
+        printf("Error: A scenario grid needs 1 to %d comma-separated levers\n", NUM_LEVERS);
+        return 0;
+    }
+
+    long count = 1;
+    for (int i = 0; i < num_items; i++) {
+        char *eq = strchr(items[i], '=');
+        if (!eq) {
+            printf("Error: Expected 'lever=values' in scenario grid, got '%s'\n", items[i]);
+            return 0;
+        }
+        *eq = '\0';
+        int lever = find_lever(items[i]);
+        if (lever < 0) {
+            printf("Error: Unknown scenario lever '%s' (n, p, k, manure, diesel, irrigation, "
+                   "pesticide, cows, pigs, chickens)\n", items[i]);
+            return 0;
+        }
+        for (int a = 0; a < grid->num_axes; a++) {
+            if (grid->axes[a].lever == lever) {
+                printf("Error: Scenario lever '%s' is given twice\n", items[i]);
+                return 0;
+            }
+        }
+
+        ScenarioAxis *axis = &grid->axes[grid->num_axes];
+        axis->lever = lever;
+        if (!parse_axis_values(eq + 1, axis)) {
+            printf("Error: Invalid values for scenario lever '%s': use V, FROM:TO:STEP or V1/V2/... "
+                   "with changes from -100 to 1000 (%%), at most %d values\n", items[i], SCENARIO_MAX_VALUES);
+            return 0;
+        }
+        grid->num_axes++;
+        count *= axis->num_values;
+        if (count > SCENARIO_MAX_COUNT) {
+            printf("Error: Scenario grid has more than %d combinations\n", SCENARIO_MAX_COUNT);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+long scenario_count(const ScenarioGrid *grid) {
+    long count = 1;
+    for (int a = 0; a < grid->num_axes; a++) {
+        count *= grid->axes[a].num_values;
+    }
+    return count;
+}
+
+// Percentage change of each axis (num_axes entries) in a scenario
+void scenario_deltas(const ScenarioGrid *grid, long scenario, double *deltas) {
+    for (int a = grid->num_axes - 1; a >= 0; a--) {
+        int num_values = grid->axes[a].num_values;
+        deltas[a] = grid->axes[a].values[scenario % num_values];
+        scenario /= num_values;
+    }
+}
+
+static double scaled(double value, double delta) {
+    return value * (1.0 + delta / 100.0);
+}
+
+static int scaled_head_count(int count, double delta) {
+    return (int)floor(count * (1.0 + delta / 100.0) + 0.5);
+}
+
+// Emission of one crop input with that input changed by delta percent,
+// computed exactly as calculate_farm_record_totals() does for the changed
+// farm
+static double crop_term(const CropData *crop, int lever, double delta, const EmissionFactors *f) {
+    switch (lever) {
+        case LEVER_NITROGEN:
+            return scaled(crop->nitrogen_kg_ha, delta) * crop->area * f->nitrogen / 1000.0;
+        case LEVER_PHOSPHORUS:
+            return scaled(crop->phosphorus_kg_ha, delta) * crop->area * f->phosphorus / 1000.0;
+        case LEVER_POTASSIUM:
+            return scaled(crop->potassium_kg_ha, delta) * crop->area * f->potassium / 1000.0;
+        case LEVER_MANURE:
+            return scaled(crop->manure_kg_ha, delta) * crop->area * f->manure / 1000.0;
+        case LEVER_DIESEL:
+            return scaled(crop->diesel_l_ha, delta) * crop->area * f->diesel / 1000.0;
+        case LEVER_IRRIGATION:
+            return scaled(crop->irrigation_mm, delta) * 10.0 * crop->area * f->irrigation / 1000.0;
+        default: {
+            double rate = scaled(crop->pesticide_rate, delta);
+            if (crop->pesticide_id >= 0 && rate > 0) {
+                return rate * crop->area * pesticides[crop->pesticide_id].ef / 1000.0;
+            }
+            return 0.0;
+        }
+    }
+}
+
+// Evaluates every scenario of the grid for one farm into results (one
+// entry per scenario, in scenario order). The per-crop term of each crop
+// lever is computed once per grid value; scenarios are then visited in
+// odometer order and only the categories fed by the axes that changed are
+// re-summed, the others carry over from the previous scenario. Results are
+// identical to calculate_farm_record_totals() on each changed farm.
+// Returns 0 if out of memory.
+int evaluate_scenarios(const FarmRecord *farm, const CropData *rows,
+                       const ScenarioGrid *grid, EmissionTotals *results) {
+    const CropData *farm_crops = rows + farm->crop_offset;
+    const EmissionFactors *factors = &factor_table.sets[farm->factor_set];
+    size_t n = (size_t)farm->num_crops;
+    static const double no_change = 0.0;
+
+    // Every lever has values: its grid axis, or no change
+    const double *values[NUM_LEVERS];
+    int num_values[NUM_LEVERS];
+    for (int l = 0; l < NUM_LEVERS; l++) {
+        values[l] = &no_change;
+        num_values[l] = 1;
+    }
+    for (int a = 0; a < grid->num_axes; a++) {
+        int l = grid->axes[a].lever;
+        values[l] = grid->axes[a].values;
+        num_values[l] = grid->axes[a].num_values;
+    }
+
+    // terms[l][v * n + c]: crop c's emission from lever l at its value v
+    double *terms[NUM_CROP_LEVERS];
+    size_t total_terms = 0;
+    for (int l = 0; l < NUM_CROP_LEVERS; l++) {
+        total_terms += (size_t)num_values[l] * n;
+    }
+    double *storage = malloc((total_terms > 0 ? total_terms : 1) * sizeof(double));
+    if (!storage) {
+        return 0;
+    }
+    double *next = storage;
+    for (int l = 0; l < NUM_CROP_LEVERS; l++) {
+        terms[l] = next;
+        for (int v = 0; v < num_values[l]; v++) {
+            for (size_t c = 0; c < n; c++) {
+                next[(size_t)v * n + c] = crop_term(&farm_crops[c], l, values[l][v], factors);
+            }
+        }
+        next += (size_t)num_values[l] * n;
+    }
+
+    int index[NUM_LEVERS] = {0};
+    double category[NUM_CATEGORIES] = {0};
+    unsigned dirty = (1u << NUM_CATEGORIES) - 1;
+    long count = scenario_count(grid);
+
+    for (long s = 0; s < count; s++) {
+        const double *term[NUM_CROP_LEVERS];
+        for (int l = 0; l < NUM_CROP_LEVERS; l++) {
+            term[l] = terms[l] + (size_t)index[l] * n;
+        }
+
+        if (dirty & (1u << CATEGORY_FERTILIZER)) {
+            double sum = 0.0;
+            for (size_t c = 0; c < n; c++) {
+                sum += term[LEVER_NITROGEN][c] + term[LEVER_PHOSPHORUS][c] + term[LEVER_POTASSIUM][c];
+            }
+            category[CATEGORY_FERTILIZER] = sum;
+        }
+        for (int l = LEVER_MANURE; l < NUM_CROP_LEVERS; l++) {
+            if (dirty & (1u << levers[l].category)) {
+                double sum = 0.0;
+                for (size_t c = 0; c < n; c++) {
+                    sum += term[l][c];
+                }
+                category[levers[l].category] = sum;
+            }
+        }
+        if (dirty & (1u << CATEGORY_LIVESTOCK)) {
+            int cows = scaled_head_count(farm->dairy_cows, values[LEVER_COWS][index[LEVER_COWS]]);
+            int pigs = scaled_head_count(farm->pigs, values[LEVER_PIGS][index[LEVER_PIGS]]);
+            int chickens = scaled_head_count(farm->chickens, values[LEVER_CHICKENS][index[LEVER_CHICKENS]]);
+            category[CATEGORY_LIVESTOCK] = cows * factors->cow / 1000.0 +
+                                           pigs * factors->pig / 1000.0 +
+                                           chickens * factors->chicken / 1000.0;
+        }
+
+        EmissionTotals *totals = &results[s];
+        totals->fertilizer_emissions = category[CATEGORY_FERTILIZER];
+        totals->manure_emissions = category[CATEGORY_MANURE];
+        totals->fuel_emissions = category[CATEGORY_FUEL];
+        totals->irrigation_emissions = category[CATEGORY_IRRIGATION];
+        totals->pesticide_emissions = category[CATEGORY_PESTICIDE];
+        totals->livestock_emissions = category[CATEGORY_LIVESTOCK];
+        totals->total_emissions = totals->fertilizer_emissions +
+                                  totals->manure_emissions +
+                                  totals->fuel_emissions +
+                                  totals->irrigation_emissions +
+                                  totals->pesticide_emissions +
+                                  totals->livestock_emissions;
+        totals->per_hectare_emissions = farm->total_farm_size > 0 ?
+                                        totals->total_emissions / farm->total_farm_size : 0.0;
+
+        // Advance the odometer, marking the categories of the axes it moves
+        dirty = 0;
+        for (int a = grid->num_axes - 1; a >= 0; a--) {
+            int l = grid->axes[a].lever;
+            dirty |= 1u << levers[l].category;
+            if (++index[l] < num_values[l]) {
+                break;
+            }
+            index[l] = 0;
+        }
+    }
+
+    free(storage);
+    return 1;
+}
+
+// Same for an interactively entered farm
+int evaluate_farm_data_scenarios(const FarmData *farm, const ScenarioGrid *grid, EmissionTotals *results) {
+    FarmRecord record;
+
+    farm_record_from_farm_data(farm, &record);
+    return evaluate_scenarios(&record, farm->crops, grid, results);
+}
+
+// One row per scenario: the changes, the category totals and the change
+// of the total against the unchanged farm
+void print_scenario_table(FILE *out, const char *farm_id, const ScenarioGrid *grid,
+                          const EmissionTotals *base, const EmissionTotals *results) {
+    long count = scenario_count(grid);
+    double deltas[NUM_LEVERS];
+
+    fprintf(out, "\nFarm %s: %ld scenarios, base total %.2f t CO2e (changes in %%, emissions in t CO2e)\n",
+            farm_id, count, base->total_emissions);
+    for (int a = 0; a < grid->num_axes; a++) {
+        fprintf(out, "%10.10s ", levers[grid->axes[a].lever].name);
+    }
+    fprintf(out, "%9s %9s %9s %9s %9s %9s %10s %8s\n",
+            "Fert", "Manure", "Fuel", "Irrig", "Pest", "Livestock", "Total", "vs base");
+
+    for (long s = 0; s < count; s++) {
+        const EmissionTotals *r = &results[s];
+        double change = base->total_emissions > 0 ?
+                        (r->total_emissions - base->total_emissions) / base->total_emissions * 100.0 : 0.0;
+
+        scenario_deltas(grid, s, deltas);
+        for (int a = 0; a < grid->num_axes; a++) {
+            fprintf(out, "%10.1f ", deltas[a]);
+        }
+        fprintf(out, "%9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %10.2f %+7.1f%%\n",
+                r->fertilizer_emissions, r->manure_emissions, r->fuel_emissions,
+                r->irrigation_emissions, r->pesticide_emissions, r->livestock_emissions,
+                r->total_emissions, change);
+    }
+}
+
+// Evaluates the grid for every farm of a multi-crop CSV file
+int run_scenarios(const ScenarioOptions *options, long *farms_processed) {
+    MultiCropCsv csv;
+    CropArena arena;
+    FarmRecord farm;
+    int status;
+
+    *farms_processed = 0;
+    if (!is_multi_crop_csv(options->input_path)) {
+        printf("Error: Scenario mode needs a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    }
+    EmissionTotals *results = malloc((size_t)scenario_count(&options->grid) * sizeof(EmissionTotals));
+    if (!results) {
+        printf("Error: Out of memory\n");
+        return 0;
+    }
+    if (!multi_crop_csv_open(&csv, options->input_path)) {
+        free(results);
+        return 0;
+    }
+
+    memset(&arena, 0, sizeof(arena));
+    while (1) {
+        crop_arena_reset(&arena);
+        status = multi_crop_csv_next_farm(&csv, &arena, &farm);
+        if (status <= 0) {
+            break;
+        }
+        if (!validate_farm_record(&farm, arena.rows)) {
+            printf("Error: Validation failed for farm %s\n", csv.farm_id);
+            status = -1;
+            break;
+        }
+        if (!evaluate_scenarios(&farm, arena.rows, &options->grid, results)) {
+            printf("Error: Out of memory\n");
+            status = -1;
+            break;
+        }
+
+        EmissionTotals base;
+        calculate_farm_record_totals(&farm, arena.rows, &base, NULL);
+        print_scenario_table(options->output, csv.farm_id, &options->grid, &base, results);
+        (*farms_processed)++;
+    }
+
+    crop_arena_free(&arena);
+    multi_crop_csv_close(&csv);
+    free(results);
+    return status == 0;
+}
@@ -0,0 +1,61 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdio.h>
+#include "input.h"
+#include "compute.h"
+
+// Values one lever may take in a grid, and the largest grid evaluated
+#define SCENARIO_MAX_VALUES 101
+#define SCENARIO_MAX_COUNT 100000
+
+// Farm inputs a scenario can change, each by a percentage of its base
+// value. Crop levers scale that input on every crop of the farm; livestock
+// levers scale the head count (rounded to whole animals).
+typedef enum {
+    LEVER_NITROGEN = 0,
+    LEVER_PHOSPHORUS,
+    LEVER_POTASSIUM,
+    LEVER_MANURE,
+    LEVER_DIESEL,
+    LEVER_IRRIGATION,
+    LEVER_PESTICIDE,
+    LEVER_COWS,
+    LEVER_PIGS,
+    LEVER_CHICKENS,
+    NUM_LEVERS
+} ScenarioLever;
+
+// The percentage changes tried for one lever
+typedef struct {
+    int lever;                  // ScenarioLever
+    int num_values;
+    double values[SCENARIO_MAX_VALUES];
+} ScenarioAxis;
+
+// A grid of scenarios: every combination of one value per axis. Scenario
+// i picks its values in mixed radix with the last axis varying fastest.
+typedef struct {
+    int num_axes;
+    ScenarioAxis axes[NUM_LEVERS];
+} ScenarioGrid;
+
+typedef struct {
+    const char *input_path;     // multi-crop CSV file
+    FILE *output;
+    ScenarioGrid grid;
+} ScenarioOptions;
+
+// Function declarations
+const char *scenario_lever_name(int lever);
+int parse_scenario_grid(const char *text, ScenarioGrid *grid);
+long scenario_count(const ScenarioGrid *grid);
+void scenario_deltas(const ScenarioGrid *grid, long scenario, double *deltas);
+int evaluate_scenarios(const FarmRecord *farm, const CropData *rows,
+                       const ScenarioGrid *grid, EmissionTotals *results);
+int evaluate_farm_data_scenarios(const FarmData *farm, const ScenarioGrid *grid, EmissionTotals *results);
+void print_scenario_table(FILE *out, const char *farm_id, const ScenarioGrid *grid,
+                          const EmissionTotals *base, const EmissionTotals *results);
+int run_scenarios(const ScenarioOptions *options, long *farms_processed);
+
+#endif
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sensitivity.h"
+
+static const struct {
+    const char *label;
+    const char *unit;           // unit of the input
+} inputs[NUM_SENSITIVITY_INPUTS] = {
+    {"Nitrogen",   "kg N/ha"},
+    {"Phosphorus", "kg P2O5/ha"},
+    {"Potassium",  "kg K2O/ha"},
+    {"Manure",     "kg/ha"},
+    {"Diesel",     "L/ha"},
+    {"Irrigation", "mm"},
+    {"Pesticide",  "kg a.i./ha"},
+    {"Dairy cows", "head"},
+    {"Pigs",       "head"},
+    {"Chickens",   "head"}
+};
+
+// One row of a lever table
+typedef struct {
+    char label[40];
+    const char *unit;
+    double elasticity;
+    double d_input;
+    double d_factor;            // NAN for crop areas, which have no factor
+    double d_per_hectare;
+    int order;                  // tie-break, keeps ranking deterministic
+} LeverRow;
+
+int sensitivity_init(Sensitivity *sens) {
+    memset(sens, 0, sizeof(*sens));
+    sens->crop_area = calloc((size_t)num_crops, sizeof(double));
+    sens->crop_emissions = calloc((size_t)num_crops, sizeof(double));
+    if (!sens->crop_area || !sens->crop_emissions) {
+        sensitivity_free(sens);
+        return 0;
+    }
+    return 1;
+}
+
+void sensitivity_reset(Sensitivity *sens) {
+    double *crop_area = sens->crop_area;
+    double *crop_emissions = sens->crop_emissions;
+
+    memset(sens, 0, sizeof(*sens));
+    memset(crop_area, 0, (size_t)num_crops * sizeof(double));
+    memset(crop_emissions, 0, (size_t)num_crops * sizeof(double));
+    sens->crop_area = crop_area;
+    sens->crop_emissions = crop_emissions;
+}
+
+void sensitivity_free(Sensitivity *sens) {
+    free(sens->crop_area);
+    free(sens->crop_emissions);
+    memset(sens, 0, sizeof(*sens));
+}
+
+// Differentiates one farm in a single pass over its crops. The tangent of
+// each input is the coefficient multiplying it (area x factor for a per
+// hectare rate, the quantity for a factor), accumulated per input.
+void farm_sensitivity(const FarmRecord *farm, const CropData *rows, Sensitivity *sens) {
+    const CropData *farm_crops = rows + farm->crop_offset;
+    const EmissionFactors *f = &factor_table.sets[farm->factor_set];
+    static const int crop_inputs[] = {
+        SENS_NITROGEN, SENS_PHOSPHORUS, SENS_POTASSIUM, SENS_MANURE, SENS_DIESEL, SENS_IRRIGATION
+    };
+
+    sensitivity_reset(sens);
+    sens->farm_size = farm->total_farm_size;
+
+    for (int i = 0; i < farm->num_crops; i++) {
+        const CropData *crop = &farm_crops[i];
+        // Rates in the factor's units (irrigation: m3/ha, 10 per mm entered)
+        const double rate[] = {
+            crop->nitrogen_kg_ha, crop->phosphorus_kg_ha, crop->potassium_kg_ha,
+            crop->manure_kg_ha, crop->diesel_l_ha, crop->irrigation_mm * 10.0
+        };
+        const double factor[] = {f->nitrogen, f->phosphorus, f->potassium, f->manure, f->diesel, f->irrigation};
+        const double units_per_input[] = {1.0, 1.0, 1.0, 1.0, 1.0, 10.0};
+        double per_hectare = 0.0;       // dTotal/dArea of this crop row
+
+        for (int k = 0; k < (int)(sizeof(crop_inputs) / sizeof(crop_inputs[0])); k++) {
+            int input = crop_inputs[k];
+            double quantity = rate[k] * crop->area;
+
+            sens->d_input[input] += crop->area * factor[k] * units_per_input[k] / 1000.0;
+            sens->d_factor[input] += quantity / 1000.0;
+            sens->contribution[input] += quantity * factor[k] / 1000.0;
+            per_hectare += rate[k] * factor[k] / 1000.0;
+        }
+
+        if (crop->pesticide_id >= 0) {
+            double ef = pesticides[crop->pesticide_id].ef;
+            sens->d_input[SENS_PESTICIDE] += crop->area * ef / 1000.0;
+            if (crop->pesticide_rate > 0) {
+                sens->d_factor[SENS_PESTICIDE] += crop->pesticide_rate * crop->area / 1000.0;
+                sens->contribution[SENS_PESTICIDE] += crop->pesticide_rate * crop->area * ef / 1000.0;
+                per_hectare += crop->pesticide_rate * ef / 1000.0;
+            }
+        }
+
+        if (crop->crop_id >= 0 && crop->crop_id < num_crops) {
+            sens->crop_area[crop->crop_id] += crop->area;
+            sens->crop_emissions[crop->crop_id] += crop->area * per_hectare;
+        }
+    }
+
+    const int heads[] = {farm->dairy_cows, farm->pigs, farm->chickens};
+    const double head_factor[] = {f->cow, f->pig, f->chicken};
+    for (int k = 0; k < 3; k++) {
+        sens->d_input[SENS_COWS + k] = head_factor[k] / 1000.0;
+        sens->d_factor[SENS_COWS + k] = heads[k] / 1000.0;
+        sens->contribution[SENS_COWS + k] = heads[k] * head_factor[k] / 1000.0;
+    }
+
+    for (int k = 0; k < NUM_SENSITIVITY_INPUTS; k++) {
+        sens->total_emissions += sens->contribution[k];
+    }
+}
+
+// Adds a farm into a group: derivatives of the group total are the sums of
+// the farms' derivatives, and the group is measured per hectare of all farms
+void sensitivity_add(Sensitivity *sum, const Sensitivity *sens) {
+    sum->total_emissions += sens->total_emissions;
+    sum->farm_size += sens->farm_size;
+    for (int k = 0; k < NUM_SENSITIVITY_INPUTS; k++) {
+        sum->contribution[k] += sens->contribution[k];
+        sum->d_input[k] += sens->d_input[k];
+        sum->d_factor[k] += sens->d_factor[k];
+    }
+    for (int c = 0; c < num_crops; c++) {
+        sum->crop_area[c] += sens->crop_area[c];
+        sum->crop_emissions[c] += sens->crop_emissions[c];
+    }
+}
+
+static int compare_levers(const void *a, const void *b) {
+    const LeverRow *left = a;
+    const LeverRow *right = b;
+    double l = fabs(left->elasticity);
+    double r = fabs(right->elasticity);
+
+    if (l != r) {
+        return l < r ? 1 : -1;
+    }
+    return left->order - right->order;
+}
+
+// Ranked lever table: the elasticity is the % change of the total for a 1%
+// change of the input (or of its factor, which is the same), followed by
+// the derivatives of the total and of the emissions per hectare
+void print_sensitivity_table(FILE *out, const char *title, const Sensitivity *sens, int top) {
+    LeverRow *levers = malloc((size_t)(NUM_SENSITIVITY_INPUTS + num_crops) * sizeof(LeverRow));
+    double total = sens->total_emissions;
+    double size = sens->farm_size;
+    int count = 0;
+
+    if (!levers) {
+        printf("Error: Out of memory\n");
+        return;
+    }
+    for (int k = 0; k < NUM_SENSITIVITY_INPUTS; k++) {
+        LeverRow *row = &levers[count];
+        snprintf(row->label, sizeof(row->label), "%s", inputs[k].label);
+        row->unit = inputs[k].unit;
+        row->elasticity = total > 0 ? sens->contribution[k] / total : 0.0;
+        row->d_input = sens->d_input[k];
+        row->d_factor = sens->d_factor[k];
+        row->d_per_hectare = size > 0 ? sens->d_input[k] / size : 0.0;
+        row->order = count++;
+    }
+    for (int c = 0; c < num_crops; c++) {
+        if (sens->crop_area[c] <= 0) continue;
+        LeverRow *row = &levers[count];
+        snprintf(row->label, sizeof(row->label), "Area %s", crops[c].name);
+        row->unit = "ha";
+        row->elasticity = total > 0 ? sens->crop_emissions[c] / total : 0.0;
+        row->d_input = sens->crop_emissions[c] / sens->crop_area[c];
+        row->d_factor = NAN;
+        row->d_per_hectare = size > 0 ? row->d_input / size : 0.0;
+        row->order = count++;
+    }
+    qsort(levers, (size_t)count, sizeof(LeverRow), compare_levers);
+
+    fprintf(out, "\n%s: %.2f t CO2e, %.3f t CO2e/ha over %.1f ha\n",
+            title, total, size > 0 ? total / size : 0.0, size);
+    fprintf(out, "%4s %-22s %10s %14s %-11s %14s %14s\n",
+            "Rank", "Lever", "Elasticity", "dTotal/dInput", "Input unit", "dTotal/dFactor", "dPerHa/dInput");
+    for (int i = 0; i < count && (top <= 0 || i < top); i++) {
+        const LeverRow *row = &levers[i];
+        fprintf(out, "%4d %-22.22s %10.4f %14.6f %-11s ", i + 1, row->label, row->elasticity, row->d_input, row->unit);
+        if (isnan(row->d_factor)) {
+            fprintf(out, "%14s", "-");
+        } else {
+            fprintf(out, "%14.6f", row->d_factor);
+        }
+        fprintf(out, " %14.8f\n", row->d_per_hectare);
+    }
+    free(levers);
+}
+
+// Differentiates every farm of a multi-crop CSV file and the file as a
+// whole; per-farm tables are printed on request
+int run_sensitivity(const SensitivityOptions *options, long *farms_processed) {
+    MultiCropCsv csv;
+    CropArena arena;
+    FarmRecord farm;
+    Sensitivity sens, all;
+    char title[64];
+    int status;
+
+    *farms_processed = 0;
+    if (!is_multi_crop_csv(options->input_path)) {
+        printf("Error: Sensitivity mode needs a multi-crop CSV file (with a crop_id column)\n");
+        return 0;
+    }
+    if (!sensitivity_init(&sens) || !sensitivity_init(&all)) {
+        sensitivity_free(&sens);
+        printf("Error: Out of memory\n");
+        return 0;
+    }
+    if (!multi_crop_csv_open(&csv, options->input_path)) {
+        sensitivity_free(&sens);
+        sensitivity_free(&all);
+        return 0;
+    }
+
+    memset(&arena, 0, sizeof(arena));
+    while (1) {
+        crop_arena_reset(&arena);
+        status = multi_crop_csv_next_farm(&csv, &arena, &farm);
+        if (status <= 0) {
+            break;
+        }
+        if (!validate_farm_record(&farm, arena.rows)) {
+            printf("Error: Validation failed for farm %s\n", csv.farm_id);
+            status = -1;
+            break;
+        }
+
+        farm_sensitivity(&farm, arena.rows, &sens);
+        sensitivity_add(&all, &sens);
+        if (options->per_farm) {
+            // Farm IDs may be longer than the title buffer
+            char *farm_title = malloc(csv.farm_id_length + sizeof("Farm "));
+            if (!farm_title) {
+                printf("Error: Out of memory\n");
+                status = -1;
+                break;
+            }
+            sprintf(farm_title, "Farm %s", csv.farm_id);
+            print_sensitivity_table(options->output, farm_title, &sens, options->top);
+            free(farm_title);
+        }
+        (*farms_processed)++;
+    }
+
+    if (status == 0 && *farms_processed > 0) {
+        snprintf(title, sizeof(title), "All %ld farms", *farms_processed);
+        print_sensitivity_table(options->output, title, &all, options->top);
+    }
+
+    crop_arena_free(&arena);
+    multi_crop_csv_close(&csv);
+    sensitivity_free(&sens);
+    sensitivity_free(&all);
+    return status == 0;
+}
@@ -0,0 +1,57 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include <stdio.h>
+#include "input.h"
+#include "compute.h"
+
+// Inputs the sensitivity report differentiates against. Crop inputs are
+// changed uniformly on every crop of the farm (per hectare); livestock
+// inputs are head counts. Each input is paired with the emission factor
+// that multiplies it.
+typedef enum {
+    SENS_NITROGEN = 0,
+    SENS_PHOSPHORUS,
+    SENS_POTASSIUM,
+    SENS_MANURE,
+    SENS_DIESEL,
+    SENS_IRRIGATION,
+    SENS_PESTICIDE,
+    SENS_COWS,
+    SENS_PIGS,
+    SENS_CHICKENS,
+    NUM_SENSITIVITY_INPUTS
+} SensitivityInput;
+
+// Exact first derivatives of a farm's (or a group of farms') total
+// emissions. Every category is linear in its input and in its factor, so
+// dTotal/dInput and dTotal/dFactor are sums of coefficients, and the
+// elasticity of the total to an input or its factor is that input's
+// share of the total.
+typedef struct {
+    double total_emissions;                     // t CO2e
+    double farm_size;                           // ha
+    double contribution[NUM_SENSITIVITY_INPUTS];  // t CO2e from the input
+    double d_input[NUM_SENSITIVITY_INPUTS];       // t CO2e per unit of input
+    double d_factor[NUM_SENSITIVITY_INPUTS];      // t CO2e per kg CO2e/unit of factor
+    double *crop_area;                          // by crop type (num_crops entries), ha
+    double *crop_emissions;                     // input-driven t CO2e by crop type
+} Sensitivity;
+
+typedef struct {
+    const char *input_path;     // multi-crop CSV file
+    FILE *output;
+    int top;                    // levers listed per table (0 = all)
+    int per_farm;               // print a table for every farm, not just the aggregate
+} SensitivityOptions;
+
+// Function declarations
+int sensitivity_init(Sensitivity *sens);
+void sensitivity_reset(Sensitivity *sens);
+void sensitivity_free(Sensitivity *sens);
+void farm_sensitivity(const FarmRecord *farm, const CropData *rows, Sensitivity *sens);
+void sensitivity_add(Sensitivity *sum, const Sensitivity *sens);
+void print_sensitivity_table(FILE *out, const char *title, const Sensitivity *sens, int top);
+int run_sensitivity(const SensitivityOptions *options, long *farms_processed);
+
+#endif
@@ -15,6 +15,8 @@
 #include "input.h"
 #include "compute.h"
 #include "report.h"
+#include "batch.h"
+#include "incremental.h"
 
 // Set this to 1 to use UTF-8 symbols, 0 for ASCII
 // Windows users: run 'chcp 65001' before execution for UTF-8 support
@@ -230,6 +232,89 @@ int run_interactive_form(LegacyFarmData *farm) {
     return 1;
 }
 
+// Applies one "CROP FIELD VALUE" or "FIELD VALUE" edit. Crop, crop and
+// pesticide IDs are 1-based as in the input prompts (pesticide 0 = none).
+// Returns the crop index edited, -1 for a farm field, or -2 if invalid,
+// including values outside the validator's limits.
+static int apply_simple_edit(IncrementalFarm *live, const char *line) {
+    char first[32], second[32];
+    double value;
+    int crop;
+
+    if (sscanf(line, "%d %31s %lf", &crop, second, &value) == 3) {
+        int field = find_crop_field(second);
+        crop--;
+        if (field < 0 || crop < 0 || crop >= live->farm.num_crops || value < 0) {
+            return -2;
+        }
+        if (field == CROP_FIELD_CROP_ID) {
+            if (value < 1 || value > num_crops) return -2;
+            value -= 1;
+        } else if (field == CROP_FIELD_PESTICIDE_ID) {
+            if (value > num_pesticides) return -2;
+            value -= 1;
+        }
+        return incremental_set_crop_field(live, crop, field, value) ? crop : -2;
+    }
+    if (sscanf(line, "%31s %lf", first, &value) == 2) {
+        int field = find_farm_field(first);
+        if (field < 0 || value < 0 || (field == FARM_FIELD_SIZE && value == 0)) {
+            return -2;
+        }
+        return incremental_set_farm_field(live, field, value) ? -1 : -2;
+    }
+    return -2;
+}
+
+// Lets the user change single values of an entered farm and shows the new
+// totals after each change. Only the edited crop is re-evaluated, so edits
+// stay instant on farms with many crops. Returns 1 if anything changed.
+static int edit_farm_live(FarmData *farm, EmissionResults *results) {
+    FarmRecord record;
+    IncrementalFarm live;
+    char line[128];
+    int changed = 0;
+
+    farm_record_from_farm_data(farm, &record);
+    if (!incremental_farm_init(&live, &record, farm->crops)) {
+        printf("Error: Out of memory\n");
+        return 0;
+    }
+
+    printf("\nLive editing. Enter 'CROP# FIELD VALUE' (fields: area, nitrogen, phosphorus,\n");
+    printf("potassium, manure, diesel, irrigation, crop, pesticide, rate) or 'FIELD VALUE'\n");
+    printf("for size, cows, pigs, chickens. Enter 'done' to finish.\n");
+    while (1) {
+        printf("> ");
+        if (!fgets(line, sizeof(line), stdin) || strncmp(line, "done", 4) == 0) {
+            break;
+        }
+        int edited = apply_simple_edit(&live, line);
+        if (edited == -2) {
+            printf("Invalid edit. Example: '2 nitrogen 140' or 'cows 25'\n");
+            continue;
+        }
+
+        const EmissionTotals *totals = incremental_farm_totals(&live);
+        printf("  Total: %.2f tCO2e (%.2f tCO2e/ha)", totals->total_emissions, totals->per_hectare_emissions);
+        if (edited >= 0) {
+            CropEmissionResults crop;
+            incremental_crop_result(&live, edited, &crop);
+            printf("  Crop %d (%s): %.2f tCO2e", edited + 1, crops[crop.crop_id].name, crop.total_emissions);
+        }
+        printf("\n");
+        changed = 1;
+    }
+
+    farm->total_farm_size = live.farm.total_farm_size;
+    farm->dairy_cows = live.farm.dairy_cows;
+    farm->pigs = live.farm.pigs;
+    farm->chickens = live.farm.chickens;
+    incremental_farm_results(&live, results, results->crop_results);
+    incremental_farm_free(&live);
+    return changed;
+}
+
 // Helper function to print a simple progress bar
 void print_simple_progress_bar(double value, double max_value, int width, const char* color) {
     if (max_value <= 0) max_value = 1; // Avoid division by zero
@@ -425,6 +510,15 @@ int run_simple_ui(void) {
                                 results = calculate_emissions(&farm);
                                 print_report(&farm, &results);
                                 
+                                printf("\nEdit values and see the effect live? (y/n): ");
+                                char edit_choice;
+                                if (scanf(" %c", &edit_choice) == 1 && (edit_choice == 'y' || edit_choice == 'Y')) {
+                                    while (getchar() != '\n' && !feof(stdin));
+                                    if (edit_farm_live(&farm, &results)) {
+                                        print_report(&farm, &results);
+                                    }
+                                }
+                                
                                 printf("\nSave report to file? (y/n): ");
                                 char save_choice;
                                 if (scanf(" %c", &save_choice) == 1 && (save_choice == 'y' || save_choice == 'Y')) {
@@ -460,9 +554,32 @@ int run_simple_ui(void) {
                     } while (1);
                     break;
                     
-                case 2: // CSV file - not supported in multi-crop mode yet
-                    printf("CSV input not yet supported for multi-crop mode.\n");
-                    printf("Please use interactive input or legacy mode.\n");
+                case 2: // Multi-crop CSV file, reported farm by farm
+                    clear_screen();
+                    printf("Enter multi-crop CSV filename: ");
+                    if (fgets(filename, sizeof(filename), stdin)) {
+                        // Remove newline
+                        filename[strcspn(filename, "\n")] = 0;
+
+                        FarmReport last;
+                        int farms = report_multi_crop_file(filename, &last);
+                        if (farms < 0) {
+                            printf("Failed to load CSV file or invalid data.\n");
+                        } else if (farms == 1) {
+                            printf("\nSave report to file? (y/n): ");
+                            char save_choice;
+                            if (scanf(" %c", &save_choice) == 1 && (save_choice == 'y' || save_choice == 'Y')) {
+                                save_farm_record_report_to_file(&last.farm, &last.results, last.crop_results, "report.txt");
+                            }
+                            // Clear input buffer
+                            while (getchar() != '\n' && !feof(stdin));
+                        } else {
+                            printf("\nReported %d farms.\n", farms);
+                        }
+                        farm_report_free(&last);
+                    } else {
+                        printf("Invalid filename.\n");
+                    }
                     pause_for_input();
                     break;
                     
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include "summation.h"
+
+static const char *const sum_mode_names[NUM_SUM_MODES] = {"naive", "neumaier", "pairwise"};
+
+int parse_sum_mode(const char *name, SumMode *mode) {
+    for (int m = 0; m < NUM_SUM_MODES; m++) {
+        if (strcmp(name, sum_mode_names[m]) == 0) {
+            *mode = (SumMode)m;
+            return 1;
+        }
+    }
+    printf("Error: Unknown summation mode '%s' (use naive, neumaier or pairwise)\n", name);
+    return 0;
+}
+
+const char *sum_mode_name(SumMode mode) {
+    return sum_mode_names[mode];
+}
+
+double sum_naive(const double *x, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+// Neumaier's variant of Kahan summation: the low-order bits lost by each
+// addition are collected whichever operand is larger
+double sum_neumaier(const double *x, size_t n) {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    for (size_t i = 0; i < n; i++) {
+        double t = sum + x[i];
+        if (fabs(sum) >= fabs(x[i])) {
+            compensation += (sum - t) + x[i];
+        } else {
+            compensation += (x[i] - t) + sum;
+        }
+        sum = t;
+    }
+    return sum + compensation;
+}
+
+// Balanced tree over blocks of PAIRWISE_BLOCK terms. The split points
+// depend only on n, so the result is fixed for a given sequence.
+double sum_pairwise(const double *x, size_t n) {
+    if (n <= PAIRWISE_BLOCK) {
+        return sum_naive(x, n);
+    }
+    size_t half = n / 2;
+    return sum_pairwise(x, half) + sum_pairwise(x + half, n - half);
+}
+
+double sum_values(SumMode mode, const double *x, size_t n) {
+    switch (mode) {
+        case SUM_NEUMAIER: return sum_neumaier(x, n);
+        case SUM_PAIRWISE: return sum_pairwise(x, n);
+        default:           return sum_naive(x, n);
+    }
+}
+
+void sum_accumulator_add(SumMode mode, SumAccumulator *acc, double x) {
+    if (mode == SUM_NEUMAIER) {
+        double t = acc->sum + x;
+        if (fabs(acc->sum) >= fabs(x)) {
+            acc->compensation += (acc->sum - t) + x;
+        } else {
+            acc->compensation += (x - t) + acc->sum;
+        }
+        acc->sum = t;
+    } else if (mode == SUM_PAIRWISE) {
+        // Binary increment: equal-sized partial sums are combined as they meet
+        int k = 0;
+        while (k < PAIRWISE_LEVELS - 1 && (acc->count >> k) & 1u) {
+            x = acc->level[k] + x;
+            k++;
+        }
+        acc->level[k] = x;
+        acc->count++;
+    } else {
+        acc->sum += x;
+    }
+}
+
+double sum_accumulator_value(SumMode mode, const SumAccumulator *acc) {
+    if (mode == SUM_NEUMAIER) {
+        return acc->sum + acc->compensation;
+    }
+    if (mode == SUM_PAIRWISE) {
+        double sum = 0.0;
+        for (int k = 0; k < PAIRWISE_LEVELS; k++) {
+            if ((acc->count >> k) & 1u) {
+                sum += acc->level[k];
+            }
+        }
+        return sum;
+    }
+    return acc->sum;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform01(uint64_t *state) {
+    return (double)(splitmix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Reference total in extended precision where the platform has it
+static double reference_sum(const double *x, size_t n) {
+    long double sum = 0.0L;
+    long double compensation = 0.0L;
+
+    for (size_t i = 0; i < n; i++) {
+        long double t = sum + x[i];
+        if (fabsl(sum) >= fabsl((long double)x[i])) {
+            compensation += (sum - t) + x[i];
+        } else {
+            compensation += (x[i] - t) + sum;
+        }
+        sum = t;
+    }
+    return (double)(sum + compensation);
+}
+
+static double elapsed_seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Times each mode over num_terms crop-result-like terms (positive, spread
+// over six orders of magnitude) and reports its error against an
+// extended-precision reference and how far its result moves when the same
+// terms are reversed or shuffled. Returns 0 if out of memory.
+int run_sum_benchmark(FILE *out, size_t num_terms) {
+    double *terms = malloc(num_terms * sizeof(double));
+    double *reordered = malloc(num_terms * sizeof(double));
+    uint64_t state = 2024;
+
+    if (!terms || !reordered) {
+        free(terms);
+        free(reordered);
+        printf("Error: Out of memory\n");
+        return 0;
+    }
+    for (size_t i = 0; i < num_terms; i++) {
+        terms[i] = pow(10.0, 6.0 * uniform01(&state) - 3.0);
+    }
+    double reference = reference_sum(terms, num_terms);
+    int repeats = num_terms < 10000000 ? (int)(10000000 / (num_terms > 0 ? num_terms : 1)) : 1;
+
+    fprintf(out, "Summation benchmark: %lu terms, reference total %.17g\n", (unsigned long)num_terms, reference);
+    fprintf(out, "%-9s %10s %10s %14s %14s %14s\n",
+            "Mode", "ns/term", "Mterms/s", "Rel. error", "Order spread", "Stream ns/term");
+    for (int m = 0; m < NUM_SUM_MODES; m++) {
+        SumMode mode = (SumMode)m;
+        volatile double sink = 0.0;
+        double sum = 0.0;
+
+        clock_t start = clock();
+        for (int r = 0; r < repeats; r++) {
+            sum = sum_values(mode, terms, num_terms);
+            sink += sum;
+        }
+        double seconds = elapsed_seconds(start) / repeats;
+
+        SumAccumulator acc;
+        start = clock();
+        for (int r = 0; r < repeats; r++) {
+            memset(&acc, 0, sizeof(acc));
+            for (size_t i = 0; i < num_terms; i++) {
+                sum_accumulator_add(mode, &acc, terms[i]);
+            }
+            sink += sum_accumulator_value(mode, &acc);
+        }
+        double stream_seconds = elapsed_seconds(start) / repeats;
+
+        // Same terms reversed, then shuffled with a fixed seed
+        double low = sum, high = sum;
+        for (size_t i = 0; i < num_terms; i++) {
+            reordered[i] = terms[num_terms - 1 - i];
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            double other = sum_values(mode, reordered, num_terms);
+            if (other < low) low = other;
+            if (other > high) high = other;
+
+            uint64_t shuffle = 7;
+            for (size_t i = num_terms; i > 1; i--) {
+                size_t j = (size_t)(splitmix64(&shuffle) % i);
+                double t = reordered[i - 1];
+                reordered[i - 1] = reordered[j];
+                reordered[j] = t;
+            }
+        }
+        (void)sink;
+
+        double scale = reference != 0.0 ? fabs(reference) : 1.0;
+        double ns = num_terms > 0 ? seconds * 1e9 / (double)num_terms : 0.0;
+        fprintf(out, "%-9s %10.3f %10.1f %14.3e %14.3e %14.3f\n",
+                sum_mode_name(mode), ns, seconds > 0 ? (double)num_terms / seconds / 1e6 : 0.0,
+                fabs(sum - reference) / scale, (high - low) / scale,
+                num_terms > 0 ? stream_seconds * 1e9 / (double)num_terms : 0.0);
+    }
+
+    free(terms);
+    free(reordered);
+    return 1;
+}
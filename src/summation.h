@@ -0,0 +1,46 @@
+#ifndef SUMMATION_H
+#define SUMMATION_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// How large aggregates are summed
+typedef enum {
+    SUM_NAIVE = 0,              // running +=; error grows with the number of terms
+    SUM_NEUMAIER,               // compensated; error independent of the number of terms
+    SUM_PAIRWISE,               // balanced tree; error grows with its log
+    NUM_SUM_MODES
+} SumMode;
+
+// Terms added directly at the leaves of a pairwise tree
+#define PAIRWISE_BLOCK 16
+
+// Levels of a streaming pairwise sum; level k holds the sum of 2^k terms
+#define PAIRWISE_LEVELS 48
+
+// Streaming sum of terms pushed one at a time in a fixed order. In
+// pairwise mode the terms form a binary counter of partial sums, so the
+// result is the balanced-tree sum of the terms in push order whatever the
+// chunking of the work that produced them.
+typedef struct {
+    double sum;
+    double compensation;                // Neumaier
+    double level[PAIRWISE_LEVELS];      // pairwise
+    unsigned long long count;           // pairwise terms pushed
+} SumAccumulator;
+
+// Default number of terms of --bench-sum
+#define SUM_BENCH_DEFAULT_TERMS 10000000
+
+// Function declarations
+int parse_sum_mode(const char *name, SumMode *mode);
+const char *sum_mode_name(SumMode mode);
+double sum_naive(const double *x, size_t n);
+double sum_neumaier(const double *x, size_t n);
+double sum_pairwise(const double *x, size_t n);
+double sum_values(SumMode mode, const double *x, size_t n);
+void sum_accumulator_add(SumMode mode, SumAccumulator *acc, double x);
+double sum_accumulator_value(SumMode mode, const SumAccumulator *acc);
+int run_sum_benchmark(FILE *out, size_t num_terms);
+
+#endif
@@ -0,0 +1,295 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threadpool.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+typedef struct {
+    TaskFunction function;
+    void *arg;
+} Task;
+
+#ifndef _WIN32
+
+// Per-worker double-ended queue. The owner pushes and pops at the bottom
+// (most recently submitted first, which keeps its data warm in cache);
+// idle workers steal from the top (oldest task first).
+typedef struct {
+    pthread_mutex_t lock;
+    Task *tasks;
+    size_t capacity;
+    size_t top;                 // index of the oldest task
+    size_t count;
+} WorkDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+    pthread_t thread;
+} Worker;
+
+struct ThreadPool {
+    int num_threads;
+    Worker *workers;
+    WorkDeque *deques;
+    int next_deque;             // round-robin target for submissions
+
+    pthread_mutex_t lock;       // protects the counters below
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    long queued;                // submitted but not yet taken
+    long unfinished;            // submitted but not yet completed
+    int shutdown;
+};
+
+static int deque_push(WorkDeque *deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        Task *tasks = malloc(capacity * sizeof(Task));
+        if (!tasks) {
+            pthread_mutex_unlock(&deque->lock);
+            return 0;
+        }
+        for (size_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+        deque->top = 0;
+    }
+    deque->tasks[(deque->top + deque->count) % deque->capacity] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+static int deque_pop_bottom(WorkDeque *deque, Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        *task = deque->tasks[(deque->top + deque->count) % deque->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal_top(WorkDeque *deque, Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->count--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Own deque first, then steal from the others starting at a neighbour
+static int find_task(ThreadPool *pool, int index, Task *task) {
+    if (deque_pop_bottom(&pool->deques[index], task)) {
+        return 1;
+    }
+    for (int i = 1; i < pool->num_threads; i++) {
+        int victim = (index + i) % pool->num_threads;
+        if (deque_steal_top(&pool->deques[victim], task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    ThreadPool *pool = worker->pool;
+
+    while (1) {
+        // Claim one queued task before searching. Tasks are pushed before
+        // queued is raised, so a claim guarantees a task is in some deque.
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        if (pool->queued == 0 && pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+
+        Task task;
+        while (!find_task(pool, worker->index, &task)) {
+            // The scan raced with another claimant; every outstanding claim
+            // still has a task in some deque, so scanning again succeeds
+        }
+
+        task.function(task.arg, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->unfinished--;
+        if (pool->unfinished == 0) {
+            pthread_cond_broadcast(&pool->all_done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(int num_threads) {
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->num_threads = num_threads;
+    pool->workers = calloc((size_t)num_threads, sizeof(Worker));
+    pool->deques = calloc((size_t)num_threads, sizeof(WorkDeque));
+    if (!pool->workers || !pool->deques) {
+        free(pool->workers);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            // Run with the workers that did start
+            pool->num_threads = i;
+            break;
+        }
+    }
+
+    if (pool->num_threads == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+// Queues a task. Returns 0 if the queue cannot grow; the task is not run
+// (running it here as worker 0 would share that worker's state).
+int thread_pool_submit(ThreadPool *pool, TaskFunction function, void *arg) {
+    Task task = {function, arg};
+    int target = pool->next_deque;
+    pool->next_deque = (pool->next_deque + 1) % pool->num_threads;
+
+    if (!deque_push(&pool->deques[target], task)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pool->unfinished++;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+// Blocks until every submitted task has completed
+void thread_pool_wait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->unfinished > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool->num_threads;
+}
+
+int available_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+#else
+
+// Windows builds have no pthreads dependency: tasks run on the caller's
+// thread as they are submitted, which keeps results identical.
+struct ThreadPool {
+    int num_threads;
+};
+
+ThreadPool *thread_pool_create(int num_threads) {
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    (void)num_threads;
+    if (pool) pool->num_threads = 1;
+    return pool;
+}
+
+int thread_pool_submit(ThreadPool *pool, TaskFunction function, void *arg) {
+    (void)pool;
+    function(arg, 0);
+    return 1;
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+    (void)pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool->num_threads;
+}
+
+int available_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// Upper bound on worker threads accepted from the command line
+#define MAX_THREADS 256
+
+// Task run by a pool worker; worker is the index of the executing thread
+typedef void (*TaskFunction)(void *arg, int worker);
+
+typedef struct ThreadPool ThreadPool;
+
+// Function declarations
+ThreadPool *thread_pool_create(int num_threads);
+int thread_pool_submit(ThreadPool *pool, TaskFunction function, void *arg);
+void thread_pool_wait(ThreadPool *pool);
+void thread_pool_destroy(ThreadPool *pool);
+int thread_pool_size(const ThreadPool *pool);
+int available_cpu_count(void);
+
+#endif
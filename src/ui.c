@@ -16,6 +16,8 @@
 #include "input.h"
 #include "compute.h"
 #include "report.h"
+#include "incremental.h"
+#include "validator.h"
 
 // Console dimensions
 static int console_width = 80;
@@ -305,9 +307,9 @@ int run_main_menu(UIState *state)
             switch (state->current_menu)
             {
             case MENU_INTERACTIVE:
+                // The form leaves the results of the farm it edited
                 if (run_interactive_input(state))
                 {
-                    state->results = calculate_legacy_emissions(&state->legacy_farm_data);
                     state->show_results = 1;
                     display_results(state);
                 }
@@ -356,10 +358,80 @@ int run_main_menu(UIState *state)
         }
     }
 }
+// Parses the form's text fields into a farm
+static void parse_form_values(char values[][MAX_INPUT_LEN], LegacyFarmData *farm)
+{
+    memset(farm, 0, sizeof(*farm));
+    farm->farm_size = atof(values[0]);
+    strncpy(farm->crop_type, values[1], sizeof(farm->crop_type) - 1);
+    farm->nitrogen_kg_ha = atof(values[2]);
+    farm->phosphorus_kg_ha = atof(values[3]);
+    farm->potassium_kg_ha = atof(values[4]);
+    farm->manure_kg_ha = atof(values[5]);
+    farm->diesel_l_ha = atof(values[6]);
+    farm->irrigation_mm = atof(values[7]);
+    farm->dairy_cows = atoi(values[8]);
+    farm->pigs = atoi(values[9]);
+    farm->chickens = atoi(values[10]);
+}
+
+// Starts the live estimate from the whole form; its crop row lives in farm
+static int start_live_estimate(char values[][MAX_INPUT_LEN], FarmData *farm, IncrementalFarm *live)
+{
+    LegacyFarmData form_farm;
+    FarmRecord record;
+
+    parse_form_values(values, &form_farm);
+    convert_legacy_to_multi_crop(&form_farm, farm);
+    farm_record_from_farm_data(farm, &record);
+    return incremental_farm_init(live, &record, farm->crops);
+}
+
+// Applies one edited form field to the live estimate. Form fields 2-7 are
+// CROP_FIELD_NITROGEN to CROP_FIELD_IRRIGATION in the same order. Returns
+// 0 if the evaluator refused the value (out of its limits, or the farm
+// around it is not valid yet).
+static int apply_live_edit(IncrementalFarm *live, int field, const char *value)
+{
+    switch (field)
+    {
+    case 0:
+    {
+        // A legacy farm is one crop covering the whole farm. The crop may
+        // not outgrow the farm, so it shrinks first and grows last.
+        double size = atof(value);
+        if (size < live->farm.total_farm_size)
+        {
+            return incremental_set_crop_field(live, 0, CROP_FIELD_AREA, size) &&
+                   incremental_set_farm_field(live, FARM_FIELD_SIZE, size);
+        }
+        return incremental_set_farm_field(live, FARM_FIELD_SIZE, size) &&
+               incremental_set_crop_field(live, 0, CROP_FIELD_AREA, size);
+    }
+    case 1:
+    {
+        int crop_id = find_crop_by_name(value);
+        return incremental_set_crop_field(live, 0, CROP_FIELD_CROP_ID, crop_id >= 0 ? crop_id : 0);
+    }
+    case 8:
+        return incremental_set_farm_field(live, FARM_FIELD_COWS, atoi(value));
+    case 9:
+        return incremental_set_farm_field(live, FARM_FIELD_PIGS, atoi(value));
+    case 10:
+        return incremental_set_farm_field(live, FARM_FIELD_CHICKENS, atoi(value));
+    default:
+        return incremental_set_crop_field(live, 0, CROP_FIELD_NITROGEN + field - 2, atof(value));
+    }
+}
+
 int run_interactive_input(UIState *state)
 {
     int ch;
     char temp_values[NUM_FIELDS][MAX_INPUT_LEN];
+    LegacyFarmData form_farm;
+    FarmData live_farm = {0};
+    IncrementalFarm live;
+    char problems[128];
 
     // Initialize with default values
     snprintf(temp_values[0], MAX_INPUT_LEN, "%.1f", state->legacy_farm_data.farm_size);
@@ -376,6 +448,14 @@ int run_interactive_input(UIState *state)
 
     state->current_field = 0;
 
+    // Live estimate shown under the form; an edit re-evaluates only what
+    // the field feeds instead of the whole farm
+    if (!start_live_estimate(temp_values, &live_farm, &live))
+    {
+        show_message("Out of memory", 1);
+        return 0;
+    }
+
     while (1)
     {
         clear_screen();
@@ -409,6 +489,21 @@ int run_interactive_input(UIState *state)
             }
         }
 
+        const EmissionTotals *estimate = incremental_farm_totals(&live);
+        set_cursor_position(form_y + 3 + NUM_FIELDS, form_x + 2);
+        printf(" %-23s: %.2f tCO2e (%.2f tCO2e/ha)", "Live estimate",
+               estimate->total_emissions, estimate->per_hectare_emissions);
+
+        // Name the fields F1 would reject, so a refused value is not lost
+        // silently behind an estimate that ignores it
+        parse_form_values(temp_values, &form_farm);
+        format_validation_errors(legacy_input_errors(&form_farm), problems, sizeof(problems));
+        if (problems[0] != '\0')
+        {
+            set_cursor_position(form_y + 4 + NUM_FIELDS, form_x + 2);
+            printf(" %-23s: %s", "Check", problems);
+        }
+
         // Instructions
         set_cursor_position(console_height - 4, 2);
         printf("UP/DOWN: Navigate  ENTER: Edit field  F1: Calculate  ESC: Back to menu");
@@ -433,31 +528,34 @@ int run_interactive_input(UIState *state)
             snprintf(prompt, sizeof(prompt), "Enter %s: ", field_labels[state->current_field]);
             if (get_string_input(console_height / 2, 10, 40, temp_values[state->current_field], prompt))
             {
-                // Value updated in temp_values
+                // A refused value still belongs in the estimate of the
+                // form as shown: start again from every field
+                if (!apply_live_edit(&live, state->current_field, temp_values[state->current_field]))
+                {
+                    incremental_farm_free(&live);
+                    if (!start_live_estimate(temp_values, &live_farm, &live))
+                    {
+                        show_message("Out of memory", 1);
+                        return 0;
+                    }
+                }
             }
         }
         break;
         case KEY_F1:
             // Validate and save all values
             {
-                LegacyFarmData temp_farm = {0};
-
-                // Parse values
-                temp_farm.farm_size = atof(temp_values[0]);
-                strncpy(temp_farm.crop_type, temp_values[1], sizeof(temp_farm.crop_type) - 1);
-                temp_farm.nitrogen_kg_ha = atof(temp_values[2]);
-                temp_farm.phosphorus_kg_ha = atof(temp_values[3]);
-                temp_farm.potassium_kg_ha = atof(temp_values[4]);
-                temp_farm.manure_kg_ha = atof(temp_values[5]);
-                temp_farm.diesel_l_ha = atof(temp_values[6]);
-                temp_farm.irrigation_mm = atof(temp_values[7]);
-                temp_farm.dairy_cows = atoi(temp_values[8]);
-                temp_farm.pigs = atoi(temp_values[9]);
-                temp_farm.chickens = atoi(temp_values[10]);
+                LegacyFarmData temp_farm;
+
+                parse_form_values(temp_values, &temp_farm);
 
                 if (validate_legacy_input(&temp_farm))
                 {
+                    // The live estimate is only a preview; the results
+                    // come from the farm that passed validation
                     state->legacy_farm_data = temp_farm;
+                    state->results = calculate_legacy_emissions(&temp_farm);
+                    incremental_farm_free(&live);
                     return 1;
                 }
                 else
@@ -467,6 +565,7 @@ int run_interactive_input(UIState *state)
             }
             break;
         case KEY_ESC:
+            incremental_farm_free(&live);
             return 0;
         }
     }
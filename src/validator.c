@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include "validator.h"
+#include "compute_simd.h"
+
+#ifdef CARBON_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+// Inclusive limits of the checks, as in validate_farm_record(); shared by
+// the column checks and the single-farm checks of live edits
+#define MAX_FARM_SIZE       100000.0
+#define MAX_CROP_AREA        50000.0
+#define MAX_NITROGEN          1000.0
+#define MAX_PHOSPHORUS         500.0
+#define MAX_POTASSIUM          500.0
+#define MAX_MANURE           50000.0
+#define MAX_DIESEL            1000.0
+#define MAX_IRRIGATION        2000.0
+#define MAX_PESTICIDE_RATE     100.0
+#define MAX_COWS             10000
+#define MAX_PIGS             50000
+#define MAX_CHICKENS       1000000
+#define CROP_AREA_TOLERANCE    1.01    // crops may exceed the farm size by 1%
+
+static const char *const error_names[NUM_VALIDATION_ERRORS] = {
+    "crop", "area", "nitrogen", "phosphorus", "potassium", "manure", "diesel",
+    "irrigation", "pesticide", "pesticide_rate", "farm_size", "no_crops",
+    "region_year", "crop_area", "cows", "pigs", "chickens"
+};
+
+// Sets bit in errors[i] unless lo <= x[i] <= hi (NaN fails). The mask is
+// built arithmetically, so good and bad rows take the same path.
+static void range_check_scalar(const double *x, size_t n, double lo, double hi, uint32_t bit, uint32_t *errors) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t ok = (uint32_t)((x[i] >= lo) & (x[i] <= hi));
+        errors[i] |= bit & (ok - 1u);
+    }
+}
+
+#ifdef CARBON_X86_SIMD
+
+// SSE2: two rows per iteration; the 64-bit lane masks are narrowed to the
+// 32-bit error words with a shuffle
+__attribute__((target("sse2")))
+static void range_check_sse2(const double *x, size_t n, double lo, double hi, uint32_t bit, uint32_t *errors) {
+    const __m128d low = _mm_set1_pd(lo);
+    const __m128d high = _mm_set1_pd(hi);
+    const __m128i bits = _mm_set1_epi32((int)bit);
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d ok = _mm_and_pd(_mm_cmpge_pd(v, low), _mm_cmple_pd(v, high));
+        __m128i ok32 = _mm_shuffle_epi32(_mm_castpd_si128(ok), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128i word = _mm_loadl_epi64((const __m128i *)(errors + i));
+        _mm_storel_epi64((__m128i *)(errors + i), _mm_or_si128(word, _mm_andnot_si128(ok32, bits)));
+    }
+    range_check_scalar(x + i, n - i, lo, hi, bit, errors + i);
+}
+
+// AVX2: four rows per iteration
+__attribute__((target("avx2")))
+static void range_check_avx2(const double *x, size_t n, double lo, double hi, uint32_t bit, uint32_t *errors) {
+    const __m256d low = _mm256_set1_pd(lo);
+    const __m256d high = _mm256_set1_pd(hi);
+    const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m128i bits = _mm_set1_epi32((int)bit);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(v, low, _CMP_GE_OQ), _mm256_cmp_pd(v, high, _CMP_LE_OQ));
+        __m128i ok32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(ok), narrow));
+        __m128i word = _mm_loadu_si128((const __m128i *)(errors + i));
+        _mm_storeu_si128((__m128i *)(errors + i), _mm_or_si128(word, _mm_andnot_si128(ok32, bits)));
+    }
+    range_check_scalar(x + i, n - i, lo, hi, bit, errors + i);
+}
+
+#endif
+
+// Picks the widest variant the emission kernel uses (CARBON_KERNEL applies)
+static void range_check(const double *x, size_t n, double lo, double hi, uint32_t bit, uint32_t *errors) {
+#ifdef CARBON_X86_SIMD
+    KernelVariant variant = get_kernel_variant();
+    if (variant >= KERNEL_AVX2) {
+        range_check_avx2(x, n, lo, hi, bit, errors);
+        return;
+    }
+    if (variant == KERNEL_SSE2) {
+        range_check_sse2(x, n, lo, hi, bit, errors);
+        return;
+    }
+#endif
+    range_check_scalar(x, n, lo, hi, bit, errors);
+}
+
+// Range-checks every crop row column by column, with the limits of
+// validate_farm_record(), and leaves each row's error bits in errors
+void validate_crop_columns(const CropColumns *rows, const int *crop_id, size_t num_rows, uint32_t *errors) {
+    const struct {
+        const double *values;
+        double lo;
+        double hi;
+        uint32_t bit;
+    } checks[] = {
+        {rows->area,             0.0, MAX_CROP_AREA,      ROW_ERROR_AREA},
+        {rows->nitrogen_kg_ha,   0.0, MAX_NITROGEN,       ROW_ERROR_NITROGEN},
+        {rows->phosphorus_kg_ha, 0.0, MAX_PHOSPHORUS,     ROW_ERROR_PHOSPHORUS},
+        {rows->potassium_kg_ha,  0.0, MAX_POTASSIUM,      ROW_ERROR_POTASSIUM},
+        {rows->manure_kg_ha,     0.0, MAX_MANURE,         ROW_ERROR_MANURE},
+        {rows->diesel_l_ha,      0.0, MAX_DIESEL,         ROW_ERROR_DIESEL},
+        {rows->irrigation_mm,    0.0, MAX_IRRIGATION,     ROW_ERROR_IRRIGATION},
+        {rows->pesticide_rate,   0.0, MAX_PESTICIDE_RATE, ROW_ERROR_PESTICIDE_RATE}
+    };
+
+    for (size_t i = 0; i < num_rows; i++) {
+        uint32_t crop_ok = (uint32_t)((crop_id[i] >= 0) & (crop_id[i] < num_crops));
+        uint32_t pesticide_ok = (uint32_t)((rows->pesticide_id[i] >= -1) & (rows->pesticide_id[i] < num_pesticides));
+        errors[i] = (ROW_ERROR_CROP_ID & (crop_ok - 1u)) | (ROW_ERROR_PESTICIDE_ID & (pesticide_ok - 1u));
+    }
+    for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++) {
+        range_check(checks[c].values, num_rows, checks[c].lo, checks[c].hi, checks[c].bit, errors);
+    }
+}
+
+// Farm-level checks of validate_farm_columns() for one farm whose crops
+// cover crop_area hectares; the crop count and crop rows are not checked
+static uint32_t check_farm(double size, int set, double crop_area, int cows, int pigs, int chickens) {
+    int num_sets = factor_table.num_regions * factor_table.num_years;
+    uint32_t errors = 0;
+
+    errors |= FARM_ERROR_SIZE & ((uint32_t)((size > 0.0) & (size <= MAX_FARM_SIZE)) - 1u);
+    errors |= FARM_ERROR_FACTOR_SET & ((uint32_t)((set >= 0) & (set < num_sets)) - 1u);
+    errors |= FARM_ERROR_CROP_AREA & ((uint32_t)(crop_area <= size * CROP_AREA_TOLERANCE) - 1u);
+    errors |= FARM_ERROR_COWS & ((uint32_t)((cows >= 0) & (cows <= MAX_COWS)) - 1u);
+    errors |= FARM_ERROR_PIGS & ((uint32_t)((pigs >= 0) & (pigs <= MAX_PIGS)) - 1u);
+    errors |= FARM_ERROR_CHICKENS & ((uint32_t)((chickens >= 0) & (chickens <= MAX_CHICKENS)) - 1u);
+    return errors;
+}
+
+// Farm-level checks of validate_farm_record(); each farm's mask also
+// collects the error bits of its crop rows, so a farm is valid exactly
+// when its mask is 0
+void validate_farm_columns(const FarmColumns *farms, size_t num_farms, const double *area,
+                           const uint32_t *row_errors, uint32_t *farm_errors) {
+    for (size_t f = 0; f < num_farms; f++) {
+        size_t begin = farms->crop_start[f];
+        size_t end = farms->crop_start[f + 1];
+        int set = farms->factor_set ? farms->factor_set[f] : factor_table.default_set;
+        double crop_area = 0.0;
+        uint32_t errors = 0;
+
+        for (size_t i = begin; i < end; i++) {
+            crop_area += area[i];
+            errors |= row_errors[i];
+        }
+        errors |= FARM_ERROR_NO_CROPS & ((uint32_t)(end > begin) - 1u);
+        errors |= check_farm(farms->total_farm_size[f], set, crop_area,
+                             farms->dairy_cows[f], farms->pigs[f], farms->chickens[f]);
+        farm_errors[f] = errors;
+    }
+}
+
+// The row checks of validate_crop_columns() for one crop
+uint32_t crop_row_errors(const CropData *row) {
+    const struct {
+        double value;
+        double hi;
+        uint32_t bit;
+    } checks[] = {
+        {row->area,             MAX_CROP_AREA,      ROW_ERROR_AREA},
+        {row->nitrogen_kg_ha,   MAX_NITROGEN,       ROW_ERROR_NITROGEN},
+        {row->phosphorus_kg_ha, MAX_PHOSPHORUS,     ROW_ERROR_PHOSPHORUS},
+        {row->potassium_kg_ha,  MAX_POTASSIUM,      ROW_ERROR_POTASSIUM},
+        {row->manure_kg_ha,     MAX_MANURE,         ROW_ERROR_MANURE},
+        {row->diesel_l_ha,      MAX_DIESEL,         ROW_ERROR_DIESEL},
+        {row->irrigation_mm,    MAX_IRRIGATION,     ROW_ERROR_IRRIGATION},
+        {row->pesticide_rate,   MAX_PESTICIDE_RATE, ROW_ERROR_PESTICIDE_RATE}
+    };
+    uint32_t crop_ok = (uint32_t)((row->crop_id >= 0) & (row->crop_id < num_crops));
+    uint32_t pesticide_ok = (uint32_t)((row->pesticide_id >= -1) & (row->pesticide_id < num_pesticides));
+    uint32_t errors = (ROW_ERROR_CROP_ID & (crop_ok - 1u)) | (ROW_ERROR_PESTICIDE_ID & (pesticide_ok - 1u));
+
+    for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++) {
+        uint32_t ok = (uint32_t)((checks[c].value >= 0.0) & (checks[c].value <= checks[c].hi));
+        errors |= checks[c].bit & (ok - 1u);
+    }
+    return errors;
+}
+
+// The farm-level checks of validate_farm_columns() for a farm whose crops
+// cover crop_area hectares (crop rows are checked by crop_row_errors())
+uint32_t farm_record_errors(const FarmRecord *farm, double crop_area) {
+    return check_farm(farm->total_farm_size, farm->factor_set, crop_area,
+                      farm->dairy_cows, farm->pigs, farm->chickens);
+}
+
+// The checks of validate_legacy_input() as an error mask: the crop type
+// sets ROW_ERROR_CROP_ID and the farm size FARM_ERROR_SIZE
+uint32_t legacy_input_errors(const LegacyFarmData *farm) {
+    const struct {
+        double value;
+        double lo;
+        double hi;
+        uint32_t bit;
+    } checks[] = {
+        {farm->nitrogen_kg_ha,   0.0, MAX_NITROGEN,   ROW_ERROR_NITROGEN},
+        {farm->phosphorus_kg_ha, 0.0, MAX_PHOSPHORUS, ROW_ERROR_PHOSPHORUS},
+        {farm->potassium_kg_ha,  0.0, MAX_POTASSIUM,  ROW_ERROR_POTASSIUM},
+        {farm->manure_kg_ha,     0.0, MAX_MANURE,     ROW_ERROR_MANURE},
+        {farm->diesel_l_ha,      0.0, MAX_DIESEL,     ROW_ERROR_DIESEL},
+        {farm->irrigation_mm,    0.0, MAX_IRRIGATION, ROW_ERROR_IRRIGATION},
+        {farm->dairy_cows,       0.0, MAX_COWS,       FARM_ERROR_COWS},
+        {farm->pigs,             0.0, MAX_PIGS,       FARM_ERROR_PIGS},
+        {farm->chickens,         0.0, MAX_CHICKENS,   FARM_ERROR_CHICKENS}
+    };
+    uint32_t errors = 0;
+
+    errors |= FARM_ERROR_SIZE & ((uint32_t)((farm->farm_size > 0.0) & (farm->farm_size <= MAX_FARM_SIZE)) - 1u);
+    errors |= ROW_ERROR_CROP_ID & ((uint32_t)is_valid_crop_type(farm->crop_type) - 1u);
+    for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++) {
+        uint32_t ok = (uint32_t)((checks[c].value >= checks[c].lo) & (checks[c].value <= checks[c].hi));
+        errors |= checks[c].bit & (ok - 1u);
+    }
+    return errors;
+}
+
+// Column or check named by one error bit index
+const char *validation_error_name(int bit) {
+    return bit >= 0 && bit < NUM_VALIDATION_ERRORS ? error_names[bit] : "unknown";
+}
+
+// Comma-separated names of the errors in a mask, e.g. "nitrogen,diesel"
+void format_validation_errors(uint32_t errors, char *text, size_t size) {
+    size_t length = 0;
+
+    if (size == 0) return;
+    text[0] = '\0';
+    for (int bit = 0; bit < NUM_VALIDATION_ERRORS; bit++) {
+        if (!(errors & (1u << bit))) continue;
+        int written = snprintf(text + length, size - length, "%s%s", length > 0 ? "," : "", error_names[bit]);
+        if (written < 0 || (size_t)written >= size - length) {
+            return;
+        }
+        length += (size_t)written;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compute_batch.h"
+
+// Error bits of the columnar validator. Crop row checks set the first
+// bits in the row's mask; farm checks set the others in the farm's mask,
+// which also collects the bits of all its rows.
+#define ROW_ERROR_CROP_ID         (1u << 0)
+#define ROW_ERROR_AREA            (1u << 1)
+#define ROW_ERROR_NITROGEN        (1u << 2)
+#define ROW_ERROR_PHOSPHORUS      (1u << 3)
+#define ROW_ERROR_POTASSIUM       (1u << 4)
+#define ROW_ERROR_MANURE          (1u << 5)
+#define ROW_ERROR_DIESEL          (1u << 6)
+#define ROW_ERROR_IRRIGATION      (1u << 7)
+#define ROW_ERROR_PESTICIDE_ID    (1u << 8)
+#define ROW_ERROR_PESTICIDE_RATE  (1u << 9)
+#define ROW_ERRORS                ((1u << 10) - 1)
+#define FARM_ERROR_SIZE           (1u << 10)
+#define FARM_ERROR_NO_CROPS       (1u << 11)
+#define FARM_ERROR_FACTOR_SET     (1u << 12)
+#define FARM_ERROR_CROP_AREA      (1u << 13)   // crops exceed the farm size
+#define FARM_ERROR_COWS           (1u << 14)
+#define FARM_ERROR_PIGS           (1u << 15)
+#define FARM_ERROR_CHICKENS       (1u << 16)
+#define NUM_VALIDATION_ERRORS 17
+
+// Function declarations
+void validate_crop_columns(const CropColumns *rows, const int *crop_id, size_t num_rows, uint32_t *errors);
+void validate_farm_columns(const FarmColumns *farms, size_t num_farms, const double *area,
+                           const uint32_t *row_errors, uint32_t *farm_errors);
+uint32_t crop_row_errors(const CropData *row);
+uint32_t farm_record_errors(const FarmRecord *farm, double crop_area);
+uint32_t legacy_input_errors(const LegacyFarmData *farm);
+const char *validation_error_name(int bit);
+void format_validation_errors(uint32_t errors, char *text, size_t size);
+
+#endif